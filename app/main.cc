@@ -1,8 +1,19 @@
-// #define FMT_HEADER_ONLY // may need this line
+// Load and soak driver for the disruptor.
+// Replays a traffic shape described by a JSON scenario (see test.json) and
+// streams throughput, backlog and latency reports while it runs.
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include <cxxopts.hpp>
 #include <fmt/format.h>
@@ -10,30 +21,369 @@
 #include <spdlog/spdlog.h>
 
 #include "config.hpp"
+#include "disruptor.hpp"
+#include "histogram.hpp"
+#include "thread_runner.hpp"
+#include "tsc_clock.hpp"
 
 using json = nlohmann::json;
 namespace fs = std::filesystem;
+using profiler::TscClock;
 
-int main(int argc, char **argv)
+namespace
+{
+
+// Burst profile: for duration_ms out of every period_ms the rate is
+// multiplied by multiplier. A zero period disables bursts.
+struct Burst
+{
+    std::int64_t period_ms{};
+    std::int64_t duration_ms{};
+    double multiplier{1.};
+};
+
+struct Producer
+{
+    // Messages per second; 0 sends as fast as the ring allows.
+    double rate{};
+    std::size_t batch{1};
+    Burst burst{};
+};
+
+struct Consumer
+{
+    std::size_t batch{64};
+    // Simulated handling cost per message.
+    std::int64_t work_ns{};
+};
+
+struct Scenario
+{
+    std::string name{"unnamed"};
+    double duration_s{10.};
+    std::int64_t report_interval_ms{1000};
+    std::size_t ring_size{disruptor::DEFAULT_CAPACITY};
+    std::size_t message_size{64};
+    disruptor::ConsumerMode consumer_mode{disruptor::ConsumerMode::COMPETING};
+    bool pin{true};
+    int first_cpu{};
+    // SCHED_FIFO priority for producers and consumers; 0 keeps the default.
+    int fifo_priority{};
+    std::vector<Producer> producers;
+    std::vector<Consumer> consumers;
+};
+
+void from_json(const json &j, Burst &burst)
 {
-    std::cout << "JSON: " << NLOHMANN_JSON_VERSION_MAJOR << "."
-              << NLOHMANN_JSON_VERSION_MINOR << "."
-              << NLOHMANN_JSON_VERSION_PATCH << '\n';
-    std::cout << "FMT: " << FMT_VERSION << '\n';
-    std::cout << "CXXOPTS: " << CXXOPTS__VERSION_MAJOR << "."
-              << CXXOPTS__VERSION_MINOR << "." << CXXOPTS__VERSION_PATCH
-              << '\n';
-    std::cout << "SPDLOG: " << SPDLOG_VER_MAJOR << "." << SPDLOG_VER_MINOR
-              << "." << SPDLOG_VER_PATCH << '\n';
-    std::cout << "\n\nUsage Example:\n";
+    burst.period_ms = j.value("period_ms", burst.period_ms);
+    burst.duration_ms = j.value("duration_ms", burst.duration_ms);
+    burst.multiplier = j.value("multiplier", burst.multiplier);
+    // A rate of zero would make the interval between messages infinite.
+    if (!(burst.multiplier > 0.))
+        throw std::invalid_argument("burst multiplier must be positive");
+}
+
+void from_json(const json &j, Producer &producer)
+{
+    producer.rate = j.value("rate", producer.rate);
+    producer.batch = std::max<std::size_t>(1, j.value("batch", producer.batch));
+    producer.burst = j.value("burst", producer.burst);
+}
+
+void from_json(const json &j, Consumer &consumer)
+{
+    consumer.batch = std::max<std::size_t>(1, j.value("batch", consumer.batch));
+    consumer.work_ns = j.value("work_ns", consumer.work_ns);
+}
+
+void from_json(const json &j, Scenario &scenario)
+{
+    scenario.name = j.value("name", scenario.name);
+    scenario.duration_s = j.value("duration_s", scenario.duration_s);
+    scenario.report_interval_ms =
+        j.value("report_interval_ms", scenario.report_interval_ms);
+    scenario.ring_size = j.value("ring_size", scenario.ring_size);
+    scenario.message_size = j.value("message_size", scenario.message_size);
+    scenario.pin = j.value("pin", scenario.pin);
+    scenario.first_cpu = j.value("first_cpu", scenario.first_cpu);
+    scenario.fifo_priority = j.value("fifo_priority", scenario.fifo_priority);
+    scenario.producers = j.value("producers", std::vector<Producer>(1));
+    scenario.consumers = j.value("consumers", std::vector<Consumer>(1));
+
+    const auto mode = j.value("consumer_mode", std::string{"COMPETING"});
+    if (mode == "COMPETING")
+        scenario.consumer_mode = disruptor::ConsumerMode::COMPETING;
+    else if (mode == "BROADCAST")
+        scenario.consumer_mode = disruptor::ConsumerMode::BROADCAST;
+    else
+        throw std::invalid_argument("Unknown consumer_mode: " + mode);
+
+    if (!disruptor::IsValidCapacity(scenario.ring_size))
+        throw std::invalid_argument("ring_size must be a power of 2");
+    if (scenario.producers.empty() || scenario.consumers.empty())
+        throw std::invalid_argument(
+            "A scenario needs at least one producer and one consumer");
+}
+
+//---------------------------------------------------------------------------
+// The first word carries the TSC stamp taken when the message was claimed.
+template <std::size_t Bytes>
+struct Message
+{
+    std::array<std::uint64_t, Bytes / sizeof(std::uint64_t)> words{};
+};
+
+// Written by one thread, read by the reporter. Padded so neighbouring
+// counters never share a cache line.
+struct alignas(128) Counter
+{
+    std::atomic<std::uint64_t> value{};
+};
+
+// Producers and consumers get consecutive CPUs from first_cpu, in that order.
+disruptor::ThreadConfig Placement(const Scenario &scenario,
+                                  std::string name,
+                                  std::size_t slot)
+{
+    auto config = disruptor::ThreadConfig{std::move(name), {}, scenario.fifo_priority};
+    if (scenario.pin)
+        config.cpus.push_back(scenario.first_cpu + static_cast<int>(slot));
+    return config;
+}
+
+void Spin(std::int64_t ns)
+{
+    const auto until = TscClock::ToNanos(TscClock::Ticks()) + ns;
+    while (TscClock::ToNanos(TscClock::Ticks()) < until)
+    {
+    }
+}
+
+double RateAt(const Producer &producer, std::int64_t elapsed_ns)
+{
+    const auto &burst = producer.burst;
+    const auto elapsed_ms = elapsed_ns / 1'000'000;
+    if (burst.period_ms > 0 && elapsed_ms % burst.period_ms < burst.duration_ms)
+        return producer.rate * burst.multiplier;
+    return producer.rate;
+}
+
+//---------------------------------------------------------------------------
+template <std::size_t Bytes>
+int Run(const Scenario &scenario)
+{
+    using MessageT = Message<Bytes>;
+    auto disruptor = disruptor::MakeSingleDisruptor<MessageT>(
+        scenario.consumer_mode,
+        scenario.ring_size);
+
+    const auto num_producers = scenario.producers.size();
+    const auto num_consumers = scenario.consumers.size();
+    std::vector<Counter> sent(num_producers);
+    std::vector<Counter> received(num_consumers);
+    std::vector<profiler::LatencyHistogram> latency(num_consumers);
+    std::atomic<bool> stop{};
+    std::atomic<std::size_t> producers_done{};
+
+    // Readers and writers must all exist before the first write.
+    std::vector<decltype(disruptor.CreateWriter())> writers;
+    std::vector<decltype(disruptor.CreateReader())> readers;
+    for (std::size_t i = 0; i < num_producers; ++i)
+        writers.push_back(disruptor.CreateWriter());
+    for (std::size_t i = 0; i < num_consumers; ++i)
+        readers.push_back(disruptor.CreateReader());
 
-    // Compiler Warning and clang tidy error
-    // std::int32_t i = 0;
+    const auto start_ns = TscClock::ToNanos(TscClock::Ticks());
+    disruptor::ThreadRunner runner;
 
-    // Adress Sanitizer should see this
-    // int *x = new int[42];
-    // x[100] = 5; // Boom!
+    for (std::size_t i = 0; i < num_producers; ++i)
+    {
+        runner.Start(Placement(scenario, fmt::format("producer-{}", i), i), [&, i] {
+            const auto &producer = scenario.producers[i];
+            auto &writer = writers[i];
+            auto &count = sent[i].value;
+            // Messages are due at a steady rate; a producer that falls
+            // behind catches up at full speed rather than dropping them.
+            auto next_ns = start_ns;
+
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                if (producer.rate > 0)
+                {
+                    auto now = TscClock::ToNanos(TscClock::Ticks());
+                    while (now < next_ns &&
+                           !stop.load(std::memory_order_relaxed))
+                        now = TscClock::ToNanos(TscClock::Ticks());
+                    next_ns += static_cast<std::int64_t>(
+                        1e9 * static_cast<double>(producer.batch) / RateAt(producer, now - start_ns));
+                }
+
+                auto claim = writer.Claim(producer.batch);
+                const auto stamp = TscClock::Ticks();
+                for (std::size_t s = 0; s < claim.size(); ++s)
+                    claim[s].data().words[0] = stamp;
+                count.store(count.load(std::memory_order_relaxed) +
+                                claim.size(),
+                            std::memory_order_relaxed);
+            }
+            producers_done.fetch_add(1, std::memory_order_release);
+        });
+    }
+
+    for (std::size_t i = 0; i < num_consumers; ++i)
+    {
+        const auto slot = num_producers + i;
+        runner.Start(Placement(scenario, fmt::format("consumer-{}", i), slot), [&, i] {
+            const auto &consumer = scenario.consumers[i];
+            auto &reader = readers[i];
+            auto &histogram = latency[i];
+            auto &count = received[i].value;
+
+            while (true)
+            {
+                // Checked before reading: an empty read after the producers
+                // finished means everything has been consumed.
+                const auto drained =
+                    producers_done.load(std::memory_order_acquire) ==
+                    num_producers;
+                auto read_result = reader.Read(consumer.batch);
+                if (read_result.err)
+                {
+                    if (drained)
+                        break;
+                    continue;
+                }
+
+                std::size_t n = 0;
+                for (auto iter = read_result.begin; iter != read_result.end;
+                     ++iter, ++n)
+                {
+                    const auto now = TscClock::ToNanos(TscClock::TicksEnd());
+                    const auto stamp =
+                        TscClock::ToNanos((*iter).data().words[0]);
+                    histogram.Record(static_cast<std::uint64_t>(
+                        std::max<std::int64_t>(0, now - stamp)));
+                    if (consumer.work_ns > 0)
+                        Spin(consumer.work_ns);
+                }
+                read_result.Release();
+                count.store(count.load(std::memory_order_relaxed) + n,
+                            std::memory_order_relaxed);
+            }
+        });
+    }
+
+    // Logged so the run can be reproduced on the same placement.
+    spdlog::info("Thread placement:\n{}", runner.Report());
+    for (const auto &warning : runner.warnings())
+        spdlog::warn("{}", warning);
+
+    const auto sum = [](const std::vector<Counter> &counters) {
+        std::uint64_t total = 0;
+        for (const auto &counter : counters)
+            total += counter.value.load(std::memory_order_relaxed);
+        return total;
+    };
+    // Messages published but not yet released by the slowest consumer.
+    const auto backlog = [&] {
+        std::size_t slowest = readers.front().GetCursor();
+        for (const auto &reader : readers)
+            slowest = std::min(slowest, reader.GetCursor());
+        const auto written = writers.front().GetCursor();
+        return written > slowest ? written - slowest : 0;
+    };
+    const auto merged_latency = [&] {
+        profiler::LatencyHistogram merged;
+        for (const auto &histogram : latency)
+            merged.Merge(histogram);
+        return merged.GetStats();
+    };
 
+    const auto duration_ns =
+        static_cast<std::int64_t>(scenario.duration_s * 1e9);
+    const auto interval = std::chrono::milliseconds(
+        std::max<std::int64_t>(1, scenario.report_interval_ms));
+    auto last_ns = start_ns;
+    auto last_sent = std::uint64_t{};
+    auto last_received = std::uint64_t{};
+
+    while (true)
+    {
+        std::this_thread::sleep_for(interval);
+        const auto now_ns = TscClock::ToNanos(TscClock::Ticks());
+        const auto seconds = static_cast<double>(now_ns - last_ns) / 1e9;
+        const auto total_sent = sum(sent);
+        const auto total_received = sum(received);
+        // Latency percentiles are cumulative since the start of the run.
+        const auto stats = merged_latency();
+
+        spdlog::info("[{:>7.1f}s] sent {:>11.0f}/s  recv {:>11.0f}/s  "
+                     "backlog {:>8}  latency ns p50 {:.0f} p99 {:.0f} "
+                     "p99.9 {:.0f} p99.99 {:.0f} max {:.0f}",
+                     static_cast<double>(now_ns - start_ns) / 1e9,
+                     static_cast<double>(total_sent - last_sent) / seconds,
+                     static_cast<double>(total_received - last_received) /
+                         seconds,
+                     backlog(),
+                     stats.p50,
+                     stats.p99,
+                     stats.p999,
+                     stats.p9999,
+                     stats.max);
+
+        last_ns = now_ns;
+        last_sent = total_sent;
+        last_received = total_received;
+        if (now_ns - start_ns >= duration_ns)
+            break;
+    }
+
+    stop.store(true, std::memory_order_relaxed);
+    runner.Join();
+
+    const auto elapsed_s =
+        static_cast<double>(TscClock::ToNanos(TscClock::Ticks()) - start_ns) /
+        1e9;
+    const auto stats = merged_latency();
+    spdlog::info("'{}' done: sent {} received {} in {:.1f}s ({:.0f} msgs/s)",
+                 scenario.name,
+                 sum(sent),
+                 sum(received),
+                 elapsed_s,
+                 static_cast<double>(sum(received)) / elapsed_s);
+    spdlog::info("latency ns: mean {:.0f} p50 {:.0f} p99 {:.0f} p99.9 {:.0f} "
+                 "p99.99 {:.0f} max {:.0f} over {} messages",
+                 stats.mean,
+                 stats.p50,
+                 stats.p99,
+                 stats.p999,
+                 stats.p9999,
+                 stats.max,
+                 stats.count);
+    return 0;
+}
+
+int Run(const Scenario &scenario)
+{
+    switch (scenario.message_size)
+    {
+    case 8:
+        return Run<8>(scenario);
+    case 64:
+        return Run<64>(scenario);
+    case 256:
+        return Run<256>(scenario);
+    default:
+        spdlog::error("Unsupported message_size {}: use 8, 64 or 256",
+                      scenario.message_size);
+        return 1;
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
     const auto welcome_message =
         fmt::format("Welcome to {} v{}\n", project_name, project_version);
     spdlog::info(welcome_message);
@@ -42,8 +392,11 @@ int main(int argc, char **argv)
 
     options.add_options("arguments")("h,help", "Print usage")(
         "f,filename",
-        "File name",
+        "Scenario JSON file",
         cxxopts::value<std::string>())(
+        "d,duration",
+        "Override the scenario duration in seconds",
+        cxxopts::value<double>())(
         "v,verbose",
         "Verbose output",
         cxxopts::value<bool>()->default_value("false"));
@@ -56,39 +409,54 @@ int main(int argc, char **argv)
         return 0;
     }
 
-    auto filename = std::string{};
-    auto verbose = false;
-
-    if (result.count("filename"))
-    {
-        filename = result["filename"].as<std::string>();
-    }
-    else
+    if (!result.count("filename"))
     {
+        spdlog::error("No scenario file given");
         return 1;
     }
 
-    verbose = result["verbose"].as<bool>();
-
-    if (verbose)
+    const auto filename = fs::path{result["filename"].as<std::string>()};
+    if (result["verbose"].as<bool>())
     {
-        fmt::print("Opening file: {}\n", filename);
+        spdlog::set_level(spdlog::level::debug);
     }
 
     auto ifs = std::ifstream{filename};
-
     if (!ifs.is_open())
     {
+        spdlog::error("Cannot open {}", filename.string());
         return 1;
     }
 
-    const auto parsed_data = json::parse(ifs);
+    auto scenario = Scenario{};
+    try
+    {
+        scenario = json::parse(ifs).get<Scenario>();
+    }
+    catch (const std::exception &e)
+    {
+        spdlog::error("Invalid scenario {}: {}", filename.string(), e.what());
+        return 1;
+    }
 
-    if (verbose)
+    if (result.count("duration"))
     {
-        const auto name = parsed_data["name"];
-        fmt::print("Name: {}\n", name);
+        scenario.duration_s = result["duration"].as<double>();
     }
 
-    return 0;
+    spdlog::info("Scenario '{}': {} producers, {} {} consumers, ring {}, "
+                 "{} byte messages, {:.1f}s",
+                 scenario.name,
+                 scenario.producers.size(),
+                 scenario.consumers.size(),
+                 scenario.consumer_mode ==
+                         disruptor::ConsumerMode::BROADCAST
+                     ? "broadcast"
+                     : "competing",
+                 scenario.ring_size,
+                 scenario.message_size,
+                 scenario.duration_s);
+    spdlog::debug("Clock: {}", TscClock::is_tsc() ? "TSC" : "steady_clock");
+
+    return Run(scenario);
 }
@@ -0,0 +1,282 @@
+// Variable-length records against fixed-size slots on a mixed-size market data feed.
+// The feed is mostly small trades and quotes with the odd large book snapshot. A fixed-size ring
+// must size every slot for the snapshot, so it copies and caches mostly padding; the ByteRing
+// only moves the bytes each record needs. Both rings get the same memory, one writer copies the
+// feed in, and one reader walks every payload byte in place. Reported in msgs/s and payload MB/s.
+//
+//		byte_ring_bench --ring-bytes 1048576 --messages 5000000 --output byte_ring.json
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cxxopts.hpp>
+#include <nlohmann/json.hpp>
+
+#include "byte_ring.hpp"
+#include "disruptor.hpp"
+#include "scoped_profiler.hpp"
+
+using json = nlohmann::json;
+
+namespace bench {
+
+	using disruptor::PublishPolicy;
+
+	//---------------------------------------------------------------------------
+	struct RecordKind {
+		const char* 	name;
+		uint16_t 		type;
+		size_t 			size;
+		double 			weight;
+	};
+
+	// Roughly the shape of an equities feed.
+	constexpr std::array<RecordKind, 4> FEED_MIX{{
+		{"trade", 			0, 24, 		0.70},
+		{"quote", 			1, 40, 		0.20},
+		{"order", 			2, 64, 		0.08},
+		{"book_snapshot", 	3, 320, 	0.02}}};
+
+	constexpr size_t MAX_RECORD_SIZE = 320;
+
+	// The fixed-size ring's slot: big enough for any record.
+	struct FixedRecord {
+		uint16_t 									type;
+		uint32_t 									size;
+		std::array<std::byte, MAX_RECORD_SIZE> 		payload;
+	};
+
+	struct Settings {
+		size_t 					messages;
+		size_t 					ring_bytes;
+		size_t 					batch;
+		size_t 					repetitions;
+		uint64_t 				seed;
+	};
+
+	struct Feed {
+		std::vector<uint16_t> 	kinds;
+		size_t 					payload_bytes{};
+	};
+
+	//---------------------------------------------------------------------------
+	Feed MakeFeed(const Settings& settings)
+	{
+		std::mt19937_64 rng(settings.seed);
+		std::discrete_distribution<uint16_t> pick(FEED_MIX.size(), 0., 1., [] (double x) {
+			return FEED_MIX[static_cast<size_t>(x * FEED_MIX.size())].weight;
+		});
+		Feed feed;
+		feed.kinds.reserve(settings.messages);
+		for (size_t i = 0; i < settings.messages; ++i)
+		{
+			feed.kinds.push_back(pick(rng));
+			feed.payload_bytes += FEED_MIX[feed.kinds.back()].size;
+		}
+		return feed;
+	}
+
+	// What the reader does with a payload: read every byte of it.
+	uint64_t Touch(std::span<const std::byte> payload)
+	{
+		uint64_t sum = 0;
+		for (auto b: payload)
+			sum += static_cast<uint8_t>(b);
+		return sum;
+	}
+
+	//---------------------------------------------------------------------------
+	struct Run {
+		double 					seconds;
+		uint64_t 				checksum;
+	};
+
+	Run RunByteRing(const Feed& feed, const Settings& settings)
+	{
+		auto ring = disruptor::ByteRing<PublishPolicy::SINGLE>::Create(settings.ring_bytes);
+		auto reader = ring->CreateReader();
+		std::array<std::byte, MAX_RECORD_SIZE> source;
+		for (size_t i = 0; i < source.size(); ++i) source[i] = static_cast<std::byte>(i);
+		std::atomic<bool> go{};
+
+		std::thread writer_thread([&, writer = ring->CreateWriter()] () mutable {
+			while (!go.load(std::memory_order_acquire)) {}
+			for (auto kind: feed.kinds)
+			{
+				const auto& record = FEED_MIX[kind];
+				while (writer.Write(record.type, source.data(), record.size)) {}
+			}
+		});
+
+		const auto start = profiler::TscClock::now();
+		go.store(true, std::memory_order_release);
+		uint64_t checksum = 0;
+		for (size_t read = 0; read < feed.kinds.size();)
+		{
+			for (const auto& record: reader.Read())
+			{
+				checksum += record.type + Touch(record.payload);
+				++read;
+			}
+		}
+		const double seconds = std::chrono::duration<double>(profiler::TscClock::now() - start).count();
+		writer_thread.join();
+		return {seconds, checksum};
+	}
+
+	Run RunFixedSlots(const Feed& feed, const Settings& settings)
+	{
+		// The same memory as the ByteRing, in whole slots.
+		size_t slots = 1;
+		while (slots * 2 * sizeof(disruptor::Sequence<FixedRecord>) <= settings.ring_bytes) slots *= 2;
+		auto disruptor = disruptor::MakeSingleDisruptor<FixedRecord, PublishPolicy::SINGLE, PublishPolicy::SINGLE>(
+			disruptor::ConsumerMode::COMPETING, slots);
+		auto reader = disruptor.CreateReader();
+		std::array<std::byte, MAX_RECORD_SIZE> source;
+		for (size_t i = 0; i < source.size(); ++i) source[i] = static_cast<std::byte>(i);
+		std::atomic<bool> go{};
+
+		std::thread writer_thread([&, writer = disruptor.CreateWriter()] () mutable {
+			while (!go.load(std::memory_order_acquire)) {}
+			for (auto kind: feed.kinds)
+			{
+				const auto& record = FEED_MIX[kind];
+				auto claim = writer.Claim(1);
+				auto& slot = claim[0].data();
+				slot.type = record.type;
+				slot.size = static_cast<uint32_t>(record.size);
+				std::memcpy(slot.payload.data(), source.data(), record.size);
+			}
+		});
+
+		const auto start = profiler::TscClock::now();
+		go.store(true, std::memory_order_release);
+		uint64_t checksum = 0;
+		for (size_t read = 0; read < feed.kinds.size();)
+		{
+			auto read_result = reader.Read(settings.batch);
+			if (read_result.err) continue;
+			for (auto iter = read_result.begin; iter != read_result.end; ++iter, ++read)
+			{
+				const auto& slot = (*iter).data();
+				checksum += slot.type + Touch({slot.payload.data(), slot.size});
+			}
+			read_result.Release();
+		}
+		const double seconds = std::chrono::duration<double>(profiler::TscClock::now() - start).count();
+		writer_thread.join();
+		return {seconds, checksum};
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename _RunFn>
+	json RunPoint(const char* name, _RunFn run, const Feed& feed, const Settings& settings)
+	{
+		run(feed, settings);
+
+		std::vector<double> msgs_per_sec, mb_per_sec;
+		uint64_t checksum = 0;
+		for (size_t i = 0; i < settings.repetitions; ++i)
+		{
+			const auto result = run(feed, settings);
+			msgs_per_sec.push_back(static_cast<double>(feed.kinds.size()) / result.seconds);
+			mb_per_sec.push_back(static_cast<double>(feed.payload_bytes) / result.seconds / 1e6);
+			checksum = result.checksum;
+		}
+
+		const auto msgs_stats = profiler::GetStats(msgs_per_sec);
+		const auto mb_stats = profiler::GetStats(mb_per_sec);
+		return {
+			{"ring", 			name},
+			{"repetitions", 	settings.repetitions},
+			{"checksum", 		checksum},
+			{"msgs_per_sec", 	{{"mean", msgs_stats.mean}, {"min", msgs_stats.min}, {"max", msgs_stats.max}, {"stdev", msgs_stats.stdev}}},
+			{"payload_mb_per_sec", {{"mean", mb_stats.mean}, {"min", mb_stats.min}, {"max", mb_stats.max}, {"stdev", mb_stats.stdev}}},
+		};
+	}
+
+} // namespace bench
+
+//---------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+	cxxopts::Options options("byte_ring_bench", "Variable-length records against fixed-size slots");
+	options.add_options()
+		("h,help", "Print usage")
+		("ring-bytes", "Memory for each ring in bytes (power of 2)", cxxopts::value<size_t>()->default_value("1048576"))
+		("messages", "Records per run", cxxopts::value<size_t>()->default_value("5000000"))
+		("batch", "Largest read batch for the fixed-size ring", cxxopts::value<size_t>()->default_value("256"))
+		("repetitions", "Timed runs per ring", cxxopts::value<size_t>()->default_value("5"))
+		("seed", "Feed generator seed", cxxopts::value<uint64_t>()->default_value("42"))
+		("o,output", "JSON output file; stdout if empty", cxxopts::value<std::string>()->default_value(""));
+
+	const auto args = options.parse(argc, argv);
+	if (args.count("help"))
+	{
+		std::cout << options.help() << '\n';
+		return 0;
+	}
+
+	const bench::Settings settings{
+		args["messages"].as<size_t>(),
+		args["ring-bytes"].as<size_t>(),
+		args["batch"].as<size_t>(),
+		args["repetitions"].as<size_t>(),
+		args["seed"].as<uint64_t>()};
+
+	if (!disruptor::IsValidCapacity(settings.ring_bytes) || settings.ring_bytes < 4 * sizeof(disruptor::Sequence<bench::FixedRecord>))
+	{
+		std::cerr << "Ring bytes must be a power of 2 and hold a few of the largest records: " << settings.ring_bytes << '\n';
+		return 1;
+	}
+
+	const auto feed = bench::MakeFeed(settings);
+	json results = json::array();
+	for (auto result: {
+			bench::RunPoint("byte_ring", bench::RunByteRing, feed, settings),
+			bench::RunPoint("fixed_slots", bench::RunFixedSlots, feed, settings)})
+	{
+		std::cerr << result.dump() << '\n';
+		results.push_back(std::move(result));
+	}
+	if (results[0]["checksum"] != results[1]["checksum"])
+	{
+		std::cerr << "Rings disagree on the feed\n";
+		return 1;
+	}
+
+	json mix = json::array();
+	for (const auto& kind: bench::FEED_MIX)
+		mix.push_back({{"name", kind.name}, {"size", kind.size}, {"weight", kind.weight}});
+
+	const json report{
+		{"messages", 			settings.messages},
+		{"payload_bytes", 		feed.payload_bytes},
+		{"ring_bytes", 			settings.ring_bytes},
+		{"fixed_slot_bytes", 	sizeof(disruptor::Sequence<bench::FixedRecord>)},
+		{"batch", 				settings.batch},
+		{"repetitions", 		settings.repetitions},
+		{"mix", 				std::move(mix)},
+		{"results", 			std::move(results)}};
+
+	const auto output = args["output"].as<std::string>();
+	if (output.empty())
+	{
+		std::cout << report.dump(2) << '\n';
+	}
+	else
+	{
+		std::ofstream(output) << report.dump(2) << '\n';
+	}
+	return 0;
+}
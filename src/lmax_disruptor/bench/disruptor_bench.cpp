@@ -0,0 +1,660 @@
+// Throughput and latency sweep over disruptor configurations.
+// Every point of the matrix (writers x readers x publish policies x ring size x batch size x element size)
+// is run once to warm up and then repeatedly; msgs/sec and latency percentiles go to JSON so that
+// runs from different builds can be diffed. Each point also reports how often writers and readers had to
+// refresh their cached gates; on a small ring they do so about as often as they would with no cache.
+// SINGLE policies are only run on points with one writer, respectively one reader.
+// Further sweeps run one point of the matrix under each wait strategy, and one writer and one reader
+// over each slot layout and element size. A single-threaded sweep reads whole rings through span views
+// and through iterators. The last runs a ShardedDisruptor over increasing shard counts, with consumers doing a fixed
+// amount of work per event, to show how throughput scales once a single consumer is the bottleneck.
+//
+//		disruptor_bench --writers 1,2 --readers 1 --ring-sizes 1024 --output results.json
+//		disruptor_bench --writers 1 --readers 1 --shards 1,2,4,8 --shard-work-ns 500
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <cxxopts.hpp>
+#include <nlohmann/json.hpp>
+
+#include "disruptor.hpp"
+#include "histogram.hpp"
+#include "scoped_profiler.hpp"
+#include "sharded_disruptor.hpp"
+#include "thread_runner.hpp"
+#include "tsc_clock.hpp"
+
+using json = nlohmann::json;
+
+namespace bench {
+
+	using disruptor::Layout;
+	using disruptor::PublishPolicy;
+
+	//---------------------------------------------------------------------------
+	// The first word carries the TSC stamp taken when the message was claimed.
+	template <size_t Bytes>
+	struct Message {
+		std::array<uint64_t, Bytes/sizeof(uint64_t)> words{};
+	};
+
+	constexpr std::array<size_t, 4> ELEMENT_SIZES{8, 16, 64, 256};
+	constexpr std::array<std::string_view, 5> WAIT_STRATEGIES{"BusySpin", "SpinThenYield", "Backoff", "Sleeping", "Blocking"};
+	constexpr std::array<std::string_view, 3> LAYOUTS{"PADDED", "PACKED", "SOA"};
+
+	//---------------------------------------------------------------------------
+	struct Point {
+		size_t 			writers;
+		size_t 			readers;
+		PublishPolicy 	write_policy;
+		PublishPolicy 	read_policy;
+		size_t 			ring_size;
+		size_t 			batch;
+		size_t 			element_size;
+	};
+
+	struct ShardPoint {
+		size_t 			shards;
+		size_t 			writers;
+		size_t 			keys;
+		size_t 			ring_size;
+		int64_t 		work_ns;
+	};
+
+	// Loads of the other side's cursor per message. Without the cached gates every claim or read would
+	// load it at least once, 1/batch per message, and again on every retry while the ring is full or empty.
+	struct GateRates {
+		double 			writer;
+		double 			reader;
+	};
+
+	struct Settings {
+		size_t 			messages;
+		size_t 			warmup;
+		size_t 			repetitions;
+		bool 			pin;
+	};
+
+	//---------------------------------------------------------------------------
+	std::string ToString(PublishPolicy policy)
+	{
+		switch (policy)
+		{
+			case PublishPolicy::BUFFERED: 		return "BUFFERED";
+			case PublishPolicy::BLOCK: 			return "BLOCK";
+			case PublishPolicy::AVAILABILITY: 	return "AVAILABILITY";
+			case PublishPolicy::SINGLE: 		return "SINGLE";
+		}
+		return "UNKNOWN";
+	}
+
+	PublishPolicy ToPolicy(const std::string& name)
+	{
+		if (name == "BLOCK") 	return PublishPolicy::BLOCK;
+		if (name == "BUFFERED") return PublishPolicy::BUFFERED;
+		if (name == "AVAILABILITY") return PublishPolicy::AVAILABILITY;
+		if (name == "SINGLE") 	return PublishPolicy::SINGLE;
+		throw std::invalid_argument("Unknown publish policy: " + name);
+	}
+
+	//---------------------------------------------------------------------------
+	// Best effort: an unavailable core only costs the pinning, not the run.
+	void PinThread(size_t cpu)
+	{
+		disruptor::ConfigureThisThread({{}, {static_cast<int>(cpu % std::max(1u, std::thread::hardware_concurrency()))}});
+	}
+
+	//---------------------------------------------------------------------------
+	// One timed run. Returns msgs/sec, adds every message's claim-to-read latency to latency,
+	// and sets how often the writers and readers had to refresh their cached gates.
+	template <size_t Bytes, PublishPolicy _WP, PublishPolicy _RP, typename _WS = disruptor::BusySpinWait, Layout _SL = Layout::PADDED>
+	double RunOnce(const Point& point, const Settings& settings, profiler::LatencyHistogram* latency, GateRates* gates)
+	{
+		using MessageT = Message<Bytes>;
+		auto disruptor = disruptor::MakeSingleDisruptor<MessageT, _WP, _RP, _WS, _SL>(disruptor::ConsumerMode::COMPETING, point.ring_size);
+
+		const size_t per_writer = settings.messages / point.writers;
+		const size_t total = per_writer * point.writers;
+		std::atomic<bool> go{};
+		std::atomic<size_t> read_count{};
+		std::vector<profiler::LatencyHistogram> reader_latency(point.readers);
+		std::vector<std::thread> threads;
+		// Competing readers share a cursor, as do writers, so one handle of each sees every refresh.
+		const auto gate_writer = disruptor.CreateWriter();
+		const auto gate_reader = disruptor.CreateReader();
+
+		for (size_t w = 0; w < point.writers; ++w)
+		{
+			threads.emplace_back([&, w, writer = disruptor.CreateWriter()] () mutable {
+				if (settings.pin) PinThread(w);
+				while (!go.load(std::memory_order_acquire)) {}
+
+				for (size_t written = 0; written < per_writer;)
+				{
+					auto claim = writer.Claim(std::min(point.batch, per_writer - written));
+					const uint64_t stamp = profiler::TscClock::Ticks();
+					for (size_t i = 0; i < claim.size(); ++i)
+						claim[i].data().words[0] = stamp;
+					written += claim.size();
+				}
+			});
+		}
+
+		for (size_t r = 0; r < point.readers; ++r)
+		{
+			threads.emplace_back([&, r, reader = disruptor.CreateReader()] () mutable {
+				if (settings.pin) PinThread(point.writers + r);
+				auto& histogram = reader_latency[r];
+				while (!go.load(std::memory_order_acquire)) {}
+
+				while (read_count.load(std::memory_order_relaxed) < total)
+				{
+					auto read_result = reader.Read(point.batch);
+					if (read_result.err) continue;
+
+					const int64_t now = profiler::TscClock::ToNanos(profiler::TscClock::TicksEnd());
+					size_t n = 0;
+					for (auto iter = read_result.begin; iter != read_result.end; ++iter, ++n)
+						histogram.Record(static_cast<uint64_t>(std::max<int64_t>(0, now - profiler::TscClock::ToNanos((*iter).data().words[0]))));
+					read_result.Release();
+					read_count.fetch_add(n, std::memory_order_relaxed);
+				}
+			});
+		}
+
+		const auto start = profiler::TscClock::now();
+		go.store(true, std::memory_order_release);
+		for (auto& thread: threads)
+			thread.join();
+		const double seconds = std::chrono::duration<double>(profiler::TscClock::now() - start).count();
+
+		if (latency)
+			for (const auto& histogram: reader_latency)
+				latency->Merge(histogram);
+		if (gates)
+			*gates = {static_cast<double>(gate_writer.GateRefreshes()) / static_cast<double>(total),
+					static_cast<double>(gate_reader.GateRefreshes()) / static_cast<double>(total)};
+		return static_cast<double>(total) / seconds;
+	}
+
+	//---------------------------------------------------------------------------
+	template <size_t Bytes, PublishPolicy _WP, PublishPolicy _RP, typename _WS = disruptor::BusySpinWait, Layout _SL = Layout::PADDED>
+	json RunPoint(const Point& point, const Settings& settings)
+	{
+		for (size_t i = 0; i < settings.warmup; ++i)
+			RunOnce<Bytes, _WP, _RP, _WS, _SL>(point, settings, nullptr, nullptr);
+
+		profiler::LatencyHistogram latency;
+		std::vector<double> throughput, writer_refreshes, reader_refreshes;
+		for (size_t i = 0; i < settings.repetitions; ++i)
+		{
+			GateRates gates;
+			throughput.push_back(RunOnce<Bytes, _WP, _RP, _WS, _SL>(point, settings, &latency, &gates));
+			writer_refreshes.push_back(gates.writer);
+			reader_refreshes.push_back(gates.reader);
+		}
+
+		const auto throughput_stats = profiler::GetStats(throughput);
+		const auto latency_stats = latency.GetStats();
+		return {
+			{"writers", 		point.writers},
+			{"readers", 		point.readers},
+			{"write_policy", 	ToString(point.write_policy)},
+			{"read_policy", 	ToString(point.read_policy)},
+			{"ring_size", 		point.ring_size},
+			{"batch", 			point.batch},
+			{"element_size", 	point.element_size},
+			{"repetitions", 	settings.repetitions},
+			{"msgs_per_sec", 	{{"mean", throughput_stats.mean}, {"min", throughput_stats.min}, {"max", throughput_stats.max}, {"stdev", throughput_stats.stdev}}},
+			{"latency_ns", 		{{"mean", latency_stats.mean}, {"p50", latency_stats.p50}, {"p99", latency_stats.p99},
+								{"p99.9", latency_stats.p999}, {"p99.99", latency_stats.p9999}, {"max", latency_stats.max}}},
+			{"gate_refreshes_per_msg", {{"writer", profiler::GetStats(writer_refreshes).mean}, {"reader", profiler::GetStats(reader_refreshes).mean}}},
+		};
+	}
+
+	//---------------------------------------------------------------------------
+	// Maps the runtime axes onto the compile-time instantiations.
+	template <size_t Bytes, PublishPolicy _WP>
+	json Dispatch(const Point& point, const Settings& settings)
+	{
+		switch (point.read_policy)
+		{
+			case PublishPolicy::BUFFERED: 		return RunPoint<Bytes, _WP, PublishPolicy::BUFFERED>(point, settings);
+			case PublishPolicy::BLOCK: 			return RunPoint<Bytes, _WP, PublishPolicy::BLOCK>(point, settings);
+			case PublishPolicy::AVAILABILITY: 	return RunPoint<Bytes, _WP, PublishPolicy::AVAILABILITY>(point, settings);
+			case PublishPolicy::SINGLE: 		return RunPoint<Bytes, _WP, PublishPolicy::SINGLE>(point, settings);
+		}
+		throw std::invalid_argument("Unknown read policy: " + ToString(point.read_policy));
+	}
+
+	template <size_t Bytes>
+	json Dispatch(const Point& point, const Settings& settings)
+	{
+		switch (point.write_policy)
+		{
+			case PublishPolicy::BUFFERED: 		return Dispatch<Bytes, PublishPolicy::BUFFERED>(point, settings);
+			case PublishPolicy::BLOCK: 			return Dispatch<Bytes, PublishPolicy::BLOCK>(point, settings);
+			case PublishPolicy::AVAILABILITY: 	return Dispatch<Bytes, PublishPolicy::AVAILABILITY>(point, settings);
+			case PublishPolicy::SINGLE: 		return Dispatch<Bytes, PublishPolicy::SINGLE>(point, settings);
+		}
+		throw std::invalid_argument("Unknown write policy: " + ToString(point.write_policy));
+	}
+
+	json Dispatch(const Point& point, const Settings& settings)
+	{
+		switch (point.element_size)
+		{
+			case 8: 	return Dispatch<8>(point, settings);
+			case 16: 	return Dispatch<16>(point, settings);
+			case 64: 	return Dispatch<64>(point, settings);
+			case 256: 	return Dispatch<256>(point, settings);
+		}
+		throw std::invalid_argument("Unsupported element size: " + std::to_string(point.element_size));
+	}
+
+	//---------------------------------------------------------------------------
+	// 8-byte messages through BLOCK cursors, where writers wait on each other and on the readers.
+	json RunWaitPoint(const std::string& wait, const Point& point, const Settings& settings)
+	{
+		json result;
+		if (wait == "BusySpin") 			result = RunPoint<8, PublishPolicy::BLOCK, PublishPolicy::BLOCK, disruptor::BusySpinWait>(point, settings);
+		else if (wait == "SpinThenYield") 	result = RunPoint<8, PublishPolicy::BLOCK, PublishPolicy::BLOCK, disruptor::SpinThenYieldWait>(point, settings);
+		else if (wait == "Backoff") 		result = RunPoint<8, PublishPolicy::BLOCK, PublishPolicy::BLOCK, disruptor::BackoffWait>(point, settings);
+		else if (wait == "Sleeping") 		result = RunPoint<8, PublishPolicy::BLOCK, PublishPolicy::BLOCK, disruptor::SleepingWait>(point, settings);
+		else if (wait == "Blocking") 		result = RunPoint<8, PublishPolicy::BLOCK, PublishPolicy::BLOCK, disruptor::BlockingWait>(point, settings);
+		else throw std::invalid_argument("Unknown wait strategy: " + wait);
+		result["wait_strategy"] = wait;
+		return result;
+	}
+
+	//---------------------------------------------------------------------------
+	// One writer and one reader on SINGLE cursors, so the slot layout is all that differs.
+	template <Layout _SL>
+	json RunLayoutPoint(const Point& point, const Settings& settings)
+	{
+		switch (point.element_size)
+		{
+			case 8: 	return RunPoint<8, PublishPolicy::SINGLE, PublishPolicy::SINGLE, disruptor::BusySpinWait, _SL>(point, settings);
+			case 16: 	return RunPoint<16, PublishPolicy::SINGLE, PublishPolicy::SINGLE, disruptor::BusySpinWait, _SL>(point, settings);
+			case 64: 	return RunPoint<64, PublishPolicy::SINGLE, PublishPolicy::SINGLE, disruptor::BusySpinWait, _SL>(point, settings);
+			case 256: 	return RunPoint<256, PublishPolicy::SINGLE, PublishPolicy::SINGLE, disruptor::BusySpinWait, _SL>(point, settings);
+		}
+		throw std::invalid_argument("Unsupported element size: " + std::to_string(point.element_size));
+	}
+
+	json RunLayoutPoint(const std::string& layout, const Point& point, const Settings& settings)
+	{
+		json result;
+		if (layout == "PADDED") 		result = RunLayoutPoint<Layout::PADDED>(point, settings);
+		else if (layout == "PACKED") 	result = RunLayoutPoint<Layout::PACKED>(point, settings);
+		else if (layout == "SOA") 		result = RunLayoutPoint<Layout::SOA>(point, settings);
+		else throw std::invalid_argument("Unknown layout: " + layout);
+		result["layout"] = layout;
+		return result;
+	}
+
+	//---------------------------------------------------------------------------
+	// One thread fills an SOA ring and reads it back whole, so only the read path differs.
+	// Every timed read wraps the ring. Returns ns per event read and adds the values read to sum.
+	template <bool _View>
+	double ReadPathOnce(size_t ring_size, const Settings& settings, uint64_t& sum)
+	{
+		auto disruptor = disruptor::MakeSingleDisruptor<uint64_t, PublishPolicy::SINGLE, PublishPolicy::SINGLE, disruptor::BusySpinWait, Layout::SOA>(
+			disruptor::ConsumerMode::COMPETING, ring_size);
+		auto writer = disruptor.CreateWriter();
+		auto reader = disruptor.CreateReader();
+		auto fill = [&] (size_t num) {
+			auto claim = writer.Claim(num);
+			for (size_t i = 0; i < claim.size(); ++i)
+				claim[i].data() = claim.sequence(i) % 1024;
+		};
+
+		fill(ring_size / 2);
+		reader.Read(ring_size / 2).Release();
+
+		const size_t rounds = std::max<size_t>(1, settings.messages / ring_size);
+		double elapsed = 0;
+		for (size_t round = 0; round < rounds; ++round)
+		{
+			fill(ring_size);
+			const auto start = std::chrono::steady_clock::now();
+			if constexpr (_View)
+			{
+				auto view = reader.View(ring_size);
+				for (const auto& segment: view.segments())
+					sum = std::accumulate(segment.begin(), segment.end(), sum);
+			}
+			else
+			{
+				auto read_result = reader.Read(ring_size);
+				for (auto iter = read_result.begin; iter != read_result.end; ++iter)
+					sum += (*iter).data();
+				read_result.Release();
+			}
+			elapsed += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		}
+		return elapsed / static_cast<double>(rounds * ring_size);
+	}
+
+	template <bool _View>
+	json RunReadPathPoint(size_t ring_size, const Settings& settings)
+	{
+		uint64_t sum = 0;
+		for (size_t i = 0; i < settings.warmup; ++i)
+			ReadPathOnce<_View>(ring_size, settings, sum);
+
+		sum = 0;
+		std::vector<double> ns;
+		for (size_t i = 0; i < settings.repetitions; ++i)
+			ns.push_back(ReadPathOnce<_View>(ring_size, settings, sum));
+
+		const auto stats = profiler::GetStats(ns);
+		return {
+			{"read_path", 		_View ? "span" : "iterator"},
+			{"ring_size", 		ring_size},
+			{"repetitions", 	settings.repetitions},
+			{"sum", 			sum},
+			{"ns_per_event", 	{{"mean", stats.mean}, {"min", stats.min}, {"max", stats.max}, {"stdev", stats.stdev}}},
+		};
+	}
+
+	//---------------------------------------------------------------------------
+	// Spins for the configured work per event and records claim-to-handled latency.
+	struct ShardHandler {
+		void OnEvent(Message<8>& message, size_t, bool)
+		{
+			const auto until = profiler::TscClock::now() + std::chrono::nanoseconds(work_ns);
+			while (profiler::TscClock::now() < until) {}
+			const int64_t now = profiler::TscClock::ToNanos(profiler::TscClock::TicksEnd());
+			latency.Record(static_cast<uint64_t>(std::max<int64_t>(0, now - profiler::TscClock::ToNanos(message.words[0]))));
+		}
+		int64_t 						work_ns;
+		profiler::LatencyHistogram 		latency{};
+	};
+
+	//---------------------------------------------------------------------------
+	// One timed run of the sharded disruptor. Returns msgs/sec; tracks the largest shard backlog seen.
+	double RunShardedOnce(const ShardPoint& point, const Settings& settings, profiler::LatencyHistogram* latency, size_t* max_backlog)
+	{
+		disruptor::ShardedDisruptor<Message<8>, uint64_t> sharded(point.shards, point.ring_size);
+		disruptor::ShardedProcessors processors(sharded, [&] (size_t) { return ShardHandler{point.work_ns}; });
+
+		// Consumers on the first cores, writers after them.
+		std::vector<disruptor::ThreadConfig> placement;
+		if (settings.pin)
+			for (size_t s = 0; s < point.shards; ++s)
+				placement.push_back({"shard-" + std::to_string(s), {static_cast<int>(s % std::max(1u, std::thread::hardware_concurrency()))}});
+		processors.Start(placement);
+
+		const size_t per_writer = settings.messages / point.writers;
+		const size_t total = per_writer * point.writers;
+		std::atomic<bool> go{};
+		std::vector<std::thread> threads;
+		for (size_t w = 0; w < point.writers; ++w)
+		{
+			threads.emplace_back([&, w] {
+				if (settings.pin) PinThread(point.shards + w);
+				while (!go.load(std::memory_order_acquire)) {}
+
+				Message<8> message;
+				for (size_t i = 0; i < per_writer; ++i)
+				{
+					message.words[0] = profiler::TscClock::Ticks();
+					while (sharded.Write((w * per_writer + i) % point.keys, message)) {}
+				}
+			});
+		}
+
+		const auto start = profiler::TscClock::now();
+		go.store(true, std::memory_order_release);
+		for (size_t consumed = 0; consumed < total; std::this_thread::yield())
+		{
+			consumed = 0;
+			for (const auto& stats: sharded.Stats())
+			{
+				consumed += stats.consumed;
+				*max_backlog = std::max(*max_backlog, stats.backlog);
+			}
+		}
+		const double seconds = std::chrono::duration<double>(profiler::TscClock::now() - start).count();
+		for (auto& thread: threads)
+			thread.join();
+		processors.Halt();
+		processors.Join();
+
+		if (latency)
+			for (size_t s = 0; s < processors.size(); ++s)
+				latency->Merge(processors.handler(s).latency);
+		return static_cast<double>(total) / seconds;
+	}
+
+	//---------------------------------------------------------------------------
+	json RunShardPoint(const ShardPoint& point, const Settings& settings)
+	{
+		size_t max_backlog = 0;
+		for (size_t i = 0; i < settings.warmup; ++i)
+			RunShardedOnce(point, settings, nullptr, &max_backlog);
+
+		max_backlog = 0;
+		profiler::LatencyHistogram latency;
+		std::vector<double> throughput;
+		for (size_t i = 0; i < settings.repetitions; ++i)
+			throughput.push_back(RunShardedOnce(point, settings, &latency, &max_backlog));
+
+		const auto throughput_stats = profiler::GetStats(throughput);
+		const auto latency_stats = latency.GetStats();
+		return {
+			{"shards", 			point.shards},
+			{"writers", 		point.writers},
+			{"keys", 			point.keys},
+			{"ring_size", 		point.ring_size},
+			{"work_ns", 		point.work_ns},
+			{"repetitions", 	settings.repetitions},
+			{"max_backlog", 	max_backlog},
+			{"msgs_per_sec", 	{{"mean", throughput_stats.mean}, {"min", throughput_stats.min}, {"max", throughput_stats.max}, {"stdev", throughput_stats.stdev}}},
+			{"latency_ns", 		{{"mean", latency_stats.mean}, {"p50", latency_stats.p50}, {"p99", latency_stats.p99},
+								{"p99.9", latency_stats.p999}, {"p99.99", latency_stats.p9999}, {"max", latency_stats.max}}},
+		};
+	}
+
+} // namespace bench
+
+//---------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+	cxxopts::Options options("disruptor_bench", "Disruptor throughput and latency matrix");
+	options.add_options()
+		("h,help", "Print usage")
+		("writers", "Writer counts", cxxopts::value<std::vector<size_t>>()->default_value("1,2,4"))
+		("readers", "Reader counts", cxxopts::value<std::vector<size_t>>()->default_value("1,2"))
+		("write-policies", "BUFFERED, BLOCK, AVAILABILITY and/or SINGLE (one writer only)",
+			cxxopts::value<std::vector<std::string>>()->default_value("BUFFERED,BLOCK,AVAILABILITY,SINGLE"))
+		("read-policies", "BUFFERED, BLOCK, AVAILABILITY and/or SINGLE (one reader only)",
+			cxxopts::value<std::vector<std::string>>()->default_value("BUFFERED,BLOCK,AVAILABILITY,SINGLE"))
+		("ring-sizes", "Ring capacities (powers of 2)", cxxopts::value<std::vector<size_t>>()->default_value("1024,65536"))
+		("batches", "Claim and read batch sizes", cxxopts::value<std::vector<size_t>>()->default_value("1,64"))
+		("element-sizes", "Message sizes in bytes: 8, 16, 64 or 256", cxxopts::value<std::vector<size_t>>()->default_value("8,64,256"))
+		("messages", "Messages per run", cxxopts::value<size_t>()->default_value("1000000"))
+		("warmup", "Untimed runs per point", cxxopts::value<size_t>()->default_value("1"))
+		("repetitions", "Timed runs per point", cxxopts::value<size_t>()->default_value("5"))
+		("wait-strategies", "Wait strategies run on the first writer, reader, ring size and batch values; empty to skip",
+			cxxopts::value<std::vector<std::string>>()->default_value("BusySpin,SpinThenYield,Backoff,Sleeping,Blocking"))
+		("layouts", "PADDED, PACKED and/or SOA, run over the element sizes; empty to skip",
+			cxxopts::value<std::vector<std::string>>()->default_value("PADDED,PACKED,SOA"))
+		("read-paths", "Compare span views with iterator reads on each ring size", cxxopts::value<bool>()->default_value("true"))
+		("shards", "Shard counts for the sharded sweep; empty to skip it", cxxopts::value<std::vector<size_t>>()->default_value("1,2,4,8"))
+		("shard-writers", "Writers in the sharded sweep", cxxopts::value<size_t>()->default_value("1"))
+		("shard-keys", "Distinct keys spread over the shards", cxxopts::value<size_t>()->default_value("1024"))
+		("shard-ring-size", "Ring capacity of each shard", cxxopts::value<size_t>()->default_value("4096"))
+		("shard-work-ns", "Consumer work per event in the sharded sweep", cxxopts::value<int64_t>()->default_value("200"))
+		("pin", "Pin writers and readers to separate cores", cxxopts::value<bool>()->default_value("true"))
+		("o,output", "JSON output file; stdout if empty", cxxopts::value<std::string>()->default_value(""));
+
+	const auto args = options.parse(argc, argv);
+	if (args.count("help"))
+	{
+		std::cout << options.help() << '\n';
+		return 0;
+	}
+
+	const bench::Settings settings{
+		args["messages"].as<size_t>(),
+		args["warmup"].as<size_t>(),
+		args["repetitions"].as<size_t>(),
+		args["pin"].as<bool>()};
+
+	for (size_t size: args["element-sizes"].as<std::vector<size_t>>())
+	{
+		if (std::find(bench::ELEMENT_SIZES.begin(), bench::ELEMENT_SIZES.end(), size) == bench::ELEMENT_SIZES.end())
+		{
+			std::cerr << "Unsupported element size: " << size << '\n';
+			return 1;
+		}
+	}
+	for (size_t size: args["ring-sizes"].as<std::vector<size_t>>())
+	{
+		if (!disruptor::IsValidCapacity(size))
+		{
+			std::cerr << "Ring size must be a power of 2: " << size << '\n';
+			return 1;
+		}
+	}
+	if (!disruptor::IsValidCapacity(args["shard-ring-size"].as<size_t>()))
+	{
+		std::cerr << "Shard ring size must be a power of 2: " << args["shard-ring-size"].as<size_t>() << '\n';
+		return 1;
+	}
+
+	// Names are checked before the first run, so a typo cannot end a long sweep half way.
+	auto usage = [&] (const std::string& error) {
+		std::cerr << error << "\n\n" << options.help() << '\n';
+		return 1;
+	};
+	std::vector<disruptor::PublishPolicy> write_policies, read_policies;
+	try
+	{
+		for (const auto& name: args["write-policies"].as<std::vector<std::string>>())
+			write_policies.push_back(bench::ToPolicy(name));
+		for (const auto& name: args["read-policies"].as<std::vector<std::string>>())
+			read_policies.push_back(bench::ToPolicy(name));
+	}
+	catch (const std::invalid_argument& e)
+	{
+		return usage(e.what());
+	}
+	for (const auto& wait: args["wait-strategies"].as<std::vector<std::string>>())
+	{
+		if (std::find(bench::WAIT_STRATEGIES.begin(), bench::WAIT_STRATEGIES.end(), wait) == bench::WAIT_STRATEGIES.end())
+			return usage("Unknown wait strategy: " + wait);
+	}
+	for (const auto& layout: args["layouts"].as<std::vector<std::string>>())
+	{
+		if (std::find(bench::LAYOUTS.begin(), bench::LAYOUTS.end(), layout) == bench::LAYOUTS.end())
+			return usage("Unknown layout: " + layout);
+	}
+
+	json results = json::array();
+	for (size_t writers: args["writers"].as<std::vector<size_t>>())
+	for (size_t readers: args["readers"].as<std::vector<size_t>>())
+	for (auto write_policy: write_policies)
+	for (auto read_policy: read_policies)
+	for (size_t ring_size: args["ring-sizes"].as<std::vector<size_t>>())
+	for (size_t batch: args["batches"].as<std::vector<size_t>>())
+	for (size_t element_size: args["element-sizes"].as<std::vector<size_t>>())
+	{
+		const bench::Point point{writers, readers, write_policy, read_policy, ring_size, batch, element_size};
+		// A SINGLE cursor has exactly one owner, and competing readers share theirs.
+		if ((point.write_policy == disruptor::PublishPolicy::SINGLE && writers > 1) || (point.read_policy == disruptor::PublishPolicy::SINGLE && readers > 1))
+			continue;
+		auto result = bench::Dispatch(point, settings);
+		std::cerr << result.dump() << '\n';
+		results.push_back(std::move(result));
+	}
+
+	json waits = json::array();
+	for (const auto& wait: args["wait-strategies"].as<std::vector<std::string>>())
+	{
+		const bench::Point point{args["writers"].as<std::vector<size_t>>().front(), args["readers"].as<std::vector<size_t>>().front(),
+								disruptor::PublishPolicy::BLOCK, disruptor::PublishPolicy::BLOCK,
+								args["ring-sizes"].as<std::vector<size_t>>().front(), args["batches"].as<std::vector<size_t>>().front(), 8};
+		auto result = bench::RunWaitPoint(wait, point, settings);
+		std::cerr << result.dump() << '\n';
+		waits.push_back(std::move(result));
+	}
+
+	json layouts = json::array();
+	for (const auto& layout: args["layouts"].as<std::vector<std::string>>())
+	for (size_t element_size: args["element-sizes"].as<std::vector<size_t>>())
+	{
+		const bench::Point point{1, 1, disruptor::PublishPolicy::SINGLE, disruptor::PublishPolicy::SINGLE,
+								args["ring-sizes"].as<std::vector<size_t>>().front(), args["batches"].as<std::vector<size_t>>().front(), element_size};
+		auto result = bench::RunLayoutPoint(layout, point, settings);
+		std::cerr << result.dump() << '\n';
+		layouts.push_back(std::move(result));
+	}
+
+	json read_paths = json::array();
+	if (args["read-paths"].as<bool>())
+	{
+		for (size_t ring_size: args["ring-sizes"].as<std::vector<size_t>>())
+		{
+			for (auto result: {bench::RunReadPathPoint<false>(ring_size, settings), bench::RunReadPathPoint<true>(ring_size, settings)})
+			{
+				std::cerr << result.dump() << '\n';
+				read_paths.push_back(std::move(result));
+			}
+			if (read_paths[read_paths.size() - 2]["sum"] != read_paths.back()["sum"])
+			{
+				std::cerr << "Read paths disagree on the events\n";
+				return 1;
+			}
+		}
+	}
+
+	json sharding = json::array();
+	for (size_t shards: args["shards"].as<std::vector<size_t>>())
+	{
+		const bench::ShardPoint point{shards, args["shard-writers"].as<size_t>(), args["shard-keys"].as<size_t>(),
+									args["shard-ring-size"].as<size_t>(), args["shard-work-ns"].as<int64_t>()};
+		auto result = bench::RunShardPoint(point, settings);
+		std::cerr << result.dump() << '\n';
+		sharding.push_back(std::move(result));
+	}
+
+	const json report{
+		{"tsc_clock", 	profiler::TscClock::is_tsc()},
+		{"topology", 	disruptor::CpuTopology::Detect().Describe()},
+		{"messages", 	settings.messages},
+		{"warmup", 		settings.warmup},
+		{"repetitions", settings.repetitions},
+		{"pinned", 		settings.pin},
+		{"results", 	std::move(results)},
+		{"wait_strategies", std::move(waits)},
+		{"layouts", 	std::move(layouts)},
+		{"read_paths", 	std::move(read_paths)},
+		{"sharding", 	std::move(sharding)}};
+
+	const auto output = args["output"].as<std::string>();
+	if (output.empty())
+	{
+		std::cout << report.dump(2) << '\n';
+	}
+	else
+	{
+		std::ofstream(output) << report.dump(2) << '\n';
+	}
+	return 0;
+}
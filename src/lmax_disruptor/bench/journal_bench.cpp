@@ -0,0 +1,231 @@
+// Sustained journal throughput.
+// A writer thread publishes into a ring drained by a JournalHandler on its own thread; every point
+// (event size x sync mode) is timed from the first write until the journal has appended the last
+// event, and reported in MB/s of journal bytes, framing included, along with the read-back rate.
+//
+//		journal_bench --directory /data/bench --event-sizes 64,1024 --sync NONE,ASYNC --output journal.json
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cxxopts.hpp>
+#include <nlohmann/json.hpp>
+
+#include "disruptor.hpp"
+#include "event_processor.hpp"
+#include "journal.hpp"
+#include "scoped_profiler.hpp"
+
+using json = nlohmann::json;
+
+namespace bench {
+
+	template <size_t Bytes>
+	struct Event {
+		std::array<uint64_t, Bytes/sizeof(uint64_t)> words{};
+	};
+
+	constexpr std::array<size_t, 4> EVENT_SIZES{32, 64, 256, 1024};
+
+	//---------------------------------------------------------------------------
+	struct Point {
+		size_t 					event_size;
+		disruptor::SyncMode 	sync;
+	};
+
+	struct Settings {
+		std::filesystem::path 	directory;
+		size_t 					messages;
+		size_t 					ring_size;
+		size_t 					segment_size;
+		size_t 					sync_bytes;
+		size_t 					repetitions;
+	};
+
+	struct Rates {
+		double 					write_mb_per_sec;
+		double 					read_mb_per_sec;
+	};
+
+	//---------------------------------------------------------------------------
+	std::string ToString(disruptor::SyncMode sync)
+	{
+		switch (sync)
+		{
+			case disruptor::SyncMode::NONE: 	return "NONE";
+			case disruptor::SyncMode::ASYNC: 	return "ASYNC";
+			case disruptor::SyncMode::SYNC: 	return "SYNC";
+		}
+		return "UNKNOWN";
+	}
+
+	disruptor::SyncMode ToSyncMode(const std::string& name)
+	{
+		if (name == "NONE") 	return disruptor::SyncMode::NONE;
+		if (name == "ASYNC") 	return disruptor::SyncMode::ASYNC;
+		if (name == "SYNC") 	return disruptor::SyncMode::SYNC;
+		throw std::invalid_argument("Unknown sync mode: " + name);
+	}
+
+	//---------------------------------------------------------------------------
+	// One run into a fresh journal, which is removed afterwards.
+	template <size_t Bytes>
+	Rates RunOnce(const Point& point, const Settings& settings)
+	{
+		using clock = std::chrono::steady_clock;
+		std::filesystem::remove_all(settings.directory);
+
+		auto disruptor = disruptor::MakeSingleDisruptor<Event<Bytes>, disruptor::PublishPolicy::SINGLE, disruptor::PublishPolicy::SINGLE>(
+			disruptor::ConsumerMode::COMPETING, settings.ring_size);
+		disruptor::BatchEventProcessor journaller(disruptor.CreateReader(),
+			disruptor::JournalHandler<Event<Bytes>>({settings.directory, "bench", settings.segment_size, point.sync, settings.sync_bytes}));
+		journaller.Start();
+
+		auto writer = disruptor.CreateWriter();
+		Event<Bytes> event;
+		const auto start = clock::now();
+		for (size_t i = 0; i < settings.messages; ++i)
+		{
+			event.words[0] = i;
+			while (writer.Write(event, i + 1 == settings.messages)) {}
+		}
+		// The journal is durable as the mode promises once the processor has shut down.
+		journaller.Join();
+		const double write_seconds = std::chrono::duration<double>(clock::now() - start).count();
+		const double bytes = static_cast<double>(journaller.handler().writer().bytes_written());
+
+		const auto read_start = clock::now();
+		disruptor::JournalReader reader(settings.directory, "bench");
+		disruptor::JournalFrame frame;
+		size_t frames = 0;
+		while (reader.Next(frame) == disruptor::JournalStatus::OK)
+			++frames;
+		const double read_seconds = std::chrono::duration<double>(clock::now() - read_start).count();
+		if (frames != settings.messages)
+			throw std::runtime_error("journal read back " + std::to_string(frames) + " of " + std::to_string(settings.messages) + " events");
+
+		std::filesystem::remove_all(settings.directory);
+		return {bytes / write_seconds / 1e6, bytes / read_seconds / 1e6};
+	}
+
+	//---------------------------------------------------------------------------
+	template <size_t Bytes>
+	json RunPoint(const Point& point, const Settings& settings)
+	{
+		std::vector<double> write_rates, read_rates;
+		for (size_t i = 0; i < settings.repetitions; ++i)
+		{
+			const auto rates = RunOnce<Bytes>(point, settings);
+			write_rates.push_back(rates.write_mb_per_sec);
+			read_rates.push_back(rates.read_mb_per_sec);
+		}
+
+		const auto write_stats = profiler::GetStats(write_rates);
+		const auto read_stats = profiler::GetStats(read_rates);
+		return {
+			{"event_size", 		point.event_size},
+			{"frame_size", 		disruptor::journal::FrameBytes(point.event_size)},
+			{"sync", 			ToString(point.sync)},
+			{"repetitions", 	settings.repetitions},
+			{"write_mb_per_sec", {{"mean", write_stats.mean}, {"min", write_stats.min}, {"max", write_stats.max}, {"stdev", write_stats.stdev}}},
+			{"read_mb_per_sec", {{"mean", read_stats.mean}, {"min", read_stats.min}, {"max", read_stats.max}, {"stdev", read_stats.stdev}}},
+		};
+	}
+
+	json Dispatch(const Point& point, const Settings& settings)
+	{
+		switch (point.event_size)
+		{
+			case 32: 	return RunPoint<32>(point, settings);
+			case 64: 	return RunPoint<64>(point, settings);
+			case 256: 	return RunPoint<256>(point, settings);
+			default: 	return RunPoint<1024>(point, settings);
+		}
+	}
+
+} // namespace bench
+
+//---------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+	cxxopts::Options options("journal_bench", "Sustained journal MB/s");
+	options.add_options()
+		("h,help", "Print usage")
+		("directory", "Scratch directory for the journal; removed between runs",
+			cxxopts::value<std::string>()->default_value((std::filesystem::temp_directory_path() / "journal_bench").string()))
+		("event-sizes", "Event sizes in bytes: 32, 64, 256 or 1024", cxxopts::value<std::vector<size_t>>()->default_value("64,256,1024"))
+		("sync", "NONE, ASYNC and/or SYNC", cxxopts::value<std::vector<std::string>>()->default_value("NONE,ASYNC,SYNC"))
+		("sync-bytes", "Journal bytes between syncs", cxxopts::value<size_t>()->default_value("1048576"))
+		("segment-size", "Journal segment size in bytes", cxxopts::value<size_t>()->default_value("67108864"))
+		("ring-size", "Ring capacity (power of 2)", cxxopts::value<size_t>()->default_value("65536"))
+		("messages", "Events per run", cxxopts::value<size_t>()->default_value("1000000"))
+		("repetitions", "Timed runs per point", cxxopts::value<size_t>()->default_value("3"))
+		("o,output", "JSON output file; stdout if empty", cxxopts::value<std::string>()->default_value(""));
+
+	const auto args = options.parse(argc, argv);
+	if (args.count("help"))
+	{
+		std::cout << options.help() << '\n';
+		return 0;
+	}
+
+	const bench::Settings settings{
+		args["directory"].as<std::string>(),
+		args["messages"].as<size_t>(),
+		args["ring-size"].as<size_t>(),
+		args["segment-size"].as<size_t>(),
+		args["sync-bytes"].as<size_t>(),
+		args["repetitions"].as<size_t>()};
+
+	if (!disruptor::IsValidCapacity(settings.ring_size))
+	{
+		std::cerr << "Ring size must be a power of 2: " << settings.ring_size << '\n';
+		return 1;
+	}
+	for (size_t size: args["event-sizes"].as<std::vector<size_t>>())
+	{
+		if (std::find(bench::EVENT_SIZES.begin(), bench::EVENT_SIZES.end(), size) == bench::EVENT_SIZES.end())
+		{
+			std::cerr << "Unsupported event size: " << size << '\n';
+			return 1;
+		}
+	}
+
+	json results = json::array();
+	for (size_t event_size: args["event-sizes"].as<std::vector<size_t>>())
+	for (const auto& sync: args["sync"].as<std::vector<std::string>>())
+	{
+		auto result = bench::Dispatch({event_size, bench::ToSyncMode(sync)}, settings);
+		std::cerr << result.dump() << '\n';
+		results.push_back(std::move(result));
+	}
+
+	const json report{
+		{"directory", 		settings.directory.string()},
+		{"messages", 		settings.messages},
+		{"ring_size", 		settings.ring_size},
+		{"segment_size", 	settings.segment_size},
+		{"sync_bytes", 		settings.sync_bytes},
+		{"repetitions", 	settings.repetitions},
+		{"results", 		std::move(results)}};
+
+	const auto output = args["output"].as<std::string>();
+	if (output.empty())
+	{
+		std::cout << report.dump(2) << '\n';
+	}
+	else
+	{
+		std::ofstream(output) << report.dump(2) << '\n';
+	}
+	return 0;
+}
@@ -0,0 +1,332 @@
+// Order book cost per message on a synthetic ITCH-like feed.
+// The feed is mostly adds and deletes close to the touch, with some executions, partial cancels and
+// replaces, over a book kept at a steady number of live orders, as on a busy equity. It is generated
+// once, then replayed two ways:
+//	- direct: applied to an OrderBook on one thread, timing every message for ns/message and percentiles;
+//	- pipeline: published into a ring and applied by an OrderBookHandler on its own processor, which
+//	  writes top-of-book changes to an output ring drained by a third thread; reported as msgs/s.
+//
+//		order_book_bench --messages 5000000 --live-orders 10000 --output book.json
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <cxxopts.hpp>
+#include <nlohmann/json.hpp>
+
+#include "disruptor.hpp"
+#include "event_processor.hpp"
+#include "histogram.hpp"
+#include "order_book.hpp"
+#include "scoped_profiler.hpp"
+#include "tsc_clock.hpp"
+
+using json = nlohmann::json;
+
+namespace bench {
+
+	using disruptor::BookEvent;
+	using disruptor::BookEventType;
+	using disruptor::PublishPolicy;
+	using disruptor::Side;
+
+	//---------------------------------------------------------------------------
+	struct Settings {
+		size_t 					messages;
+		size_t 					live_orders;
+		int64_t 				price_levels;
+		size_t 					ring_size;
+		size_t 					repetitions;
+		uint64_t 				seed;
+	};
+
+	struct Feed {
+		std::vector<BookEvent> 	events;
+		size_t 					counts[4]{};
+	};
+
+	//---------------------------------------------------------------------------
+	const char* ToString(BookEventType type)
+	{
+		switch (type)
+		{
+			case BookEventType::ADD: 		return "add";
+			case BookEventType::MODIFY: 	return "modify";
+			case BookEventType::CANCEL: 	return "cancel";
+			case BookEventType::EXECUTE: 	return "execute";
+		}
+		return "unknown";
+	}
+
+	disruptor::BookConfig MakeConfig(const Settings& settings)
+	{
+		return {1, settings.price_levels, settings.live_orders * 2};
+	}
+
+	//---------------------------------------------------------------------------
+	// Every event applies: only live orders are cancelled, executed or replaced.
+	Feed MakeFeed(const Settings& settings)
+	{
+		struct Live {
+			Side 				side;
+			int64_t 			price;
+			uint32_t 			quantity;
+		};
+
+		std::mt19937_64 rng(settings.seed);
+		std::geometric_distribution<int64_t> depth(0.15);
+		std::uniform_int_distribution<uint32_t> lot(1, 10);
+		std::uniform_int_distribution<int> percent(0, 99);
+		std::unordered_map<uint64_t, Live> live;
+		std::vector<uint64_t> ids;
+		std::unordered_map<uint64_t, size_t> positions;
+		int64_t mid = settings.price_levels / 2;
+		uint64_t next_id = 1;
+
+		auto forget = [&] (uint64_t id) {
+			const size_t pos = positions[id];
+			positions[ids.back()] = pos;
+			ids[pos] = ids.back();
+			ids.pop_back();
+			positions.erase(id);
+			live.erase(id);
+		};
+		// Orders rest a few ticks behind the touch, the odd one further out.
+		auto price_for = [&] (Side side) {
+			const int64_t offset = 1 + depth(rng);
+			return std::clamp(side == Side::BUY ? mid - offset : mid + offset, int64_t{1}, settings.price_levels);
+		};
+
+		Feed feed;
+		feed.events.reserve(settings.messages);
+		while (feed.events.size() < settings.messages)
+		{
+			const int roll = percent(rng);
+			// Drift the mid now and then so levels empty and best prices move.
+			if (roll == 0)
+				mid = std::clamp<int64_t>(mid + (rng() % 2 ? 1 : -1), settings.price_levels / 4, settings.price_levels * 3 / 4);
+
+			// Adds outnumber deletes until the book holds live_orders, then deletes win slightly.
+			if (ids.empty() || roll < (ids.size() < settings.live_orders ? 60 : 40))
+			{
+				const uint64_t id = next_id++;
+				const Side side = rng() % 2 ? Side::BUY : Side::SELL;
+				const Live order{side, price_for(side), lot(rng) * 100};
+				feed.events.push_back({BookEventType::ADD, side, order.quantity, id, order.price});
+				positions[id] = ids.size();
+				ids.push_back(id);
+				live[id] = order;
+				continue;
+			}
+
+			const uint64_t id = ids[rng() % ids.size()];
+			auto& order = live[id];
+			if (roll < 83)
+			{
+				// Deletes, with a few partial cancels.
+				const uint32_t quantity = roll < 80 ? 0 : std::min<uint32_t>(order.quantity, 100);
+				feed.events.push_back({BookEventType::CANCEL, order.side, quantity, id, 0});
+				if (quantity == 0 || (order.quantity -= quantity) == 0) forget(id);
+			}
+			else if (roll < 95)
+			{
+				const uint32_t quantity = std::min<uint32_t>(order.quantity, 100);
+				feed.events.push_back({BookEventType::EXECUTE, order.side, quantity, id, 0});
+				if ((order.quantity -= quantity) == 0) forget(id);
+			}
+			else
+			{
+				order.price = price_for(order.side);
+				order.quantity = lot(rng) * 100;
+				feed.events.push_back({BookEventType::MODIFY, order.side, order.quantity, id, order.price});
+			}
+		}
+
+		for (const auto& event: feed.events)
+			++feed.counts[static_cast<size_t>(event.type)];
+		return feed;
+	}
+
+	//---------------------------------------------------------------------------
+	// Returns ns/message over the whole replay; every message's own time goes to latency.
+	double RunDirect(const Feed& feed, const Settings& settings, profiler::LatencyHistogram& latency)
+	{
+		disruptor::OrderBook book(MakeConfig(settings));
+		size_t rejected = 0;
+		const auto start = profiler::TscClock::now();
+		for (const auto& event: feed.events)
+		{
+			const uint64_t begin = profiler::TscClock::Ticks();
+			rejected += book.Apply(event) != disruptor::BookStatus::OK;
+			const uint64_t end = profiler::TscClock::TicksEnd();
+			latency.Record(static_cast<uint64_t>(profiler::TscClock::ToNanos(end) - profiler::TscClock::ToNanos(begin)));
+		}
+		const double seconds = std::chrono::duration<double>(profiler::TscClock::now() - start).count();
+		if (rejected)
+			throw std::runtime_error("book rejected " + std::to_string(rejected) + " feed messages");
+		return seconds * 1e9 / static_cast<double>(feed.events.size());
+	}
+
+	struct PipelineRun {
+		double 					msgs_per_sec;
+		size_t 					tops;
+	};
+
+	PipelineRun RunPipeline(const Feed& feed, const Settings& settings)
+	{
+		auto input = disruptor::MakeSingleDisruptor<BookEvent, PublishPolicy::SINGLE, PublishPolicy::SINGLE>(
+			disruptor::ConsumerMode::COMPETING, settings.ring_size);
+		auto output = disruptor::MakeSingleDisruptor<disruptor::TopOfBook, PublishPolicy::SINGLE, PublishPolicy::SINGLE>(
+			disruptor::ConsumerMode::COMPETING, settings.ring_size);
+		disruptor::BatchEventProcessor book(input.CreateReader(), disruptor::OrderBookHandler(MakeConfig(settings), output.CreateWriter()));
+
+		std::thread drain([reader = output.CreateReader()] () mutable {
+			for (bool eof = false; !eof;)
+			{
+				auto result = reader.Read(1024);
+				if (result.err) continue;
+				for (auto iter = result.begin; iter != result.end; ++iter)
+					eof |= (*iter).is_eof();
+				result.Release();
+			}
+		});
+		book.Start();
+
+		auto writer = input.CreateWriter();
+		const auto start = profiler::TscClock::now();
+		for (size_t i = 0; i < feed.events.size(); ++i)
+			while (writer.Write(feed.events[i], i + 1 == feed.events.size())) {}
+		book.Join();
+		const double seconds = std::chrono::duration<double>(profiler::TscClock::now() - start).count();
+		drain.join();
+
+		if (book.handler().rejected())
+			throw std::runtime_error("book rejected " + std::to_string(book.handler().rejected()) + " feed messages");
+		return {static_cast<double>(feed.events.size()) / seconds, book.handler().published()};
+	}
+
+	//---------------------------------------------------------------------------
+	json RunDirectPoint(const Feed& feed, const Settings& settings)
+	{
+		profiler::LatencyHistogram warmup, latency;
+		RunDirect(feed, settings, warmup);
+
+		std::vector<double> ns_per_msg;
+		for (size_t i = 0; i < settings.repetitions; ++i)
+			ns_per_msg.push_back(RunDirect(feed, settings, latency));
+
+		const auto ns_stats = profiler::GetStats(ns_per_msg);
+		const auto latency_stats = latency.GetStats();
+		return {
+			{"mode", 			"direct"},
+			{"repetitions", 	settings.repetitions},
+			{"ns_per_msg", 		{{"mean", ns_stats.mean}, {"min", ns_stats.min}, {"max", ns_stats.max}, {"stdev", ns_stats.stdev}}},
+			{"latency_ns", 		{{"mean", latency_stats.mean}, {"p50", latency_stats.p50}, {"p99", latency_stats.p99},
+								{"p99.9", latency_stats.p999}, {"p99.99", latency_stats.p9999}, {"max", latency_stats.max}}},
+		};
+	}
+
+	json RunPipelinePoint(const Feed& feed, const Settings& settings)
+	{
+		RunPipeline(feed, settings);
+
+		std::vector<double> msgs_per_sec, ns_per_msg;
+		size_t tops = 0;
+		for (size_t i = 0; i < settings.repetitions; ++i)
+		{
+			const auto run = RunPipeline(feed, settings);
+			msgs_per_sec.push_back(run.msgs_per_sec);
+			ns_per_msg.push_back(1e9 / run.msgs_per_sec);
+			tops = run.tops;
+		}
+
+		const auto msgs_stats = profiler::GetStats(msgs_per_sec);
+		const auto ns_stats = profiler::GetStats(ns_per_msg);
+		return {
+			{"mode", 			"pipeline"},
+			{"repetitions", 	settings.repetitions},
+			{"ring_size", 		settings.ring_size},
+			{"top_of_book_updates", tops},
+			{"msgs_per_sec", 	{{"mean", msgs_stats.mean}, {"min", msgs_stats.min}, {"max", msgs_stats.max}, {"stdev", msgs_stats.stdev}}},
+			{"ns_per_msg", 		{{"mean", ns_stats.mean}, {"min", ns_stats.min}, {"max", ns_stats.max}, {"stdev", ns_stats.stdev}}},
+		};
+	}
+
+} // namespace bench
+
+//---------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+	cxxopts::Options options("order_book_bench", "Order book ns/message on a synthetic ITCH-like feed");
+	options.add_options()
+		("h,help", "Print usage")
+		("messages", "Feed messages per run", cxxopts::value<size_t>()->default_value("5000000"))
+		("live-orders", "Resting orders the feed keeps the book at", cxxopts::value<size_t>()->default_value("10000"))
+		("price-levels", "Ticks in the book's price range", cxxopts::value<int64_t>()->default_value("4096"))
+		("ring-size", "Input and output ring capacity (power of 2)", cxxopts::value<size_t>()->default_value("65536"))
+		("repetitions", "Timed runs per mode", cxxopts::value<size_t>()->default_value("5"))
+		("seed", "Feed generator seed", cxxopts::value<uint64_t>()->default_value("42"))
+		("o,output", "JSON output file; stdout if empty", cxxopts::value<std::string>()->default_value(""));
+
+	const auto args = options.parse(argc, argv);
+	if (args.count("help"))
+	{
+		std::cout << options.help() << '\n';
+		return 0;
+	}
+
+	const bench::Settings settings{
+		args["messages"].as<size_t>(),
+		args["live-orders"].as<size_t>(),
+		args["price-levels"].as<int64_t>(),
+		args["ring-size"].as<size_t>(),
+		args["repetitions"].as<size_t>(),
+		args["seed"].as<uint64_t>()};
+
+	if (!disruptor::IsValidCapacity(settings.ring_size) || settings.price_levels < 64 || settings.live_orders == 0)
+	{
+		std::cerr << "Ring size must be a power of 2, with at least 64 price levels and one live order\n";
+		return 1;
+	}
+
+	const auto feed = bench::MakeFeed(settings);
+	json mix;
+	for (size_t type = 0; type < 4; ++type)
+		mix[bench::ToString(static_cast<disruptor::BookEventType>(type))] = static_cast<double>(feed.counts[type]) / static_cast<double>(feed.events.size());
+
+	json results = json::array();
+	for (auto result: {bench::RunDirectPoint(feed, settings), bench::RunPipelinePoint(feed, settings)})
+	{
+		std::cerr << result.dump() << '\n';
+		results.push_back(std::move(result));
+	}
+
+	const json report{
+		{"messages", 		settings.messages},
+		{"live_orders", 	settings.live_orders},
+		{"price_levels", 	settings.price_levels},
+		{"seed", 			settings.seed},
+		{"mix", 			std::move(mix)},
+		{"results", 		std::move(results)}};
+
+	const auto output = args["output"].as<std::string>();
+	if (output.empty())
+	{
+		std::cout << report.dump(2) << '\n';
+	}
+	else
+	{
+		std::ofstream(output) << report.dump(2) << '\n';
+	}
+	return 0;
+}
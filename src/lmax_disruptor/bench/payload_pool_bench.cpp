@@ -0,0 +1,239 @@
+// Heap traffic and throughput of large events: copied into the ring versus referenced from a PayloadPool.
+// Events carry a string and a vector, as real order or book events do. Copying them through the ring
+// costs heap allocations on every event; the pooled ring carries a PayloadHandle and reuses payloads
+// built once up front. Global operator new is counted over the timed part of each run, all threads included.
+//
+//		payload_pool_bench --messages 2000000 --fills 8 --output pool.json
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <cxxopts.hpp>
+#include <nlohmann/json.hpp>
+
+#include "disruptor.hpp"
+#include "event_processor.hpp"
+#include "payload_pool.hpp"
+#include "scoped_profiler.hpp"
+
+using json = nlohmann::json;
+
+namespace bench {
+	std::atomic<size_t> allocations{};
+}
+
+//---------------------------------------------------------------------------
+// Counts every allocation made by the process.
+void* operator new(size_t bytes)
+{
+	bench::allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* ptr = std::malloc(bytes ? bytes : 1)) return ptr;
+	throw std::bad_alloc();
+}
+
+void* operator new(size_t bytes, std::align_val_t alignment)
+{
+	bench::allocations.fetch_add(1, std::memory_order_relaxed);
+	const size_t align = static_cast<size_t>(alignment);
+	if (void* ptr = std::aligned_alloc(align, (std::max<size_t>(bytes, 1) + align - 1) / align * align)) return ptr;
+	throw std::bad_alloc();
+}
+
+// Out of line, or the compiler inlines free() into delete expressions and flags them as mismatched.
+[[gnu::noinline]] void operator delete(void* ptr) noexcept 								{ std::free(ptr); }
+[[gnu::noinline]] void operator delete(void* ptr, size_t) noexcept 						{ std::free(ptr); }
+[[gnu::noinline]] void operator delete(void* ptr, std::align_val_t) noexcept 			{ std::free(ptr); }
+[[gnu::noinline]] void operator delete(void* ptr, size_t, std::align_val_t) noexcept 	{ std::free(ptr); }
+
+namespace bench {
+
+	using disruptor::PublishPolicy;
+
+	//---------------------------------------------------------------------------
+	struct Order {
+		uint64_t 				id{};
+		// Longer than any small-string buffer.
+		std::string 			account;
+		std::vector<uint64_t> 	fills;
+	};
+
+	const std::string ACCOUNT = "ACCOUNT-0000000000000042";
+
+	struct Settings {
+		size_t 					messages;
+		size_t 					ring_size;
+		size_t 					pool_size;
+		size_t 					fills;
+		size_t 					repetitions;
+	};
+
+	struct Run {
+		double 					seconds;
+		size_t 					allocations;
+		uint64_t 				checksum;
+	};
+
+	//---------------------------------------------------------------------------
+	struct OrderHandler {
+		void 		OnEvent(const Order& order, size_t, bool)
+		{
+			checksum += order.id + order.account.size();
+			for (auto fill: order.fills) checksum += fill;
+		}
+		uint64_t 	checksum{};
+	};
+
+	// Whole orders copied through the ring: built by the producer, moved into the slot.
+	Run RunCopied(const Settings& settings)
+	{
+		auto disruptor = disruptor::MakeSingleDisruptor<Order, PublishPolicy::SINGLE, PublishPolicy::SINGLE>(
+			disruptor::ConsumerMode::COMPETING, settings.ring_size);
+		disruptor::BatchEventProcessor consumer(disruptor.CreateReader(), OrderHandler{});
+		auto writer = disruptor.CreateWriter();
+		consumer.Start();
+
+		const size_t before = allocations.load();
+		const auto start = std::chrono::steady_clock::now();
+		for (uint64_t i = 0; i < settings.messages; ++i)
+		{
+			Order order{i, ACCOUNT, std::vector<uint64_t>(settings.fills, i)};
+			while (writer.Write(std::move(order), i + 1 == settings.messages)) {}
+		}
+		consumer.Join();
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		return {seconds, allocations.load() - before, consumer.handler().checksum};
+	}
+
+	// Handles through the ring, orders filled in place in the pool.
+	Run RunPooled(const Settings& settings)
+	{
+		auto pool = disruptor::PayloadPool<Order>::Create(settings.pool_size, 1, [&] (Order& order) {
+			order.account.reserve(ACCOUNT.size());
+			order.fills.reserve(settings.fills);
+		});
+		auto disruptor = disruptor::MakeSingleDisruptor<disruptor::PayloadHandle, PublishPolicy::SINGLE, PublishPolicy::SINGLE>(
+			disruptor::ConsumerMode::COMPETING, settings.ring_size);
+		disruptor::BatchEventProcessor consumer(disruptor.CreateReader(), disruptor::PooledHandler(OrderHandler{}, pool));
+		auto writer = disruptor.CreateWriter();
+		auto cache = pool->CreateCache();
+		consumer.Start();
+
+		const size_t before = allocations.load();
+		const auto start = std::chrono::steady_clock::now();
+		for (uint64_t i = 0; i < settings.messages; ++i)
+		{
+			disruptor::PayloadHandle handle;
+			while (!(handle = cache.Acquire()).valid()) {}
+			auto& order = (*pool)[handle];
+			order.id = i;
+			order.account.assign(ACCOUNT);
+			order.fills.assign(settings.fills, i);
+			while (writer.Write(handle, i + 1 == settings.messages)) {}
+		}
+		consumer.Join();
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		return {seconds, allocations.load() - before, consumer.handler().handler().checksum};
+	}
+
+	//---------------------------------------------------------------------------
+	json RunPoint(const char* name, Run (*run)(const Settings&), const Settings& settings)
+	{
+		run(settings);
+
+		std::vector<double> msgs_per_sec, allocs_per_msg;
+		uint64_t checksum = 0;
+		for (size_t i = 0; i < settings.repetitions; ++i)
+		{
+			const auto result = run(settings);
+			msgs_per_sec.push_back(static_cast<double>(settings.messages) / result.seconds);
+			allocs_per_msg.push_back(static_cast<double>(result.allocations) / static_cast<double>(settings.messages));
+			checksum = result.checksum;
+		}
+
+		const auto msgs_stats = profiler::GetStats(msgs_per_sec);
+		const auto alloc_stats = profiler::GetStats(allocs_per_msg);
+		return {
+			{"ring", 			name},
+			{"repetitions", 	settings.repetitions},
+			{"checksum", 		checksum},
+			{"msgs_per_sec", 	{{"mean", msgs_stats.mean}, {"min", msgs_stats.min}, {"max", msgs_stats.max}, {"stdev", msgs_stats.stdev}}},
+			{"allocations_per_msg", {{"mean", alloc_stats.mean}, {"min", alloc_stats.min}, {"max", alloc_stats.max}}},
+		};
+	}
+
+} // namespace bench
+
+//---------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+	cxxopts::Options options("payload_pool_bench", "Allocations and throughput of copied versus pooled large events");
+	options.add_options()
+		("h,help", "Print usage")
+		("messages", "Events per run", cxxopts::value<size_t>()->default_value("2000000"))
+		("ring-size", "Ring capacity (power of 2)", cxxopts::value<size_t>()->default_value("4096"))
+		("pool-size", "Pooled payloads; more than the ring size", cxxopts::value<size_t>()->default_value("8192"))
+		("fills", "Fills per order", cxxopts::value<size_t>()->default_value("8"))
+		("repetitions", "Timed runs per ring", cxxopts::value<size_t>()->default_value("5"))
+		("o,output", "JSON output file; stdout if empty", cxxopts::value<std::string>()->default_value(""));
+
+	const auto args = options.parse(argc, argv);
+	if (args.count("help"))
+	{
+		std::cout << options.help() << '\n';
+		return 0;
+	}
+
+	const bench::Settings settings{
+		args["messages"].as<size_t>(),
+		args["ring-size"].as<size_t>(),
+		args["pool-size"].as<size_t>(),
+		args["fills"].as<size_t>(),
+		args["repetitions"].as<size_t>()};
+
+	if (!disruptor::IsValidCapacity(settings.ring_size) || settings.pool_size <= settings.ring_size)
+	{
+		std::cerr << "Ring size must be a power of 2 and the pool larger than the ring\n";
+		return 1;
+	}
+
+	json results = json::array();
+	for (auto result: {
+			bench::RunPoint("copied", bench::RunCopied, settings),
+			bench::RunPoint("pooled", bench::RunPooled, settings)})
+	{
+		std::cerr << result.dump() << '\n';
+		results.push_back(std::move(result));
+	}
+	if (results[0]["checksum"] != results[1]["checksum"])
+	{
+		std::cerr << "Rings disagree on the events\n";
+		return 1;
+	}
+
+	const json report{
+		{"messages", 		settings.messages},
+		{"ring_size", 		settings.ring_size},
+		{"pool_size", 		settings.pool_size},
+		{"fills", 			settings.fills},
+		{"repetitions", 	settings.repetitions},
+		{"results", 		std::move(results)}};
+
+	const auto output = args["output"].as<std::string>();
+	if (output.empty())
+	{
+		std::cout << report.dump(2) << '\n';
+	}
+	else
+	{
+		std::ofstream(output) << report.dump(2) << '\n';
+	}
+	return 0;
+}
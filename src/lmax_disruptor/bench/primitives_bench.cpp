@@ -0,0 +1,179 @@
+// Per-call cost of the building blocks the disruptor benchmarks lean on: histogram records and clock reads,
+// and the cost of a round of barrier::Barrier against std::barrier with every thread taking part.
+// Each measurement is run once to warm up and then repeatedly; ns per call or per round go to JSON.
+//
+//		primitives_bench --calls 10000000 --rounds 100000 --barrier-threads 4 --output primitives.json
+
+#include <algorithm>
+#include <barrier>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cxxopts.hpp>
+#include <nlohmann/json.hpp>
+
+#include "barrier.hpp"
+#include "histogram.hpp"
+#include "scoped_profiler.hpp"
+#include "tsc_clock.hpp"
+
+using json = nlohmann::json;
+
+namespace bench {
+
+	// Results of the timed calls end up here, so the calls cannot be optimised away.
+	volatile uint64_t 			sink;
+
+	struct Settings {
+		size_t 					calls;
+		size_t 					rounds;
+		size_t 					barrier_threads;
+		size_t 					repetitions;
+	};
+
+	//---------------------------------------------------------------------------
+	// Times calls of op(i) and returns ns per call.
+	template <typename Op>
+	double NanosPerCall(size_t calls, Op&& op)
+	{
+		uint64_t total = 0;
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < calls; ++i)
+			total += static_cast<uint64_t>(op(i));
+		const double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		sink = total;
+		return elapsed / static_cast<double>(calls);
+	}
+
+	// Every thread calls wait(thread) rounds times. Returns ns per round.
+	template <typename Wait>
+	double NanosPerRound(size_t threads, size_t rounds, Wait&& wait)
+	{
+		std::vector<std::thread> workers;
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t t = 0; t < threads; ++t)
+		{
+			workers.emplace_back([&, t] {
+				for (size_t i = 0; i < rounds; ++i)
+					wait(t);
+			});
+		}
+		for (auto& worker: workers)
+			worker.join();
+		const double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		return elapsed / static_cast<double>(rounds);
+	}
+
+	//---------------------------------------------------------------------------
+	// measure() times one run; the first is a warm-up.
+	template <typename Measure>
+	json RunPoint(const char* name, const char* unit, size_t repetitions, Measure&& measure)
+	{
+		measure();
+
+		std::vector<double> ns;
+		for (size_t i = 0; i < repetitions; ++i)
+			ns.push_back(measure());
+
+		const auto stats = profiler::GetStats(ns);
+		return {
+			{"name", 			name},
+			{"repetitions", 	repetitions},
+			{unit, 				{{"mean", stats.mean}, {"min", stats.min}, {"max", stats.max}, {"stdev", stats.stdev}}},
+		};
+	}
+
+	template <typename Op>
+	json RunCallPoint(const char* name, const Settings& settings, Op&& op)
+	{
+		auto result = RunPoint(name, "ns_per_call", settings.repetitions, [&] { return NanosPerCall(settings.calls, op); });
+		result["calls"] = settings.calls;
+		return result;
+	}
+
+	template <typename Wait>
+	json RunBarrierPoint(const char* name, const Settings& settings, Wait&& wait)
+	{
+		auto result = RunPoint(name, "ns_per_round", settings.repetitions, [&] { return NanosPerRound(settings.barrier_threads, settings.rounds, wait); });
+		result["rounds"] = settings.rounds;
+		result["threads"] = settings.barrier_threads;
+		return result;
+	}
+
+} // namespace bench
+
+//---------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+	cxxopts::Options options("primitives_bench", "Per-call cost of histograms and clocks, per-round cost of barriers");
+	options.add_options()
+		("h,help", "Print usage")
+		("calls", "Calls per run", cxxopts::value<size_t>()->default_value("10000000"))
+		("rounds", "Barrier rounds per run", cxxopts::value<size_t>()->default_value("100000"))
+		("barrier-threads", "Threads meeting at the barrier; 0 for one per hardware thread, at least 2",
+			cxxopts::value<size_t>()->default_value("0"))
+		("repetitions", "Timed runs per measurement", cxxopts::value<size_t>()->default_value("5"))
+		("o,output", "JSON output file; stdout if empty", cxxopts::value<std::string>()->default_value(""));
+
+	const auto args = options.parse(argc, argv);
+	if (args.count("help"))
+	{
+		std::cout << options.help() << '\n';
+		return 0;
+	}
+
+	const size_t barrier_threads = args["barrier-threads"].as<size_t>();
+	const bench::Settings settings{
+		args["calls"].as<size_t>(),
+		args["rounds"].as<size_t>(),
+		barrier_threads ? barrier_threads : std::max<size_t>(2, std::thread::hardware_concurrency()),
+		args["repetitions"].as<size_t>()};
+	if (settings.calls == 0 || settings.rounds == 0 || settings.repetitions == 0)
+	{
+		std::cerr << "Calls, rounds and repetitions must be positive\n";
+		return 1;
+	}
+
+	json results = json::array();
+	auto add = [&] (json result) {
+		std::cerr << result.dump() << '\n';
+		results.push_back(std::move(result));
+	};
+
+	// Values spread over many buckets like real latencies.
+	profiler::LatencyHistogram histogram;
+	add(bench::RunCallPoint("LatencyHistogram::Record", settings, [&] (size_t i) {
+		histogram.Record((i * 2654435761u) & 0xfffff);
+		return i;
+	}));
+
+	add(bench::RunCallPoint("steady_clock::now", settings, [] (size_t) { return std::chrono::steady_clock::now().time_since_epoch().count(); }));
+	add(bench::RunCallPoint("high_resolution_clock::now", settings, [] (size_t) { return std::chrono::high_resolution_clock::now().time_since_epoch().count(); }));
+	add(bench::RunCallPoint("TscClock::now", settings, [] (size_t) { return profiler::TscClock::now().time_since_epoch().count(); }));
+
+	barrier::Barrier tree(settings.barrier_threads);
+	std::barrier<> standard(static_cast<std::ptrdiff_t>(settings.barrier_threads));
+	add(bench::RunBarrierPoint("barrier::Barrier", settings, [&] (size_t t) { tree.Wait(t); }));
+	add(bench::RunBarrierPoint("std::barrier", settings, [&] (size_t) { standard.arrive_and_wait(); }));
+
+	const json report{
+		{"tsc_clock", 	profiler::TscClock::is_tsc()},
+		{"ns_per_tick", profiler::TscClock::ns_per_tick()},
+		{"results", 	std::move(results)}};
+
+	const auto output = args["output"].as<std::string>();
+	if (output.empty())
+	{
+		std::cout << report.dump(2) << '\n';
+	}
+	else
+	{
+		std::ofstream(output) << report.dump(2) << '\n';
+	}
+	return 0;
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Storage allocators for ring buffers.
+// An allocator is any copyable type with
+//		void* 	allocate(size_t bytes, size_t alignment);
+//		void 	deallocate(void* ptr, size_t bytes, size_t alignment);
+// The ring keeps a copy of its allocator and only calls it at construction and destruction,
+// so the choice of allocator never shows up on the hot path.
+namespace disruptor {
+
+	//---------------------------------------------------------------------------
+	enum class PageSize{DEFAULT = 0, HUGE_2MB, HUGE_1GB};
+
+	//---------------------------------------------------------------------------
+	// Aligned storage from the global heap. Fine for small rings.
+	class HeapAllocator {
+	public:
+		void* 		allocate(size_t bytes, size_t alignment) 				{ return ::operator new(bytes, std::align_val_t{alignment}); }
+		void 		deallocate(void* ptr, size_t, size_t alignment) 		{ ::operator delete(ptr, std::align_val_t{alignment}); }
+	};
+
+	//---------------------------------------------------------------------------
+	struct MmapOptions {
+		// Explicit huge pages need a reserved hugetlbfs pool. When none is available the
+		// mapping falls back to regular pages with transparent huge pages requested.
+		PageSize 	page_size 	{PageSize::HUGE_2MB};
+		// Populate all pages at allocation so the hot path never takes a first-touch fault.
+		bool 		prefault 	{true};
+		// Bind the pages to this NUMA node, normally the one the consumer runs on. -1: no binding.
+		int 		numa_node 	{-1};
+	};
+
+	//---------------------------------------------------------------------------
+	// Anonymous page mapping for large rings: fewer TLB misses, no page faults after
+	// construction, and memory local to the chosen NUMA node. Linux only;
+	// elsewhere it behaves like HeapAllocator.
+	// Copies share their state, so the allocator handed to a ring reports on the ring's mapping.
+	class MmapAllocator {
+	public:
+		explicit 	MmapAllocator(MmapOptions options = {}) 		: options_(options), state_(std::make_shared<State>()) {}
+
+		void* 		allocate(size_t bytes, size_t alignment);
+		void 		deallocate(void* ptr, size_t bytes, size_t alignment);
+
+		// Whether the last allocation by this allocator or a copy got explicit huge pages rather than the fallback.
+		bool 		is_hugetlb() const 								{ std::lock_guard lock(state_->mutex); return state_->is_hugetlb; }
+	private:
+		struct State {
+			std::mutex 			mutex;
+			bool 				is_hugetlb{};
+			// Explicit huge page mappings, sized in whole huge pages rather than like the fallback.
+			std::vector<void*> 	hugetlb_maps;
+		};
+
+		size_t 		PageBytes() const;
+		// The fallback gets transparent huge pages, which are 2 MB whatever size was asked for.
+		size_t 		MappedBytes(size_t bytes, bool hugetlb) const
+		{
+			const size_t page = hugetlb || options_.page_size == PageSize::DEFAULT ? PageBytes() : size_t{1} << 21;
+			return (bytes + page - 1) & ~(page - 1);
+		}
+
+		MmapOptions options_;
+		std::shared_ptr<State> 	state_;
+	};
+
+#if defined(__linux__)
+	//---------------------------------------------------------------------------
+	inline size_t MmapAllocator::PageBytes() const
+	{
+		switch (options_.page_size)
+		{
+			case PageSize::HUGE_2MB: 	return size_t{1} << 21;
+			case PageSize::HUGE_1GB: 	return size_t{1} << 30;
+			default: 					return static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+		}
+	}
+
+	//---------------------------------------------------------------------------
+	inline void* MmapAllocator::allocate(size_t bytes, size_t)
+	{
+		// Pages are always aligned well beyond any slot alignment.
+		const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+		// With NUMA binding the pages must be faulted in after mbind, not by mmap.
+		const int populate = options_.prefault && options_.numa_node < 0 ? MAP_POPULATE : 0;
+		bool populated = false;
+
+		void* ptr = MAP_FAILED;
+		bool hugetlb = false;
+		size_t length = 0;
+		if (options_.page_size != PageSize::DEFAULT)
+		{
+			const int huge_flag = options_.page_size == PageSize::HUGE_1GB ? (30 << MAP_HUGE_SHIFT) : (21 << MAP_HUGE_SHIFT);
+			length = MappedBytes(bytes, true);
+			ptr = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, flags | populate | MAP_HUGETLB | huge_flag, -1, 0);
+			hugetlb = ptr != MAP_FAILED;
+			populated = hugetlb && populate;
+		}
+
+		if (ptr == MAP_FAILED)
+		{
+			length = MappedBytes(bytes, false);
+			// Populating before madvise would fault everything in as small pages, so
+			// transparent huge pages are touched in below instead.
+			const bool thp = options_.page_size != PageSize::DEFAULT;
+			ptr = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, flags | (thp ? 0 : populate), -1, 0);
+			if (ptr == MAP_FAILED)
+				throw std::bad_alloc();
+			if (thp)
+				::madvise(ptr, length, MADV_HUGEPAGE);
+			populated = !thp && populate;
+		}
+
+		if (options_.numa_node >= 0)
+		{
+			unsigned long node_mask = 1UL << options_.numa_node;
+			if (::syscall(SYS_mbind, ptr, length, MPOL_BIND, &node_mask, sizeof(node_mask) * 8, MPOL_MF_MOVE) != 0)
+			{
+				const int err = errno;
+				::munmap(ptr, length);
+				throw std::system_error(err, std::generic_category(), "mbind");
+			}
+		}
+
+		if (options_.prefault && !populated)
+		{
+			// First touch from here places every page on the bound node, in huge pages where madvised.
+			for (size_t offset = 0; offset < length; offset += static_cast<size_t>(::sysconf(_SC_PAGESIZE)))
+				static_cast<volatile char*>(ptr)[offset] = 0;
+		}
+
+		std::lock_guard lock(state_->mutex);
+		state_->is_hugetlb = hugetlb;
+		if (hugetlb)
+			state_->hugetlb_maps.push_back(ptr);
+		return ptr;
+	}
+
+	//---------------------------------------------------------------------------
+	inline void MmapAllocator::deallocate(void* ptr, size_t bytes, size_t)
+	{
+		bool hugetlb = false;
+		{
+			std::lock_guard lock(state_->mutex);
+			auto& maps = state_->hugetlb_maps;
+			if (auto it = std::find(maps.begin(), maps.end(), ptr); it != maps.end())
+			{
+				maps.erase(it);
+				hugetlb = true;
+			}
+		}
+		::munmap(ptr, MappedBytes(bytes, hugetlb));
+	}
+#else
+	//---------------------------------------------------------------------------
+	inline size_t MmapAllocator::PageBytes() const 							{ return 4096; }
+	inline void* MmapAllocator::allocate(size_t bytes, size_t alignment) 	{ return HeapAllocator{}.allocate(bytes, alignment); }
+	inline void MmapAllocator::deallocate(void* ptr, size_t bytes, size_t alignment) { HeapAllocator{}.deallocate(ptr, bytes, alignment); }
+#endif
+
+} // namespace disruptor
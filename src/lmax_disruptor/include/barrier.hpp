@@ -1,58 +1,262 @@
 #pragma once
 #include <atomic>
+#include <cassert>
+#include <chrono>
+#include <climits>
+#include <cstdint>
 #include <functional>
+#include <limits>
+#include <memory>
+#include <thread>
 
-// Barrier helps to ensure all processes arrive 
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include "wait_strategy.hpp"
+
+// Barrier helps to ensure all processes arrive
 // at a certain point before continuing.
 namespace barrier{
-enum WAIT_STATUS{NONE, TIMEOUT, SUCCESS};
+enum WAIT_STATUS{NONE, TIMEOUT, SUCCESS, BROKEN};
+
+namespace detail{
+    //---------------------------------------------------------------------------
+    // Sleeps while word holds expected, for at most timeout (nullptr: no limit). May wake spuriously.
+    template <typename Rep, typename Period>
+    void FutexWait(std::atomic<uint32_t>& word, uint32_t expected, const std::chrono::duration<Rep, Period>* timeout)
+    {
+    #if defined(__linux__)
+        timespec ts{};
+        if (timeout)
+        {
+            const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(*timeout).count();
+            ts.tv_sec = ns / 1'000'000'000;
+            ts.tv_nsec = ns % 1'000'000'000;
+        }
+        ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, timeout ? &ts : nullptr, nullptr, 0);
+    #else
+        if (!timeout)
+            word.wait(expected, std::memory_order_acquire);
+        else
+            std::this_thread::sleep_for(std::min<std::chrono::duration<Rep, Period>>(*timeout, std::chrono::microseconds(50)));
+    #endif
+    }
+
+    inline void FutexWakeAll(std::atomic<uint32_t>& word)
+    {
+    #if defined(__linux__)
+        ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+    #else
+        word.notify_all();
+    #endif
+    }
+} // namespace detail
 
-template<int count>
+//---------------------------------------------------------------------------
+// Reusable combining-tree barrier for a participant count chosen at runtime.
+// Participants arrive at leaves of FAN_IN; the last arrival at a node carries on to its parent,
+// so no counter sees more than FAN_IN writers and the barrier scales to dozens of threads.
+// The last arrival overall runs the callback and releases everyone by bumping the phase word,
+// which waiters only read: they spin on it for a while, yield, then sleep on it with a futex.
+//
+// A wait that times out breaks the barrier: every current and later waiter returns BROKEN
+// until Reset(). A barrier missing a participant cannot complete, so the others are told
+// instead of being left stuck.
 class Barrier{
+        static constexpr uint32_t   BROKEN_BIT  = 1u << 31;
+        static constexpr size_t     NO_PARENT   = std::numeric_limits<size_t>::max();
+
+        struct alignas(128) Node{
+            std::atomic<uint32_t>   arrived{};
+            uint32_t                expected{};
+            size_t                  parent{NO_PARENT};
+        };
 
     public:
-        Barrier(): go_signal_(0), current_(count){}
-
-        WAIT_STATUS Wait(std::function<void()> callback = nullptr) {
-            
-            // Attempt to atomically decrease.
-            int current_seq =current_.fetch_sub(1, std::memory_order_acq_rel);
-            --current_seq;
-            // std::cout <<" Barrier check 0. Go Signal: "<< go_signal_.load(std::memory_order_acquire)<< ", current_seq: "<< current_seq <<std::endl;
-            if (current_seq==go_signal_.load(std::memory_order_acquire)) {
-                // Reset current
-                if (callback) callback();
-                current_.store( 2*count + go_signal_.load(std::memory_order_acquire), std::memory_order_release);
-                go_signal_.fetch_add(count, std::memory_order_acq_rel);
-                // std::cout <<"Barrier check 1: go signal: "<< go_signal_.load(std::memory_order_acquire)<< std::endl;
-            
-            } else {
-                // Condition takes care of wrap around.
-                while(go_signal_.load(std::memory_order_acquire) < current_seq 
-                 && ((current_seq -go_signal_) < count )) {
-                    //  std::cout <<"Barrier check 2\n"<<std::endl;
-                    //  std::cout <<"Go Signal: "<<go_signal_.load(std::memory_order_acquire)<< ", current_seq: "<<current_seq  <<std::endl;
-                }
-                //  std::cout <<"Barrier check 2.2\n"<<std::endl;
-            }
-            return WAIT_STATUS::SUCCESS;
+        static constexpr size_t     FAN_IN      = 4;
+        static constexpr uint32_t   SPIN_LIMIT  = 200;
+        static constexpr uint32_t   YIELD_LIMIT = 16;
+
+        // count must be at least 1. Waiters spin spin_limit times, then yield YIELD_LIMIT times before
+        // sleeping. spin_limit defaults to SPIN_LIMIT, or 0 on a single CPU where nobody else runs meanwhile.
+        explicit Barrier(size_t count, uint32_t spin_limit = DefaultSpinLimit());
+
+        // participant identifies the caller, in [0, size()); each must arrive exactly once per phase.
+        // The callback runs on the last arrival before anyone is released.
+        WAIT_STATUS Wait(size_t participant, const std::function<void()>& callback = nullptr)
+        {
+            return WaitUntil(participant, nullptr, callback);
+        }
+
+        // As Wait, but gives up after timeout, breaking the barrier, and returns TIMEOUT.
+        template <typename Rep, typename Period>
+        WAIT_STATUS WaitFor(size_t participant, std::chrono::duration<Rep, Period> timeout, const std::function<void()>& callback = nullptr)
+        {
+            const auto deadline = std::chrono::steady_clock::now() + timeout;
+            return WaitUntil(participant, &deadline, callback);
         }
 
+        // Repairs a broken barrier. No participant may be waiting.
+        void    Reset();
+
+        bool    is_broken() const       { return phase_.load(std::memory_order_acquire) & BROKEN_BIT; }
+        size_t  size() const            { return count_; }
+
     private:
-        std::atomic<int> go_signal_;
-        std::atomic<int> current_;
+        static uint32_t DefaultSpinLimit()  { return std::thread::hardware_concurrency() > 1 ? SPIN_LIMIT : 0; }
+
+        // Counts the participant in; true for the last arrival of the phase.
+        bool        Arrive(size_t participant);
+        WAIT_STATUS WaitUntil(size_t participant, const std::chrono::steady_clock::time_point* deadline, const std::function<void()>& callback);
+        void        Release();
+
+        size_t                      count_;
+        uint32_t                    spin_limit_;
+        std::unique_ptr<Node[]>     nodes_;
+        // Generation in the low bits; BROKEN_BIT once a waiter has timed out.
+        alignas(128) std::atomic<uint32_t>  phase_{};
+        std::atomic<uint32_t>       sleepers_{};
 };
 
 //---------------------------------------------------------------------------
+inline Barrier::Barrier(size_t count, uint32_t spin_limit)
+    : count_(count), spin_limit_(spin_limit)
+{
+    // Lay the tree out level by level, leaves first; a level's nodes wait for its children.
+    size_t num_nodes = 0;
+    for (size_t width = count; ; width = (width + FAN_IN - 1) / FAN_IN)
+    {
+        num_nodes += (width + FAN_IN - 1) / FAN_IN;
+        if (width <= FAN_IN)
+            break;
+    }
+    nodes_ = std::make_unique<Node[]>(num_nodes);
+
+    size_t level_begin = 0;
+    for (size_t width = count; ; )
+    {
+        const size_t level_size = (width + FAN_IN - 1) / FAN_IN;
+        for (size_t i = 0; i < level_size; ++i)
+        {
+            nodes_[level_begin + i].expected = static_cast<uint32_t>(std::min(FAN_IN, width - i * FAN_IN));
+            if (level_size > 1)
+                nodes_[level_begin + i].parent = level_begin + level_size + i / FAN_IN;
+        }
+        if (level_size == 1)
+            break;
+        level_begin += level_size;
+        width = level_size;
+    }
+}
+
+//---------------------------------------------------------------------------
+inline bool Barrier::Arrive(size_t participant)
+{
+    assert(participant < count_);
+    for (size_t node = participant / FAN_IN; node != NO_PARENT; node = nodes_[node].parent)
+    {
+        Node& n = nodes_[node];
+        if (n.arrived.fetch_add(1, std::memory_order_acq_rel) + 1 < n.expected)
+            return false;
+        // Nobody touches this node again before the phase is released.
+        n.arrived.store(0, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------------
+inline void Barrier::Release()
+{
+    // seq_cst pairs with the waiter's increment: either it sees the new phase or we see it asleep.
+    if (sleepers_.load(std::memory_order_seq_cst) > 0)
+        detail::FutexWakeAll(phase_);
+}
+
+//---------------------------------------------------------------------------
+inline WAIT_STATUS Barrier::WaitUntil(size_t participant, const std::chrono::steady_clock::time_point* deadline, const std::function<void()>& callback)
+{
+    // A participant cannot start phase n+1 before phase n completes, so this is its phase.
+    uint32_t phase = phase_.load(std::memory_order_acquire);
+    if (phase & BROKEN_BIT)
+        return WAIT_STATUS::BROKEN;
+
+    if (Arrive(participant))
+    {
+        if (callback) callback();
+        const uint32_t next = (phase + 1) & ~BROKEN_BIT;
+        // Fails only if a timed-out waiter broke the barrier first.
+        const bool released = phase_.compare_exchange_strong(phase, next, std::memory_order_seq_cst);
+        Release();
+        return released ? WAIT_STATUS::SUCCESS : WAIT_STATUS::BROKEN;
+    }
+
+    disruptor::BusySpinWait spinner;
+    for (uint32_t i = 0; i < spin_limit_ && phase_.load(std::memory_order_acquire) == phase; ++i)
+        spinner.Wait(phase_);
+    // Yielding lets a late participant sharing this CPU arrive without a futex round trip.
+    for (uint32_t i = 0; i < YIELD_LIMIT && phase_.load(std::memory_order_acquire) == phase; ++i)
+        std::this_thread::yield();
+
+    sleepers_.fetch_add(1, std::memory_order_seq_cst);
+    uint32_t current;
+    while ((current = phase_.load(std::memory_order_seq_cst)) == phase)
+    {
+        if (!deadline)
+        {
+            detail::FutexWait<int64_t, std::nano>(phase_, phase, nullptr);
+            continue;
+        }
+
+        const auto remaining = *deadline - std::chrono::steady_clock::now();
+        if (remaining <= std::chrono::steady_clock::duration::zero())
+        {
+            // Break the barrier unless the phase completed in the meantime.
+            if (phase_.compare_exchange_strong(phase, phase | BROKEN_BIT, std::memory_order_seq_cst))
+            {
+                sleepers_.fetch_sub(1, std::memory_order_relaxed);
+                detail::FutexWakeAll(phase_);
+                return WAIT_STATUS::TIMEOUT;
+            }
+            current = phase;
+            break;
+        }
+        detail::FutexWait(phase_, phase, &remaining);
+    }
+    sleepers_.fetch_sub(1, std::memory_order_relaxed);
+    return current & BROKEN_BIT ? WAIT_STATUS::BROKEN : WAIT_STATUS::SUCCESS;
+}
+
+//---------------------------------------------------------------------------
+inline void Barrier::Reset()
+{
+    size_t node = 0;
+    for (size_t width = count_; ; width = (width + FAN_IN - 1) / FAN_IN)
+    {
+        const size_t level_size = (width + FAN_IN - 1) / FAN_IN;
+        for (size_t i = 0; i < level_size; ++i)
+            nodes_[node++].arrived.store(0, std::memory_order_relaxed);
+        if (level_size == 1)
+            break;
+    }
+    phase_.store((phase_.load(std::memory_order_relaxed) + 1) & ~BROKEN_BIT, std::memory_order_release);
+}
+
+//---------------------------------------------------------------------------
+	// Spin lock for short critical sections. Polls with a plain load so waiters don't bounce the
+	// cache line, and gives up the core when the holder has been preempted.
 	class ScopedBarrier{
 	public:
 		ScopedBarrier(std::atomic<bool>& sync_flag) :sync_flag_(sync_flag)
 		{
-			bool expected = false;
-			while (!sync_flag_.compare_exchange_weak(expected, true, std::memory_order_acq_rel) ) {
-				expected = false;
+			disruptor::SpinThenYieldWait waiter;
+			while (sync_flag_.exchange(true, std::memory_order_acquire)) {
+				while (sync_flag_.load(std::memory_order_relaxed))
+					waiter.Wait(signal_);
 			}
-	
 		}
 
 		~ScopedBarrier() {
@@ -60,5 +264,7 @@ class Barrier{
 		}
 	private:
 		std::atomic<bool>& sync_flag_;
+		// Unused by the spinning strategy.
+		disruptor::WaitSignal signal_{};
 	};
-} //namespace barrier.
\ No newline at end of file
+} //namespace barrier
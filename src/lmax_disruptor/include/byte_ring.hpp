@@ -0,0 +1,351 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "disruptor.hpp"
+
+// Ring of variable-length records, for feeds that mix small and large events.
+// A fixed-size ring pads every event to the largest one; here each record takes only the
+// 8-byte blocks it needs:
+//		[header: payload size, type, flags][payload, padded to RECORD_ALIGN]
+// The ring is a RingBuffer of blocks in the SOA layout, so its payload is one contiguous array,
+// and writers and readers use the same WriteCursor/ReadCursor reserve/publish protocol as the
+// fixed-size disruptor, counting blocks instead of events.
+//
+// A record is never split by the end of the ring: a reservation that would wrap is published as
+// padding records, which readers skip, and the writer reserves again after them. Records are capped
+// at half the ring so the retry always fits; a record that wraps may wait for readers to free up to
+// twice its size.
+// Readers are broadcast, each sees every record, and read everything published at once so
+// a batch always ends on a record boundary.
+//
+//		auto ring = disruptor::ByteRing<>::Create(1 << 20);
+//		auto reader = ring->CreateReader();
+//		auto writer = ring->CreateWriter();
+//		writer.Write(TRADE, &trade, sizeof(trade));
+//		for (const auto& record: reader.Read()) Dispatch(record.type, record.payload);
+namespace disruptor {
+
+	namespace bytes {
+		constexpr size_t 	RECORD_ALIGN 	= 8;
+
+		struct alignas(RECORD_ALIGN) Block {
+			std::byte 		bytes[RECORD_ALIGN];
+		};
+
+		enum RecordFlags: uint16_t {
+			NONE 			= 0,
+			// Filler up to the end of the ring; never handed to readers.
+			PADDING 		= 1
+		};
+
+		struct RecordHeader {
+			uint32_t 		size;
+			uint16_t 		type;
+			uint16_t 		flags;
+		};
+
+		static_assert(sizeof(Block) == RECORD_ALIGN && sizeof(RecordHeader) <= RECORD_ALIGN);
+
+		// Blocks taken by a record with this payload, header included.
+		constexpr size_t 	BlocksFor(size_t size) 		{ return 1 + (size + RECORD_ALIGN - 1) / RECORD_ALIGN; }
+	} // namespace bytes
+
+	template <PublishPolicy _WP, typename _WS>
+	class ByteWriter;
+
+	template <PublishPolicy _WP, typename _WS>
+	class ByteReader;
+
+	template <PublishPolicy _WP, typename _WS>
+	class RecordClaim;
+
+	template <PublishPolicy _WP, typename _WS>
+	class RecordBatch;
+
+	//---------------------------------------------------------------------------
+	// A published record, viewed in place. Valid until its batch is released.
+	struct ByteRecord {
+		uint16_t 						type;
+		std::span<const std::byte> 		payload;
+		// Sequence of the record's first block.
+		size_t 							sequence;
+	};
+
+	//---------------------------------------------------------------------------
+	// Any number of writers, as _WP allows, and broadcast readers. All readers must be created
+	// before the first write, as with ConsumerMode::BROADCAST.
+	template <PublishPolicy _WP = PublishPolicy::SINGLE, typename _WS = BusySpinWait>
+	class ByteRing: public std::enable_shared_from_this<ByteRing<_WP, _WS>> {
+		friend class ByteWriter<_WP, _WS>;
+		friend class ByteReader<_WP, _WS>;
+		friend class RecordClaim<_WP, _WS>;
+		friend class RecordBatch<_WP, _WS>;
+	public:
+		using 					SPtr 									= std::shared_ptr<ByteRing>;
+		using 					buffer_type 							= RingBuffer<bytes::Block, Layout::SOA>;
+		using 					read_cursor_type 						= ReadCursor<bytes::Block, PublishPolicy::SINGLE, _WS, Layout::SOA>;
+
+		// capacity is in bytes: a power of 2, at least four blocks.
+		static SPtr 			Create(size_t capacity);
+
+		ByteWriter<_WP, _WS> 	CreateWriter() 							{ return ByteWriter<_WP, _WS>(this->shared_from_this()); }
+		// Not thread-safe. Starts at the current write cursor.
+		ByteReader<_WP, _WS> 	CreateReader();
+
+		size_t 					capacity() const 						{ return buffer_->size() * bytes::RECORD_ALIGN; }
+		// Largest payload a record can carry: half the ring, header included, so that after padding
+		// out the end of the ring the retry always fits before the end.
+		size_t 					max_record_size() const 				{ return capacity() / 2 - bytes::RECORD_ALIGN; }
+		size_t 					GetWriteCursor() const 					{ return write_cursor_.GetCursor(); }
+		WaitSignal& 			signal() const 							{ return buffer_->signal(); }
+	private:
+		explicit 				ByteRing(typename buffer_type::SPtr buffer)
+									:
+									buffer_ 		(buffer),
+									data_ 			(buffer->Spans(0, buffer->size())[0].data()),
+									mask_ 			(buffer->size() - 1),
+									write_cursor_ 	(std::move(buffer))
+									{}
+
+		bytes::Block* 			at(size_t pos) const 					{ return data_ + (pos & mask_); }
+
+		typename buffer_type::SPtr 	buffer_;
+		bytes::Block* 			data_;
+		size_t 					mask_;
+		WriteCursor<bytes::Block, _WP, _WS, Layout::SOA> 	write_cursor_;
+		// unique_ptr keeps cursor addresses stable as readers are added.
+		std::vector<std::unique_ptr<read_cursor_type>> 		read_cursors_;
+		detail::CursorGroup<read_cursor_type> 				gating_cursors_;
+	};
+
+	//---------------------------------------------------------------------------
+	// A record reserved by a writer, filled in place and published on destruction unless published before.
+	// Move-only. Not thread-safe; belongs to the writer that claimed it.
+	template <PublishPolicy _WP, typename _WS>
+	class RecordClaim {
+	public:
+		constexpr 				RecordClaim() 							= default;
+								RecordClaim(ByteRing<_WP, _WS>* ring, std::span<std::byte> payload, size_t begin, size_t end)
+									: err(false), ring_(ring), payload_(payload), begin_(begin), end_(end) {}
+								RecordClaim(RecordClaim&& other) noexcept 	{ *this = std::move(other); }
+		RecordClaim& 			operator=(RecordClaim&& other) noexcept;
+								~RecordClaim() 							{ Publish(); }
+
+		bool 					err {true}; // Nothing was claimed.
+
+		// The payload to fill, exactly as large as asked for.
+		std::span<std::byte> 	data() const 							{ return payload_; }
+		size_t 					sequence() const 						{ return begin_; }
+		void 					Publish() 								{ if (ring_) std::exchange(ring_, nullptr)->write_cursor_.Publish(begin_, end_); }
+	private:
+		ByteRing<_WP, _WS>* 	ring_{};
+		std::span<std::byte> 	payload_;
+		size_t 					begin_{};
+		size_t 					end_{};
+	};
+
+	//---------------------------------------------------------------------------
+	template <PublishPolicy _WP, typename _WS>
+	class ByteWriter {
+		using 					_RingSPtr 								= typename ByteRing<_WP, _WS>::SPtr;
+	public:
+		explicit 				ByteWriter(_RingSPtr ring) 				: ring_(std::move(ring)) {}
+
+		// Blocks until size bytes are free. Errs if the record can never fit.
+		RecordClaim<_WP, _WS> 	Claim(uint16_t type, size_t size);
+		// Copying shorthand for Claim. Returns true on error, as Writer::Write does.
+		bool 					Write(uint16_t type, const void* data, size_t size);
+	private:
+		_RingSPtr 				ring_;
+	};
+
+	//---------------------------------------------------------------------------
+	// Records published but not yet released by one reader. Iterates in place, skipping padding.
+	// Released on destruction unless released before. Move-only.
+	template <PublishPolicy _WP, typename _WS>
+	class RecordBatch {
+		using 					_ReadCursorT 							= typename ByteRing<_WP, _WS>::read_cursor_type;
+	public:
+		class iterator {
+		public:
+								iterator(const ByteRing<_WP, _WS>* ring, size_t pos, size_t end)
+									: ring_(ring), pos_(pos), end_(end) 	{ SkipPadding(); }
+
+			ByteRecord 			operator*() const;
+			iterator& 			operator++() 							{ pos_ += bytes::BlocksFor(Header().size); SkipPadding(); return *this; }
+			bool 				operator!=(const iterator& other) const { return pos_ != other.pos_; }
+			bool 				operator==(const iterator& other) const { return pos_ == other.pos_; }
+		private:
+			const bytes::RecordHeader& 	Header() const 					{ return *reinterpret_cast<const bytes::RecordHeader*>(ring_->at(pos_)); }
+			void 				SkipPadding()
+			{
+				while (pos_ != end_ && (Header().flags & bytes::PADDING))
+					pos_ += bytes::BlocksFor(Header().size);
+			}
+
+			const ByteRing<_WP, _WS>* 	ring_;
+			size_t 				pos_;
+			size_t 				end_;
+		};
+
+		constexpr 				RecordBatch() 							= default;
+								RecordBatch(const ByteRing<_WP, _WS>* ring, _ReadCursorT* cursor, size_t begin, size_t end)
+									: err(false), ring_(ring), cursor_(cursor), begin_(begin), end_(end) {}
+								RecordBatch(RecordBatch&& other) noexcept 	{ *this = std::move(other); }
+		RecordBatch& 			operator=(RecordBatch&& other) noexcept;
+								~RecordBatch() 							{ Release(); }
+
+		bool 					err {true}; // Nothing to read.
+
+		iterator 				begin() const 							{ return {ring_, begin_, end_}; }
+		iterator 				end() const 							{ return {ring_, end_, end_}; }
+		// Blocks covered, padding included.
+		size_t 					blocks() const 							{ return end_ - begin_; }
+		// Hands the blocks back to the writers. Only the first call has an effect.
+		void 					Release() 								{ if (cursor_) std::exchange(cursor_, nullptr)->Publish(begin_, end_); }
+	private:
+		const ByteRing<_WP, _WS>* 	ring_{};
+		_ReadCursorT* 			cursor_{};
+		size_t 					begin_{};
+		size_t 					end_{};
+	};
+
+	//---------------------------------------------------------------------------
+	template <PublishPolicy _WP, typename _WS>
+	class ByteReader {
+		using 					_RingSPtr 								= typename ByteRing<_WP, _WS>::SPtr;
+		using 					_ReadCursorT 							= typename ByteRing<_WP, _WS>::read_cursor_type;
+	public:
+								ByteReader(_RingSPtr ring, _ReadCursorT* cursor) 	: ring_(std::move(ring)), cursor_(cursor) {}
+
+		// Non-blocking: everything published since the last read, or err if there is nothing.
+		RecordBatch<_WP, _WS> 	Read();
+		size_t 					GetCursor() const 						{ return cursor_->GetCursor(); }
+		// What to wait on when there is nothing to read.
+		WaitSignal& 			signal() const 							{ return ring_->signal(); }
+	private:
+		_RingSPtr 				ring_;
+		_ReadCursorT* 			cursor_;
+	};
+
+	//---------------------------------------------------------------------------
+	template <PublishPolicy _WP, typename _WS>
+	auto ByteRing<_WP, _WS>::Create(size_t capacity) -> SPtr
+	{
+		assert(IsValidCapacity(capacity) && capacity >= 4 * bytes::RECORD_ALIGN);
+		return SPtr(new ByteRing(std::make_shared<buffer_type>(capacity / bytes::RECORD_ALIGN)));
+	}
+
+	//---------------------------------------------------------------------------
+	template <PublishPolicy _WP, typename _WS>
+	ByteReader<_WP, _WS> ByteRing<_WP, _WS>::CreateReader()
+	{
+		auto cursor = std::make_unique<read_cursor_type>(buffer_);
+		cursor->Reset(write_cursor_.GetCursor());
+		gating_cursors_.Add(cursor.get());
+		read_cursors_.push_back(std::move(cursor));
+		return ByteReader<_WP, _WS>(this->shared_from_this(), read_cursors_.back().get());
+	}
+
+	//---------------------------------------------------------------------------
+	template <PublishPolicy _WP, typename _WS>
+	RecordClaim<_WP, _WS> ByteWriter<_WP, _WS>::Claim(uint16_t type, size_t size)
+	{
+		auto& ring = *ring_;
+		assert(!ring.gating_cursors_.empty());
+		if (size > ring.max_record_size())
+			return {};
+
+		const size_t blocks = bytes::BlocksFor(size);
+		const size_t capacity = ring.buffer_->size();
+		for (;;)
+		{
+			const auto reservation = ring.write_cursor_.Reserve(ring.gating_cursors_, blocks, true, true);
+			const size_t offset = reservation.pos_begin & ring.mask_;
+			if (offset + blocks <= capacity)
+			{
+				*reinterpret_cast<bytes::RecordHeader*>(ring.at(reservation.pos_begin)) = {static_cast<uint32_t>(size), type, bytes::NONE};
+				return {&ring, {reinterpret_cast<std::byte*>(ring.at(reservation.pos_begin + 1)), size}, reservation.pos_begin, reservation.pos_end};
+			}
+
+			// The record would wrap: pad out the end of the ring and what was reserved past it, then retry.
+			const size_t tail = capacity - offset;
+			*reinterpret_cast<bytes::RecordHeader*>(ring.at(reservation.pos_begin)) =
+				{static_cast<uint32_t>((tail - 1) * bytes::RECORD_ALIGN), 0, bytes::PADDING};
+			*reinterpret_cast<bytes::RecordHeader*>(ring.at(reservation.pos_begin + tail)) =
+				{static_cast<uint32_t>((blocks - tail - 1) * bytes::RECORD_ALIGN), 0, bytes::PADDING};
+			ring.write_cursor_.Publish(reservation.pos_begin, reservation.pos_end);
+		}
+	}
+
+	//---------------------------------------------------------------------------
+	template <PublishPolicy _WP, typename _WS>
+	bool ByteWriter<_WP, _WS>::Write(uint16_t type, const void* data, size_t size)
+	{
+		auto claim = Claim(type, size);
+		if (claim.err)
+			return true;
+		std::memcpy(claim.data().data(), data, size);
+		return false;
+	}
+
+	//---------------------------------------------------------------------------
+	template <PublishPolicy _WP, typename _WS>
+	RecordBatch<_WP, _WS> ByteReader<_WP, _WS>::Read()
+	{
+		// Everything published, which always ends on a record boundary.
+		const auto reservation = cursor_->Reserve(ring_->write_cursor_, ring_->buffer_->size());
+		if (reservation.err)
+			return {};
+		return {ring_.get(), cursor_, reservation.pos_begin, reservation.pos_end};
+	}
+
+	//---------------------------------------------------------------------------
+	template <PublishPolicy _WP, typename _WS>
+	auto RecordBatch<_WP, _WS>::iterator::operator*() const -> ByteRecord
+	{
+		const auto& header = Header();
+		return {header.type, {reinterpret_cast<const std::byte*>(ring_->at(pos_ + 1)), header.size}, pos_};
+	}
+
+	//---------------------------------------------------------------------------
+	template <PublishPolicy _WP, typename _WS>
+	RecordClaim<_WP, _WS>& RecordClaim<_WP, _WS>::operator=(RecordClaim&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Publish();
+			err 		= std::exchange(other.err, true);
+			ring_ 		= std::exchange(other.ring_, nullptr);
+			payload_ 	= other.payload_;
+			begin_ 		= other.begin_;
+			end_ 		= other.end_;
+		}
+		return *this;
+	}
+
+	//---------------------------------------------------------------------------
+	template <PublishPolicy _WP, typename _WS>
+	RecordBatch<_WP, _WS>& RecordBatch<_WP, _WS>::operator=(RecordBatch&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Release();
+			err 		= std::exchange(other.err, true);
+			ring_ 		= other.ring_;
+			cursor_ 	= std::exchange(other.cursor_, nullptr);
+			begin_ 		= other.begin_;
+			end_ 		= other.end_;
+		}
+		return *this;
+	}
+
+} // namespace disruptor
@@ -1,71 +1,131 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <bit>
 #include <new>
+#include <span>
 #include <stddef.h>
 #include <utility>
 #include <vector>
 #include <array>
 #include <iostream>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "allocator.hpp"
+#include "wait_strategy.hpp"
 
 #define hardware_destructive_interference_size 128
 
 namespace disruptor {
 
+	//---------------------------------------------------------------------------
+	// How slots are laid out in the ring.
+	// PADDED: one slot per cache line, as in the LMAX disruptor. Writers to neighbouring slots never 
+	// 		false-share, at the cost of a whole line per event.
+	// PACKED: slots are densely packed, padding only at the ring ends. Best for small events that are 
+	// 		claimed and read in batches, so neighbouring slots are mostly touched by the same thread.
+	// SOA:	payloads and end-of-stream flags live in separate dense arrays, so consumers stream 
+	// 		through contiguous payloads only.
+	enum class Layout{PADDED = 0, PACKED, SOA};
+
 	//---------------------------------------------------------------------------
 	// Alignment to  avoid false sharing.
 	// The LMAX disruptor uses a ring buffer with each element occupying a cache line to 
 	// prevent false sharing amongst threads.
 	// In the tested mac OS, the cache line is 128 Bytes.
 	// Additional information about the data such as whether it is the last in a stream is included.
-	template <typename Elem>
-	class alignas(hardware_destructive_interference_size) Sequence {
+	template <typename Elem, Layout L = Layout::PADDED>
+	class alignas(L == Layout::PADDED ? hardware_destructive_interference_size : alignof(Elem)) Sequence {
 	public:
 		bool	is_eof() const		{ return is_eof_;}
 		void	set_eof(bool eof)	{ is_eof_ = eof;}
 		Elem&	data()				{ return data_;}
+		const Elem&	data() const	{ return data_;}
 	private:
 		Elem	data_				{}; // Zero initialisation.
 		bool	is_eof_				{false};	
 	};
 
+	//---------------------------------------------------------------------------
+	// Slot view for the struct-of-arrays layout. Same interface as Sequence, but refers
+	// into the payload and flag arrays instead of owning the data.
+	template <typename Elem>
+	class SlotRef {
+	public:
+		constexpr SlotRef(Elem* data, bool* eof) 	: data_(data), is_eof_(eof) {}
+		bool	is_eof() const		{ return *is_eof_;}
+		void	set_eof(bool eof)	{ *is_eof_ = eof;}
+		Elem&	data()				{ return *data_;}
+	private:
+		Elem*	data_;
+		bool*	is_eof_;
+	};
+
+	//---------------------------------------------------------------------------
+	constexpr size_t 	DEFAULT_CAPACITY 	= 512;
+
+	// Capacities must be a power of 2 and greater than 0.
+	constexpr bool 		IsValidCapacity(size_t capacity) 	{ return capacity != 0 && ((capacity & (capacity - 1)) == 0); }
+
 	//---------------------------------------------------------------------------
 	// This class implements the ring buffer. 
-	template<typename Elem, size_t N = 512>
+	// The capacity is chosen at construction and the slots are allocated through a pluggable 
+	// allocator (see allocator.hpp), e.g. MmapAllocator for huge-page, NUMA-bound large rings.
+	// A cache line of padding at each end keeps the slots off lines shared with other allocations.
+	template<typename Elem, Layout L = Layout::PADDED>
 	class RingBuffer {
-		// Ensure size is a power of 2 and greater than 0.
-		static_assert( N !=0 && ((N & (N - 1)) == 0));		
-
+		static constexpr bool 		IS_SOA 		= L == Layout::SOA;
 	public:
+		// What at() and iterators hand out: a slot reference, or a view for the SOA layout.
+		using 				slot_type 							= std::conditional_t<IS_SOA, SlotRef<Elem>, Sequence<Elem, L>>;
+		// Contiguous run of ring memory: slots, or payloads for the SOA layout.
+		using 				span_type 							= std::conditional_t<IS_SOA, std::span<Elem>, std::span<Sequence<Elem, L>>>;
+
 		class iterator {
 		public:
-			using 			_iter 										= typename std::array<Sequence<Elem>,N>::const_iterator;
-			
 			constexpr 		iterator() = default;
-			constexpr 		iterator(_iter begin, size_t own_pos)		: begin_(std::move(begin)), own_pos_(own_pos) {}
+			constexpr 		iterator(RingBuffer* buffer, size_t own_pos)		: buffer_(buffer), own_pos_(own_pos) {}
 
-			_iter 			get() const 								{ return begin_+ own_pos_; }
-			iterator&		operator++()								{ own_pos_ = RingBuffer::GetBufferIDx(++own_pos_); return *this; }			
-			Sequence<Elem> 	operator*() 								{ return *(begin_+own_pos_); }
-			bool 			operator!=(const iterator& other )const 	{ return this->get() != other.get(); }
-			bool 			operator==(const iterator& other )const 	{ return this->get() == other.get(); }
+			// Positions are sequence numbers rather than slot indices, so a range spanning the whole ring is not empty.
+			iterator&		operator++()								{ ++own_pos_; return *this; }			
+			// A reference into the ring, not a copy of the slot (a view for the SOA layout).
+			decltype(auto) 	operator*() 								{ return buffer_->at(own_pos_); }
+			bool 			operator!=(const iterator& other )const 	{ return own_pos_ != other.own_pos_ || buffer_ != other.buffer_; }
+			bool 			operator==(const iterator& other )const 	{ return !(*this != other); }
 
 		private:
-			_iter 			begin_;
-			size_t 			own_pos_;
+			RingBuffer* 	buffer_{};
+			size_t 			own_pos_{};
 		};
 
 		//---------------------------------------------------------------------------
 		using 				SPtr 								= std::shared_ptr<RingBuffer>;
 
-		constexpr			RingBuffer() 						= default;
-		Sequence<Elem>& 	at(size_t pos)  					{ return buffer_[this->GetBufferIDx(pos)]; }
-		static size_t 		GetBufferIDx (size_t sequence) 		{ return sequence & (N-1); }
-		iterator 			GetIterator(size_t pos) const 		{ return iterator(buffer_.begin(), this->GetBufferIDx(pos)); }
-		size_t 				size() const 						{ return N; }
+		template <typename Alloc = HeapAllocator>
+		explicit			RingBuffer(size_t capacity = DEFAULT_CAPACITY, Alloc alloc = {});
+
+		decltype(auto) 		at(size_t pos);
+		size_t 				GetBufferIDx (size_t sequence) const { return sequence & mask_; }
+		iterator 			GetIterator(size_t pos) 			{ return iterator(this, pos); }
+		// The sequences [pos_begin, pos_end) as at most two contiguous runs; the second is empty unless the range wraps.
+		std::array<span_type, 2> 	Spans(size_t pos_begin, size_t pos_end);
+		size_t 				size() const 						{ return mask_ + 1; }
+		// Shared by all cursors on this ring for blocking wait strategies.
+		WaitSignal& 		signal() const 						{ return signal_; }
 
 	private:
-		std::array<Sequence<Elem>,N> 	buffer_;
+		using 				_Storage 							= std::unique_ptr<std::byte[], std::function<void(std::byte*)>>;
+
+		size_t 							mask_;
+		_Storage 						storage_;
+		Sequence<Elem, L>* 				slots_{};	// PADDED and PACKED.
+		Elem* 							data_{};	// SOA.
+		bool* 							is_eof_{};	// SOA.
+		alignas(hardware_destructive_interference_size) 
+		mutable WaitSignal 				signal_{};
 	};
 
 	//---------------------------------------------------------------------------
@@ -74,7 +134,18 @@ namespace disruptor {
 	// to catch up before they can resume reading or writing.
 	// Rather than using a busy wait which blocks, one can buffer up update requests and move onto another read or write.
 	// When the update request buffer is full then the reader or write will resort to busy waits.
-	enum class PublishPolicy{BUFFERED = 0, BLOCK};
+	// AVAILABILITY avoids both: every ring slot carries a per-lap published flag, so a publish is a
+	// single store per slot and the cursor is derived by scanning for the highest contiguous published slot.
+	// SINGLE is for rings with exactly one writer (or one reader): claims and publishes are plain
+	// loads and stores in sequence order, with no CAS.
+	enum class PublishPolicy{BUFFERED = 0, BLOCK, AVAILABILITY, SINGLE};
+
+	//---------------------------------------------------------------------------
+	// How readers created from the same disruptor share events.
+	// COMPETING readers share one read cursor, so each event goes to exactly one of them.
+	// BROADCAST readers each own a cursor and every reader sees every event. The writer is 
+	// gated on the slowest reader, so fan-out needs no copies or extra queues.
+	enum class ConsumerMode{COMPETING = 0, BROADCAST};
 
 	//---------------------------------------------------------------------------
 	struct ReservationInfo {
@@ -87,7 +158,8 @@ namespace disruptor {
 	{
 		//---------------------------------------------------------------------------
 
-		enum class PublishUpdateStatus{SUCCESS, ERROR, NO_SPACE};
+		// PENDING: earlier reservations are still unpublished, retry later.
+		enum class PublishUpdateStatus{SUCCESS, ERROR, NO_SPACE, PENDING};
 
 		//---------------------------------------------------------------------------
 		struct Reservation {
@@ -121,16 +193,17 @@ namespace disruptor {
 
 			size_t 					cursor() const 		{ return cursor_.load(std::memory_order_acquire); }
 
-			void 					Reset() 			{ cursor_ = 0;	std::fill( unprocessed_reservations_.begin(), unprocessed_reservations_.end(), Reservation{} ); }
+			void 					Reset(size_t sequence = 0) 	{ cursor_ = sequence;	std::fill( unprocessed_reservations_.begin(), unprocessed_reservations_.end(), Reservation{} ); }
 			
 			friend std::ostream& 	operator<< <>(std::ostream&, const CursorUpdateHelper&);
 		private:
 			// Should be at least the size of writers.
 			std::array<Reservation, LIM> 	unprocessed_reservations_;
 			std::string						type_{};
-			std::atomic<size_t> 			cursor_{};
 			std::atomic<bool >				sync_flag_{};
-			
+			// Read by the other side on every refresh; kept off the publishers' bookkeeping line.
+			alignas(hardware_destructive_interference_size)
+			std::atomic<size_t> 			cursor_{};
 		};
 
 
@@ -141,81 +214,236 @@ namespace disruptor {
 			constexpr 				CursorUpdateHelper() = default;
 					 				CursorUpdateHelper(const std::string& type): type_(type){}
 
-			// Thread-safe.
-			PublishUpdateStatus 	UpdateCursor(const size_t pos_begin, const size_t pos_end);
+			// Thread-safe. Returns PENDING until all earlier reservations have been published.
+			PublishUpdateStatus 	UpdateCursor(const size_t pos_begin, const size_t pos_end)	{ return UpdateCursor(cursor_, pos_begin, pos_end); }
+			// The same on a cursor kept elsewhere, e.g. in shared memory.
+			static PublishUpdateStatus 	UpdateCursor(std::atomic<size_t>& cursor, const size_t pos_begin, const size_t pos_end);
 
 			size_t 					cursor() const 			{ return cursor_.load(std::memory_order_acquire); }
 
-			void 					Reset() 				{ cursor_ = 0; }
+			void 					Reset(size_t sequence = 0) 	{ cursor_ = sequence; }
 			
 			friend std::ostream& operator<< <>(std::ostream&, const CursorUpdateHelper&);
 		private:
 			// Should be at least the size of writers.
 			std::string				type_{};
+			alignas(hardware_destructive_interference_size)
+			std::atomic<size_t> 	cursor_{};
+		};
+
+		//---------------------------------------------------------------------------
+		// Lock-free multi-publisher helper. One availability entry per ring slot holds the lap (+1)
+		// in which the slot was last published. Publishers never wait on each other; the cursor
+		// is the first sequence whose slot has not yet been published for its lap.
+		template<>
+		class CursorUpdateHelper<PublishPolicy::AVAILABILITY>  {
+		public:
+									CursorUpdateHelper(const std::string& type, size_t capacity);
+
+			// Thread-safe and wait-free.
+			PublishUpdateStatus 	UpdateCursor(const size_t pos_begin, const size_t pos_end);
+
+			// Highest contiguous published sequence (exclusive). Advances the cached cursor as a side effect.
+			size_t 					cursor() const;
+
+			void 					Reset(size_t sequence = 0);
+
+			friend std::ostream& operator<< <>(std::ostream&, const CursorUpdateHelper&);
+		private:
+			size_t 					Lap(size_t sequence) const 	{ return (sequence >> lap_shift_) + 1; }
+
+			std::unique_ptr<std::atomic<size_t>[]> 	available_;
+			size_t 									mask_;
+			int 									lap_shift_;
+			std::string								type_{};
+			// Lower bound on the published cursor; saves rescanning slots already known to be published.
+			alignas(hardware_destructive_interference_size)
+			mutable std::atomic<size_t> 			cursor_{};
+		};
+
+		//---------------------------------------------------------------------------
+		// Single publisher: publishes always arrive in order so the cursor is simply stored.
+		template<>
+		class CursorUpdateHelper<PublishPolicy::SINGLE>  {
+		public:
+			constexpr 				CursorUpdateHelper() = default;
+					 				CursorUpdateHelper(const std::string& type): type_(type){}
+
+			// Not thread-safe. Only the owning writer or reader may publish.
+			PublishUpdateStatus 	UpdateCursor(const size_t pos_begin, const size_t pos_end)	{ return UpdateCursor(cursor_, pos_begin, pos_end); }
+			// The same on a cursor kept elsewhere, e.g. in shared memory.
+			static PublishUpdateStatus 	UpdateCursor(std::atomic<size_t>& cursor, const size_t pos_begin, const size_t pos_end);
+
+			size_t 					cursor() const 			{ return cursor_.load(std::memory_order_acquire); }
+
+			void 					Reset(size_t sequence = 0) 	{ cursor_ = sequence; }
+
+			friend std::ostream& operator<< <>(std::ostream&, const CursorUpdateHelper&);
+		private:
+			std::string				type_{};
+			alignas(hardware_destructive_interference_size)
 			std::atomic<size_t> 	cursor_{};
 		};
+
+		//---------------------------------------------------------------------------
+		template<PublishPolicy P>
+		CursorUpdateHelper<P> 	MakeCursorUpdateHelper(const std::string& type, size_t capacity);
+
+		//---------------------------------------------------------------------------
+		// A set of cursors that behaves as a single cursor positioned at the slowest of them.
+		// Used to gate a writer on several readers. Not thread-safe to modify; 
+		// cursors must be added before reservations against the group start.
+		template <typename CursorT>
+		class CursorGroup {
+		public:
+			void 					Add(const CursorT* cursor) 			{ cursors_.push_back(cursor); }
+			void 					Remove(const CursorT* cursor) 		{ std::erase(cursors_, cursor); }
+			bool 					Contains(const CursorT* cursor) const	{ return std::find(cursors_.begin(), cursors_.end(), cursor) != cursors_.end(); }
+			size_t 					GetCursor() const;
+			bool 					empty() const 						{ return cursors_.empty(); }
+			size_t 					size() const 						{ return cursors_.size(); }
+		private:
+			std::vector<const CursorT*> 	cursors_;
+		};
 	}// detail
 
 //---------------------------------------------------------------------------
-template <class Derived, typename Elem, PublishPolicy P>
-class Cursor{
+// A cursor spans three groups of cache lines so the two sides of the ring never false-share:
+// cold configuration, the claiming side's claim sequence with its cached gate, and the published cursor.
+// The cached gate is the last seen position of whatever gates this cursor (readers for a writer, 
+// the writer or upstream readers for a reader). It is only refreshed when it says the ring looks 
+// full or empty, so the other side's cursor line is not pulled over on every reservation.
+template <class Derived, typename Elem, PublishPolicy P, typename _WS, Layout _SL>
+class alignas(hardware_destructive_interference_size) Cursor{
 public:
 	using SPtr = std::shared_ptr<Cursor>;
 	constexpr			Cursor
-						(	typename RingBuffer<Elem>::SPtr 	buffer, 
+						(	typename RingBuffer<Elem, _SL>::SPtr 	buffer, 
 							const std::string& 					type_in
 						)
 							:  
 							buffer_								(std::move(buffer)),
 							type_								(type_in), 
-							cursor_updater_						(detail::CursorUpdateHelper<P>(type_)) 
+							cursor_updater_						(detail::MakeCursorUpdateHelper<P>(type_, buffer_->size())) 
 						{}
 	size_t 				GetCursor() const 						{ return cursor_updater_.cursor();}
 	void 				Publish(size_t pos_begin, size_t pos_end);
 
-	template <typename Derived2, PublishPolicy P2>
-	ReservationInfo  	Reserve(const Cursor<Derived2, Elem, P2>& other_cursor,	size_t no_of_slots=1) {	static_cast<Derived*>(this)->Reserve(other_cursor, no_of_slots); }
+	// The gate is any cursor-like object exposing GetCursor(), e.g. another cursor or a CursorGroup.
+	template <typename Gate>
+	ReservationInfo  	Reserve(const Gate& gate,	size_t no_of_slots=1) {	return static_cast<Derived*>(this)->Reserve(gate, no_of_slots); }
 
-	void 				Reset() 								{ this->cursor_updater_.Reset();	this->claim_sequence_.store(0); }
+	// Restarts the cursor at sequence, as if everything before it had been claimed and published.
+	void 				Reset(size_t sequence = 0) 				{ this->cursor_updater_.Reset(sequence);	this->claim_sequence_.store(sequence); this->cached_gate_.store(sequence); }
+	// Reservations that had to load the gate because the cached copy could not satisfy them.
+	size_t 				GateRefreshes() const 					{ return gate_refreshes_.load(std::memory_order_relaxed); }
 protected:
-	typename RingBuffer<Elem>::SPtr 	buffer_;
+	typename RingBuffer<Elem, _SL>::SPtr 	buffer_;
 	std::string 						type_{};
 	detail::CursorUpdateHelper<P>		cursor_updater_{};
+	// Only touched by the claiming side.
+	alignas(hardware_destructive_interference_size)
 	std::atomic<size_t> 				claim_sequence_{};
+	std::atomic<size_t> 				cached_gate_{};
+	std::atomic<size_t> 				gate_refreshes_{};
 
 };
 
 //---------------------------------------------------------------------------
-template <typename Elem, PublishPolicy _WP>
-class WriteCursor: public Cursor<WriteCursor<Elem, _WP>, Elem, _WP >{
+template <typename Elem, PublishPolicy _WP, typename _WS, Layout _SL>
+class WriteClaim;
+
+//---------------------------------------------------------------------------
+template <typename Elem, PublishPolicy _WP, typename _WS = BusySpinWait, Layout _SL = Layout::PADDED>
+class WriteCursor: public Cursor<WriteCursor<Elem, _WP, _WS, _SL>, Elem, _WP, _WS, _SL>{
 public:
 	using 				SPtr 													= std::shared_ptr<WriteCursor>;
 
-	constexpr 			WriteCursor(typename RingBuffer<Elem>::SPtr buffer)		: Cursor<WriteCursor, Elem, _WP>(std::move(buffer), "Writer"){}
+	constexpr 			WriteCursor(typename RingBuffer<Elem, _SL>::SPtr buffer)		: Cursor<WriteCursor, Elem, _WP, _WS, _SL>(std::move(buffer), "Writer"){}
 
-	template <typename Derived, PublishPolicy P2>
-	ReservationInfo  	Reserve(const Cursor<Derived, Elem, P2>&,	size_t no_of_slots=1);
+	// Waits for space unless wait is false, in which case a full ring returns err.
+	// Fewer slots than asked for are handed out if that is all the space there is, unless whole is set.
+	template <typename Gate>
+	ReservationInfo  	Reserve(const Gate&,	size_t no_of_slots=1, bool wait=true, bool whole=false);
 
 	// Not thread-safe. Assumes we use this safely by reserving a space.
-	void 				Write(size_t slot, Elem&&data, bool is_eof);
+	template <typename T>
+	void 				Write(size_t slot, T&& data, bool is_eof);
+
+	// Hands out the reserved slots [slot_begin, slot_end) to be filled in place.
+	WriteClaim<Elem, _WP, _WS, _SL> 	Claim(size_t slot_begin, size_t slot_end);
+};
+
+//---------------------------------------------------------------------------
+// Slots reserved by a writer, filled in place and published together with a single cursor update.
+// Publishes on destruction unless already published, so a claim can never stall the ring.
+// Move-only. Not thread-safe; belongs to the writer that claimed it.
+template <typename Elem, PublishPolicy _WP, typename _WS, Layout _SL>
+class WriteClaim {
+	using 				_RingBufferT 						= RingBuffer<Elem, _SL>;
+	using 				_WriteCursorT 						= WriteCursor<Elem, _WP, _WS, _SL>;
+public:
+	using 				span_type 							= typename _RingBufferT::span_type;
+
+	constexpr 			WriteClaim() 						= default;
+	constexpr 			WriteClaim(	_RingBufferT* 	buffer, 
+									_WriteCursorT* 	write_cursor, 
+									size_t 			begin, 
+									size_t 			end)
+									:
+									err 			(false),
+									buffer_ 		(buffer),
+									write_cursor_ 	(write_cursor),
+									begin_ 			(begin),
+									end_ 			(end)
+									{}
+						WriteClaim(WriteClaim&& other) noexcept 			{ *this = std::move(other); }
+	WriteClaim& 		operator=(WriteClaim&& other) noexcept;
+						~WriteClaim() 										{ Publish(); }
+
+	bool 				err {true}; // Nothing was claimed.
+
+	size_t 				size() const 						{ return end_ - begin_; }
+	// Sequence number of the idx-th claimed slot.
+	size_t 				sequence(size_t idx) const 			{ return begin_ + idx; }
+	decltype(auto) 		operator[](size_t idx) 				{ return buffer_->at(begin_ + idx); }
+
+	// Constructs the idx-th event in place, replacing whatever the slot held from the previous lap.
+	// A constructor that may throw builds a temporary which is move-assigned, so the slot stays valid.
+	template <typename... Args>
+	Elem& 				Emplace(size_t idx, Args&&... args);
+
+	// The claimed slots as at most two contiguous runs, split where the claim wraps the ring.
+	std::array<span_type, 2> 	segments() const 			{ return buffer_->Spans(begin_, end_); }
+
+	// Makes the whole claim visible to readers. Only the first call has an effect.
+	void 				Publish();
+private:
+	_RingBufferT* 		buffer_{};
+	_WriteCursorT* 		write_cursor_{};
+	size_t 				begin_{};
+	size_t 				end_{};
 };
 
 //---------------------------------------------------------------------------
-template <typename Elem, PublishPolicy>
+template <typename Elem, PublishPolicy, typename _WS = BusySpinWait, Layout _SL = Layout::PADDED>
 class ReadCursor;
 
-template <typename Elem, PublishPolicy P>
+template <typename Elem, PublishPolicy P, typename _WS, Layout _SL>
+class ReadView;
+
+template <typename Elem, PublishPolicy P, typename _WS = BusySpinWait, Layout _SL = Layout::PADDED>
 class ReadResult {	
 public:
 
-	using _BufferIter = typename RingBuffer<Elem>::iterator;
+	using _BufferIter = typename RingBuffer<Elem, _SL>::iterator;
 	constexpr ReadResult() = default;
 	constexpr ReadResult(	_BufferIter 			begin_in, 
 							_BufferIter 			end_in, 
 							bool 					err_in, 
 							size_t 					start, 
 							size_t 					end, 
-							ReadCursor<Elem, P>* 	read_cursor)
+							ReadCursor<Elem, P, _WS, _SL>* 	read_cursor)
 							:  
 							begin					(std::move(begin_in)), 
 							end						(std::move(end_in)), 
@@ -230,88 +458,231 @@ public:
 	_BufferIter 			end;
 	bool 					err {true}; // Default must be true. Don't change.
 	void 					Release() {if (read_cursor_) { read_cursor_->Publish(start_, end_);}}
+	// Sequence number of the first element read.
+	size_t 					sequence() const 						{ return start_; }
 private:
 	size_t 					start_;
 	size_t 					end_;
-	ReadCursor<Elem, P>* 	read_cursor_;	
+	ReadCursor<Elem, P, _WS, _SL>* 	read_cursor_;	
 };
 
 //---------------------------------------------------------------------------
-template <typename Elem, PublishPolicy P>
-class ReadCursor: public Cursor<ReadCursor<Elem, P>, Elem, P>{
+// Zero-copy view of a read reservation as at most two contiguous runs of ring memory, split where
+// the reservation wraps. With Layout::SOA the runs are plain payload arrays, so loops over them 
+// vectorise; the other layouts yield runs of slots.
+// Released on destruction unless released before. Move-only.
+template <typename Elem, PublishPolicy P, typename _WS = BusySpinWait, Layout _SL = Layout::PADDED>
+class ReadView {
 public:
-	constexpr 			ReadCursor( 	typename RingBuffer<Elem>::SPtr 	buffer )
+	using 					span_type 								= typename RingBuffer<Elem, _SL>::span_type;
+
+	constexpr 				ReadView() 								= default;
+	constexpr 				ReadView(	std::array<span_type, 2> 		segments,
+										size_t 							start,
+										size_t 							end,
+										ReadCursor<Elem, P, _WS, _SL>* 	read_cursor)
 										:
-										Cursor<ReadCursor, Elem, P>			(std::move(buffer), "Reader") 
+										err 			(false),
+										segments_ 		(segments),
+										start_ 			(start),
+										end_ 			(end),
+										read_cursor_ 	(read_cursor)
 										{}
+							ReadView(ReadView&& other) noexcept 	{ *this = std::move(other); }
+	ReadView& 				operator=(ReadView&& other) noexcept;
+							~ReadView() 							{ Release(); }
 
-	template <typename Derived, PublishPolicy P2>
-	ReservationInfo  	Reserve( const Cursor<Derived, Elem, P2 >&, size_t no_of_slots = 1);
+	bool 					err {true}; // Nothing to read.
+
+	size_t 					size() const 							{ return end_ - start_; }
+	// Sequence number of the first element in the view.
+	size_t 					sequence() const 						{ return start_; }
+	const std::array<span_type, 2>& 	segments() const 			{ return segments_; }
+
+	// Hands the slots back to the writer. Only the first call has an effect.
+	void 					Release() 								{ if (read_cursor_) { std::exchange(read_cursor_, nullptr)->Publish(start_, end_);} }
+private:
+	std::array<span_type, 2> 			segments_{};
+	size_t 								start_{};
+	size_t 								end_{};
+	ReadCursor<Elem, P, _WS, _SL>* 		read_cursor_{};
+};
+
+//---------------------------------------------------------------------------
+// Each read cursor sits on its own cache lines so broadcast readers do not false-share.
+template <typename Elem, PublishPolicy P, typename _WS, Layout _SL>
+class alignas(hardware_destructive_interference_size) ReadCursor: public Cursor<ReadCursor<Elem, P, _WS, _SL>, Elem, P, _WS, _SL>{
+public:
+	constexpr 			ReadCursor( 	typename RingBuffer<Elem, _SL>::SPtr 	buffer )
+										:
+										Cursor<ReadCursor, Elem, P, _WS, _SL>			(std::move(buffer), "Reader") 
+										{}
+
+	template <typename Gate>
+	ReservationInfo  	Reserve( const Gate&, size_t no_of_slots = 1);
 	
 	void 				Publish( size_t pos_begin, size_t pos_end );
 	// Not thread-safe. Assumes we use this safely by reserving a space.
-	ReadResult<Elem, P> Read( size_t slot_begin, size_t slot_end );
+	ReadResult<Elem, P, _WS, _SL> Read( size_t slot_begin, size_t slot_end );
+	ReadView<Elem, P, _WS, _SL> 	View( size_t slot_begin, size_t slot_end );
+};
+
+//---------------------------------------------------------------------------
+// A read cursor together with the upstream readers it must trail in a stage graph.
+template <typename Elem, PublishPolicy P, typename _WS = BusySpinWait, Layout _SL = Layout::PADDED>
+struct Consumer {
+	explicit 							Consumer(typename RingBuffer<Elem, _SL>::SPtr buffer)	: cursor(std::move(buffer)) {}
+
+	ReadCursor<Elem, P, _WS, _SL> 				cursor;
+	// Empty when the consumer is only gated on the writer.
+	detail::CursorGroup<ReadCursor<Elem, P, _WS, _SL>> 	upstream{};
 };
 
 //---------------------------------------------------------------------------
-template <typename Elem, PublishPolicy _WP, PublishPolicy _RP>
+template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS = BusySpinWait, Layout _SL = Layout::PADDED>
 class ReaderWriter{
 public:
 	using SPtr = std::shared_ptr<ReaderWriter>;
 
-	constexpr				ReaderWriter (	typename RingBuffer<Elem>::SPtr buffer )
-									:
-									write_cursor_		(WriteCursor<Elem, _WP>(buffer)),
-									read_cursor_		(ReadCursor<Elem, _RP>(buffer)) 
-									{}
-
-	bool 					Write( Elem&& data, bool is_eof );
-
-	// Returns at most num values to be read.
-	ReadResult<Elem, _RP> 	Read(size_t num=1);
-
-	void 					Reset();
+	using _ReadCursorT = ReadCursor<Elem, _RP, _WS, _SL>;
+	using _ConsumerT = Consumer<Elem, _RP, _WS, _SL>;
+
+							ReaderWriter (	typename RingBuffer<Elem, _SL>::SPtr buffer, 
+											ConsumerMode 					mode = ConsumerMode::COMPETING );
+
+	// With no broadcast readers the event is dropped and the write succeeds.
+	template <typename T>
+	bool 					Write( T&& data, bool is_eof );
+
+	// Reserves up to num slots to be filled in place. Fewer are claimed if the ring has less space.
+	// The claim is empty (err set) while there are no broadcast readers.
+	WriteClaim<Elem, _WP, _WS, _SL> 	Claim(size_t num);
+	// As Claim, but returns an empty claim (err set) instead of waiting when the ring is full.
+	WriteClaim<Elem, _WP, _WS, _SL> 	TryClaim(size_t num);
+
+	// Returns at most num values to be read by the given consumer.
+	ReadResult<Elem, _RP, _WS, _SL> 	Read(_ConsumerT& consumer, size_t num=1);
+	// As Read, but as a span view released on destruction.
+	ReadView<Elem, _RP, _WS, _SL> 	View(_ConsumerT& consumer, size_t num=1);
+
+	// Returns the consumer a new reader should use: the shared one when competing, 
+	// a new one gating the writer when broadcasting. A broadcast reader starts at the published 
+	// write cursor, so one added later sees only events written after it.
+	// Not thread-safe: no writer may be active while a reader is added.
+	_ConsumerT* 			AddReader();
+
+	// Adds a broadcast consumer that may only read sequences all upstream consumers have released.
+	// The upstream consumers stop gating the writer since the new one always trails them.
+	// It starts at the slowest upstream consumer. Not thread-safe, as above.
+	_ConsumerT* 			AddReader(const std::vector<const _ConsumerT*>& upstream);
+
+	// Restarts the writer and every reader at sequence, e.g. the one a snapshot covers.
+	// Not thread-safe: nobody may be reading or writing.
+	void 					Reset(size_t sequence = 0);
 	size_t 					GetWriteCursor() const	{ return write_cursor_.GetCursor(); }
+	size_t 					GetWriteGateRefreshes() const	{ return write_cursor_.GateRefreshes(); }
+	WaitSignal& 			signal() const 			{ return buffer_->signal(); }
 
 
 private:
-	WriteCursor<Elem, _WP>	write_cursor_;
-	ReadCursor<Elem, _RP> 	read_cursor_;
+	ReservationInfo 		Reserve(_ConsumerT& consumer, size_t num);
+
+	typename RingBuffer<Elem, _SL>::SPtr 			buffer_;
+	ConsumerMode 								mode_;
+	WriteCursor<Elem, _WP, _WS, _SL>						write_cursor_;
+	// unique_ptr keeps cursor addresses stable as readers are added.
+	std::vector<std::unique_ptr<_ConsumerT>> 	consumers_;
+	// The writer may not lap any of these.
+	detail::CursorGroup<_ReadCursorT> 			gating_cursors_;
 
 };
 
 //---------------------------------------------------------------------------
-template <typename Elem, PublishPolicy _WP, PublishPolicy _RP>
+template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS = BusySpinWait, Layout _SL = Layout::PADDED>
 class Writer {
-	using 				_ReadWriterSPtr 						= typename ReaderWriter<Elem,  _WP, _RP>::SPtr;
+	using 				_ReadWriterSPtr 						= typename ReaderWriter<Elem, _WP, _RP, _WS, _SL>::SPtr;
 
 public:
 	constexpr			Writer(_ReadWriterSPtr  reader_writer)	: reader_writer_(std::move(reader_writer)){}
 
 	// Blocking write with universal forwarding.
-	bool 				Write(Elem&& data, bool is_eof=false) 	{ return reader_writer_->Write(std::forward<Elem>(data),is_eof); }
+	template <typename T = Elem>
+	bool 				Write(T&& data, bool is_eof=false) 		{ return reader_writer_->Write(std::forward<T>(data),is_eof); }
+	// Zero-copy batch write: claim up to num slots, fill them in place, then publish the claim.
+	WriteClaim<Elem, _WP, _WS, _SL> 	Claim(size_t num) 		{ return reader_writer_->Claim(num); }
+	// Never waits: an empty claim (err set) means the ring was full.
+	WriteClaim<Elem, _WP, _WS, _SL> 	TryClaim(size_t num) 	{ return reader_writer_->TryClaim(num); }
 	size_t 				GetCursor() const 						{ return reader_writer_->GetWriteCursor();}
+	// Counted on the write cursor, so it covers every writer of the ring.
+	size_t 				GateRefreshes() const 					{ return reader_writer_->GetWriteGateRefreshes(); }
 private:
 	_ReadWriterSPtr 	reader_writer_;
 };
 
 //---------------------------------------------------------------------------
-template <typename Elem, PublishPolicy _WP, PublishPolicy _RP>
+template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS = BusySpinWait, Layout _SL = Layout::PADDED>
 class Reader {
-	using 					_ReadWriterSPtr 							= typename ReaderWriter<Elem,  _WP, _RP>::SPtr;
+	using 					_ReadWriterSPtr 							= typename ReaderWriter<Elem, _WP, _RP, _WS, _SL>::SPtr;
+	using 					_ConsumerT 									= Consumer<Elem, _RP, _WS, _SL>;
 public:
-	constexpr				Reader (_ReadWriterSPtr reader_writer)		:reader_writer_(std::move(reader_writer)){}
+	constexpr				Reader (_ReadWriterSPtr reader_writer, _ConsumerT* consumer)		
+								:
+								reader_writer_		(std::move(reader_writer)),
+								consumer_			(consumer)
+								{}
+
+	ReadResult<Elem, _RP, _WS, _SL> 	Read(size_t slot)							{ return reader_writer_->Read(*consumer_, slot); }
+	// Zero-copy read of at most num events as contiguous spans; released when the view goes out of scope.
+	ReadView<Elem, _RP, _WS, _SL> 		View(size_t num)							{ return reader_writer_->View(*consumer_, num); }
+	size_t 					GetCursor() const 							{ return consumer_->cursor.GetCursor(); }
+	// Counted on the consumer's cursor, so competing readers share the count.
+	size_t 					GateRefreshes() const 						{ return consumer_->cursor.GateRefreshes(); }
+	const _ConsumerT* 		consumer() const 							{ return consumer_; }
+	// What to wait on when there is nothing to read.
+	WaitSignal& 			signal() const 								{ return reader_writer_->signal(); }
+private:
+	_ReadWriterSPtr 		reader_writer_;
+	_ConsumerT* 			consumer_;
+};
 
-	ReadResult<Elem, _RP> 	Read(size_t slot)							{ return reader_writer_->Read(slot); }
+//---------------------------------------------------------------------------
+// A stage of broadcast readers in a consumer graph over one ring buffer. 
+// Stages are chained with Then() and joined with And(), e.g. a diamond:
+//		auto decode = disruptor.HandleEventsWith(1);
+//		auto enrich = decode.Then(1);
+//		auto risk   = decode.Then(1);
+//		auto route  = enrich.And(risk).Then(1);
+// Events are processed in place; each stage only sees sequences every upstream reader has released.
+template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS = BusySpinWait, Layout _SL = Layout::PADDED>
+class ReaderGroup {
+	using 					_ReadWriterSPtr 							= typename ReaderWriter<Elem, _WP, _RP, _WS, _SL>::SPtr;
+	using 					_ReaderT 									= Reader<Elem, _WP, _RP, _WS, _SL>;
+public:
+							ReaderGroup(_ReadWriterSPtr reader_writer, std::vector<_ReaderT> readers)
+								:
+								reader_writer_		(std::move(reader_writer)),
+								readers_			(std::move(readers))
+								{}
+
+	// Adds a stage of num readers, each gated on every reader of this group.
+	ReaderGroup 			Then(size_t num = 1) const;
+	// Combines the readers of two groups so the next stage waits on both.
+	ReaderGroup 			And(const ReaderGroup& other) const;
+
+	_ReaderT& 				operator[](size_t idx) 						{ return readers_[idx]; }
+	size_t 					size() const 								{ return readers_.size(); }
+	auto 					begin() 									{ return readers_.begin(); }
+	auto 					end() 										{ return readers_.end(); }
 private:
 	_ReadWriterSPtr 		reader_writer_;
+	std::vector<_ReaderT> 	readers_;
 };
 
 //---------------------------------------------------------------------------
-template <typename Elem, PublishPolicy _WP, PublishPolicy _RP>
+template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS = BusySpinWait, Layout _SL = Layout::PADDED>
 class SingleDisruptor{
-	using 				_ReaderWriterT		= typename ReaderWriter<Elem, _WP, _RP>::SPtr;
-	using 				_RingBufferT 		= typename RingBuffer<Elem>::SPtr;
+	using 				_ReaderWriterT		= typename ReaderWriter<Elem, _WP, _RP, _WS, _SL>::SPtr;
+	using 				_RingBufferT 		= typename RingBuffer<Elem, _SL>::SPtr;
 public:
 	constexpr 			SingleDisruptor(	_ReaderWriterT 		reader_writer, 
 											_RingBufferT 		buffer)
@@ -321,21 +692,31 @@ public:
 											{}
 
 
-	Writer<Elem, _WP, _RP> 		CreateWriter ();
-	Reader<Elem, _WP, _RP> 		CreateReader ();
+	Writer<Elem, _WP, _RP, _WS, _SL> 		CreateWriter ();
+	Reader<Elem, _WP, _RP, _WS, _SL> 		CreateReader ();
+
+	// First stage of a consumer graph: num readers gated on the writer only.
+	// Requires ConsumerMode::BROADCAST.
+	ReaderGroup<Elem, _WP, _RP, _WS, _SL> HandleEventsWith (size_t num = 1);
 
 	void 						ResetReaderWriter();
+	// Starts every cursor at sequence instead of 0, e.g. to resume from a snapshot.
+	// Not thread-safe: call before any reads or writes.
+	void 						StartAt(size_t sequence);
 	_RingBufferT  				buffer() 		{ return buffer_; }
 
 	SingleDisruptor(){}
 private:
 	_ReaderWriterT					reader_writer_;
-	typename RingBuffer<Elem>::SPtr buffer_;
+	typename RingBuffer<Elem, _SL>::SPtr buffer_;
 };
 
 //---------------------------------------------------------------------------
-template <typename Elem, PublishPolicy _WP=PublishPolicy::BUFFERED, PublishPolicy _RP=PublishPolicy::BUFFERED>
- SingleDisruptor<Elem, _WP, _RP> MakeSingleDisruptor();
+// The capacity must satisfy IsValidCapacity. The allocator provides the ring's storage.
+template <typename Elem, PublishPolicy _WP=PublishPolicy::BUFFERED, PublishPolicy _RP=PublishPolicy::BUFFERED, typename _WS=BusySpinWait, Layout _SL=Layout::PADDED, typename _Alloc=HeapAllocator>
+ SingleDisruptor<Elem, _WP, _RP, _WS, _SL> MakeSingleDisruptor(	ConsumerMode 	mode 		= ConsumerMode::COMPETING, 
+															size_t 			capacity 	= DEFAULT_CAPACITY, 
+															_Alloc 			alloc 		= {});
 
 } //disruptor
 #include "disruptor.ipp"
@@ -1,6 +1,8 @@
+#include <algorithm>
 #include <iostream>
 #include <stdlib.h>
 #include <tuple>
+#include <type_traits>
 #include <mutex>
 #include <cassert>
 #include <chrono>
@@ -27,12 +29,76 @@ namespace {
 	#endif
 }
 
+//---------------------------------------------------------------------------
+template<typename Elem, Layout L>
+template<typename Alloc>
+RingBuffer<Elem, L>::RingBuffer(size_t capacity, Alloc alloc)
+	:
+	mask_ 	(capacity - 1)
+{
+	assert(IsValidCapacity(capacity));
+	constexpr size_t PAD = hardware_destructive_interference_size;
+	auto round_up = [](size_t bytes) { return (bytes + PAD - 1) & ~(PAD - 1); };
+
+	// [pad][slots or payloads][pad]([flags][pad] for SOA)
+	const size_t data_bytes = round_up(capacity * (IS_SOA ? sizeof(Elem) : sizeof(Sequence<Elem, L>)));
+	const size_t bytes = PAD + data_bytes + PAD + (IS_SOA ? round_up(capacity) + PAD : 0);
+
+	auto* base = static_cast<std::byte*>(alloc.allocate(bytes, PAD));
+	if constexpr (IS_SOA) 
+	{
+		data_ = reinterpret_cast<Elem*>(base + PAD);
+		is_eof_ = reinterpret_cast<bool*>(base + PAD + data_bytes + PAD);
+		std::uninitialized_value_construct_n(data_, capacity);
+		std::uninitialized_value_construct_n(is_eof_, capacity);
+	} 
+	else 
+	{
+		slots_ = reinterpret_cast<Sequence<Elem, L>*>(base + PAD);
+		std::uninitialized_value_construct_n(slots_, capacity);
+	}
+
+	storage_ = _Storage(base, [alloc, capacity, bytes, slots = slots_, data = data_](std::byte* ptr) mutable 
+		{
+			if constexpr (IS_SOA) 	std::destroy_n(data, capacity);
+			else 					std::destroy_n(slots, capacity);
+			alloc.deallocate(ptr, bytes, PAD);
+		});
+}
+
+//---------------------------------------------------------------------------
+template<typename Elem, Layout L>
+decltype(auto) RingBuffer<Elem, L>::at(size_t pos) 
+{
+	const size_t idx = this->GetBufferIDx(pos);
+	if constexpr (IS_SOA) 
+		return SlotRef<Elem>(data_ + idx, is_eof_ + idx);
+	else 
+		return (slots_[idx]);
+}
+
+//---------------------------------------------------------------------------
+template<typename Elem, Layout L>
+auto RingBuffer<Elem, L>::Spans(size_t pos_begin, size_t pos_end) -> std::array<span_type, 2>
+{
+	assert(pos_begin <= pos_end && pos_end - pos_begin <= this->size());
+	const size_t first = this->GetBufferIDx(pos_begin);
+	const size_t count = pos_end - pos_begin;
+	const size_t head = std::min(count, this->size() - first);
+
+	auto* base = [this] { 
+		if constexpr (IS_SOA) 	return data_;
+		else 					return slots_;
+	}();
+	return {span_type(base + first, head), span_type(base, count - head)};
+}
+
 namespace detail{
 
 	//---------------------------------------------------------------------------
-	std::mutex mout;
+	inline std::mutex mout;
 	template<>
-	std::ostream& operator<<(std::ostream& os, const CursorUpdateHelper<PublishPolicy::BUFFERED>& c) 
+	inline std::ostream& operator<<(std::ostream& os, const CursorUpdateHelper<PublishPolicy::BUFFERED>& c) 
 	{
 		std::scoped_lock lk(mout);
 		os <<"//--------------CursorUpdateHelper---------------\n";
@@ -49,7 +115,7 @@ namespace detail{
 
 	//---------------------------------------------------------------------------
 	template <> 
-	std::ostream& operator<< (std::ostream& os, const CursorUpdateHelper< PublishPolicy::BLOCK>& c) 
+	inline std::ostream& operator<< (std::ostream& os, const CursorUpdateHelper< PublishPolicy::BLOCK>& c) 
 	{
 		std::scoped_lock lk(mout);
 		os <<"//--------------CursorUpdateHelper---------------\n";
@@ -59,7 +125,40 @@ namespace detail{
 	}
 
 	//---------------------------------------------------------------------------
-	PublishUpdateStatus CursorUpdateHelper<PublishPolicy::BUFFERED>::UpdateCursor(const size_t pos_begin, const size_t pos_end) 
+	template <> 
+	inline std::ostream& operator<< (std::ostream& os, const CursorUpdateHelper< PublishPolicy::AVAILABILITY>& c) 
+	{
+		std::scoped_lock lk(mout);
+		os <<"//--------------CursorUpdateHelper---------------\n";
+		os << "Cursor: " <<c.cursor_ ;
+		os << ", Capacity: " <<c.mask_ + 1;
+		os << "\n------------------------------------------\n";
+		return os;
+	}
+
+	//---------------------------------------------------------------------------
+	template <> 
+	inline std::ostream& operator<< (std::ostream& os, const CursorUpdateHelper< PublishPolicy::SINGLE>& c) 
+	{
+		std::scoped_lock lk(mout);
+		os <<"//--------------CursorUpdateHelper---------------\n";
+		os << "Cursor: " <<c.cursor_ ;
+		os << "\n------------------------------------------\n";
+		return os;
+	}
+
+	//---------------------------------------------------------------------------
+	template<PublishPolicy P>
+	CursorUpdateHelper<P> MakeCursorUpdateHelper(const std::string& type, size_t capacity) 
+	{
+		if constexpr (P == PublishPolicy::AVAILABILITY) 
+			return CursorUpdateHelper<P>(type, capacity);
+		else
+			return CursorUpdateHelper<P>(type);
+	}
+
+	//---------------------------------------------------------------------------
+	inline PublishUpdateStatus CursorUpdateHelper<PublishPolicy::BUFFERED>::UpdateCursor(const size_t pos_begin, const size_t pos_end) 
 	{
 		
 		PublishUpdateStatus err = PublishUpdateStatus::SUCCESS;
@@ -132,56 +231,150 @@ namespace detail{
 	}
 
 	//---------------------------------------------------------------------------
-	PublishUpdateStatus CursorUpdateHelper<PublishPolicy::BLOCK>::UpdateCursor(const size_t pos_begin, const size_t pos_end) 
+	inline PublishUpdateStatus CursorUpdateHelper<PublishPolicy::BLOCK>::UpdateCursor(std::atomic<size_t>& cursor, const size_t pos_begin, const size_t pos_end) 
 	{
+		// Only succeeds once every earlier reservation has been published. 
+		// The caller decides how to wait before retrying.
 		size_t expected = pos_begin;
-		while (!cursor_.compare_exchange_weak(expected, pos_end)) {
-				expected = pos_begin;
+		if (!cursor.compare_exchange_strong(expected, pos_end, std::memory_order_acq_rel)) 
+			return PublishUpdateStatus::PENDING;
+		return PublishUpdateStatus::SUCCESS;
+	}
+
+	//---------------------------------------------------------------------------
+	inline PublishUpdateStatus CursorUpdateHelper<PublishPolicy::SINGLE>::UpdateCursor(std::atomic<size_t>& cursor, [[maybe_unused]] const size_t pos_begin, const size_t pos_end) 
+	{
+		assert(pos_begin == cursor.load(std::memory_order_relaxed));
+		cursor.store(pos_end, std::memory_order_release);
+		return PublishUpdateStatus::SUCCESS;
+	}
+
+	//---------------------------------------------------------------------------
+	inline CursorUpdateHelper<PublishPolicy::AVAILABILITY>::CursorUpdateHelper(const std::string& type, size_t capacity)
+		:
+		available_		(std::make_unique<std::atomic<size_t>[]>(capacity)),
+		mask_			(capacity - 1),
+		lap_shift_		(std::countr_zero(capacity)),
+		type_			(type)
+	{
+		assert(std::has_single_bit(capacity));
+	}
+
+	//---------------------------------------------------------------------------
+	inline PublishUpdateStatus CursorUpdateHelper<PublishPolicy::AVAILABILITY>::UpdateCursor(const size_t pos_begin, const size_t pos_end) 
+	{
+		assert(pos_begin<pos_end);
+		// Each slot is owned by its publisher until marked, so a plain release store is enough.
+		for (size_t pos = pos_begin; pos < pos_end; ++pos) 
+		{
+			available_[pos & mask_].store(Lap(pos), std::memory_order_release);
 		}
 		return PublishUpdateStatus::SUCCESS;
 	}
-	
+
+	//---------------------------------------------------------------------------
+	inline size_t CursorUpdateHelper<PublishPolicy::AVAILABILITY>::cursor() const 
+	{
+		size_t c = cursor_.load(std::memory_order_acquire);
+		size_t next = c;
+
+		// Slots ahead of the cursor either hold the current lap or a stale one. 
+		// A publisher can never be more than a lap ahead, so the scan is bounded by the capacity.
+		while (available_[next & mask_].load(std::memory_order_acquire) == Lap(next)) 
+			++next;
+
+		// Other threads may have advanced the cursor concurrently; only ever move it forward.
+		while (c < next && !cursor_.compare_exchange_weak(c, next, std::memory_order_acq_rel)) 
+			;
+		return next;
+	}
+
+	//---------------------------------------------------------------------------
+	inline void CursorUpdateHelper<PublishPolicy::AVAILABILITY>::Reset(size_t sequence) 
+	{
+		// No slot holds a lap yet, so the scan from the new cursor stops straight away.
+		for (size_t i = 0; i <= mask_; ++i) 
+			available_[i].store(0, std::memory_order_relaxed);
+		cursor_.store(sequence, std::memory_order_release);
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename CursorT>
+	size_t CursorGroup<CursorT>::GetCursor() const
+	{
+		assert(!cursors_.empty());
+		size_t min_cursor = cursors_.front()->GetCursor();
+		for (auto iter = cursors_.begin()+1; iter != cursors_.end(); ++iter) 
+		{
+			min_cursor = std::min(min_cursor, (*iter)->GetCursor());
+		}
+		return min_cursor;
+	}
 
 }// namespace detail
 
 //---------------------------------------------------------------------------
-template <typename Elem, PublishPolicy _WP>
-template <class Derived, PublishPolicy P2>
-ReservationInfo WriteCursor<Elem, _WP>::Reserve(const Cursor<Derived, Elem, P2>& read_cursor,
-		size_t no_of_slots)
+template <typename Elem, PublishPolicy _WP, typename _WS, Layout _SL>
+template <typename Gate>
+ReservationInfo WriteCursor<Elem, _WP, _WS, _SL>::Reserve(const Gate& read_cursor,
+		size_t no_of_slots, bool wait, bool whole)
 {
 	size_t expected, new_sequence;
-	bool err = false;
 
 	auto wait_for_available_space = [&]() 
 		{		
-			expected = this->claim_sequence_.load(std::memory_order_acquire); 
-			size_t read_cursor_seq = read_cursor.GetCursor();
-			
-			if (err = expected < read_cursor_seq; err ) 
+			size_t read_cursor_seq;
+			do 
 			{
-				Print("write claim seq: ", expected
-						,", read cursor: ", read_cursor_seq
-						, '\n');
-				return true;
-			}
+				expected = this->claim_sequence_.load(std::memory_order_acquire); 
+				read_cursor_seq = this->cached_gate_.load(std::memory_order_acquire);
+
+				// Only look at the readers when the cached position cannot satisfy the request, 
+				// i.e. for single slots when the ring looks full. 
+				// Another writer may have claimed past the cache, hence >= rather than ==.
+				const size_t cached_used = expected - read_cursor_seq;
+				if (expected < read_cursor_seq || cached_used >= this->buffer_->size() || this->buffer_->size() - cached_used < no_of_slots) 
+				{
+					read_cursor_seq = read_cursor.GetCursor();
+					this->cached_gate_.store(read_cursor_seq, std::memory_order_release);
+					this->gate_refreshes_.fetch_add(1, std::memory_order_relaxed);
+				}
+				// Readers never pass the claim sequence. A gate ahead of it means other writers claimed,
+				// and readers consumed, after expected was loaded: reload rather than fail.
+				if (expected < read_cursor_seq) 
+				{
+					Print("write claim seq: ", expected
+							,", read cursor: ", read_cursor_seq
+							, '\n');
+				}
+			} while (expected < read_cursor_seq);
 		
 		size_t claim_capacity =  this->buffer_->size() - (expected - read_cursor_seq);
 
 		new_sequence = expected + std::min(claim_capacity, no_of_slots);
-		return claim_capacity == 0;
+		return claim_capacity == 0 || (whole && claim_capacity < no_of_slots);
 	};
 	
 	// Available size can be zero and so we have to wait until slow reads are completed.
+	_WS waiter;
 	while (wait_for_available_space()) {
-		if (err) return {0, 0, true};
+		if (!wait) return {0, 0, true};
+		waiter.Wait(this->buffer_->signal());
+	}
+
+	// A single writer owns the claim sequence outright.
+	if constexpr (_WP == PublishPolicy::SINGLE) 
+	{
+		this->claim_sequence_.store(new_sequence, std::memory_order_relaxed);
+		return {expected, new_sequence, false};
 	}
 
 	// Now there is space, update claim sequence.
 	while (!this->claim_sequence_.compare_exchange_weak( expected, new_sequence )) 
 	{
 		while (wait_for_available_space()) {
-			if (err) return {0, 0, true};
+			if (!wait) return {0, 0, true};
+			waiter.Wait(this->buffer_->signal());
 		}
 	}
 	
@@ -190,34 +383,98 @@ ReservationInfo WriteCursor<Elem, _WP>::Reserve(const Cursor<Derived, Elem, P2>&
 }
 
 //---------------------------------------------------------------------------	
-template <typename Elem, PublishPolicy _WP>
-void WriteCursor<Elem, _WP>::Write(size_t slot, Elem&&data, bool is_eof ) 
+template <typename Elem, PublishPolicy _WP, typename _WS, Layout _SL>
+template <typename T>
+void WriteCursor<Elem, _WP, _WS, _SL>::Write(size_t slot, T&& data, bool is_eof ) 
 {
 	// We assume no write contentions as slot is reserved.
-	this->buffer_->at(slot).data() = data;
+	auto&& sequence = this->buffer_->at(slot);
+	sequence.data() = std::forward<T>(data);
+	// Always stored: the slot may still carry the end-of-stream flag from an earlier lap.
+	sequence.set_eof(is_eof);
+}
+
+//---------------------------------------------------------------------------	
+template <typename Elem, PublishPolicy _WP, typename _WS, Layout _SL>
+WriteClaim<Elem, _WP, _WS, _SL> WriteCursor<Elem, _WP, _WS, _SL>::Claim(size_t slot_begin, size_t slot_end) 
+{
+	// Clear end-of-stream flags left from an earlier lap; set_eof on a slot marks a new one.
+	for (size_t slot = slot_begin; slot < slot_end; ++slot)
+		this->buffer_->at(slot).set_eof(false);
+	return WriteClaim<Elem, _WP, _WS, _SL>(this->buffer_.get(), this, slot_begin, slot_end);
+}
+
+//---------------------------------------------------------------------------	
+template <typename Elem, PublishPolicy _WP, typename _WS, Layout _SL>
+WriteClaim<Elem, _WP, _WS, _SL>& WriteClaim<Elem, _WP, _WS, _SL>::operator=(WriteClaim&& other) noexcept 
+{
+	if (this != &other) 
+	{
+		Publish();
+		err 			= std::exchange(other.err, true);
+		buffer_ 		= std::exchange(other.buffer_, nullptr);
+		write_cursor_ 	= std::exchange(other.write_cursor_, nullptr);
+		begin_ 			= other.begin_;
+		end_ 			= other.end_;
+	}
+	return *this;
+}
+
+//---------------------------------------------------------------------------	
+template <typename Elem, PublishPolicy _WP, typename _WS, Layout _SL>
+template <typename... Args>
+Elem& WriteClaim<Elem, _WP, _WS, _SL>::Emplace(size_t idx, Args&&... args) 
+{
+	assert(idx < this->size());
+	auto&& slot = buffer_->at(begin_ + idx);
+	slot.set_eof(false);
+	Elem* data = &slot.data();
+	if constexpr (std::is_nothrow_constructible_v<Elem, Args...>)
+	{
+		std::destroy_at(data);
+		return *std::construct_at(data, std::forward<Args>(args)...);
+	}
+	else
+	{
+		*data = Elem(std::forward<Args>(args)...);
+		return *data;
+	}
+}
 
-	if (is_eof) [[unlikely]] 
-		this->buffer_->at(slot).set_eof(is_eof);
+//---------------------------------------------------------------------------	
+template <typename Elem, PublishPolicy _WP, typename _WS, Layout _SL>
+void WriteClaim<Elem, _WP, _WS, _SL>::Publish() 
+{
+	// One cursor update for the whole claim.
+	if (write_cursor_) 
+		std::exchange(write_cursor_, nullptr)->Publish(begin_, end_);
 }
 
 //---------------------------------------------------------------------------	
-template <class Derived, typename Elem, PublishPolicy P>
-void Cursor<Derived, Elem, P>::Publish(size_t pos_begin, size_t pos_end) 
+template <class Derived, typename Elem, PublishPolicy P, typename _WS, Layout _SL>
+void Cursor<Derived, Elem, P, _WS, _SL>::Publish(size_t pos_begin, size_t pos_end) 
 {
-	while (cursor_updater_.UpdateCursor(pos_begin, pos_end)==detail::PublishUpdateStatus::NO_SPACE) {
+	_WS waiter;
+	for (auto status = cursor_updater_.UpdateCursor(pos_begin, pos_end); 
+		status == detail::PublishUpdateStatus::NO_SPACE || status == detail::PublishUpdateStatus::PENDING; 
+		status = cursor_updater_.UpdateCursor(pos_begin, pos_end)) 
+	{
 		Print(" Waiting to publish!"
 			, "cursor type: ", this->type_
 			, ", pos begin: ", pos_begin
 			, ", pos end: ", pos_end 
 			,'\n'
 			, cursor_updater_ );			
+		waiter.Wait(this->buffer_->signal());
 	}
+	// Wake anyone blocked on this cursor moving.
+	_WS::Notify(this->buffer_->signal());
 }
 
 //---------------------------------------------------------------------------	
-template <typename Elem, PublishPolicy _RP>
-template <typename Derived, PublishPolicy P2>
-ReservationInfo ReadCursor<Elem, _RP>::Reserve(const Cursor<Derived, Elem, P2>& write_cursor, size_t no_of_slots) 
+template <typename Elem, PublishPolicy _RP, typename _WS, Layout _SL>
+template <typename Gate>
+ReservationInfo ReadCursor<Elem, _RP, _WS, _SL>::Reserve(const Gate& write_cursor, size_t no_of_slots) 
 {	
 	size_t expected, new_sequence;
 	size_t write_cursor_seq;
@@ -228,7 +485,16 @@ ReservationInfo ReadCursor<Elem, _RP>::Reserve(const Cursor<Derived, Elem, P2>&
 	auto is_no_available_data = [&] () {		
 		
 		expected = this->claim_sequence_.load(std::memory_order_acquire); 
-		write_cursor_seq = write_cursor.GetCursor();
+		write_cursor_seq = this->cached_gate_.load(std::memory_order_acquire);
+
+		// Only look at the writer when the cached position says the ring is empty.
+		// Competing readers may have claimed past the cache, hence <= rather than ==.
+		if (write_cursor_seq <= expected) 
+		{
+			write_cursor_seq = write_cursor.GetCursor();
+			this->cached_gate_.store(write_cursor_seq, std::memory_order_release);
+			this->gate_refreshes_.fetch_add(1, std::memory_order_relaxed);
+		}
 		assert(write_cursor_seq >= expected);
 		size_t claim_capacity = write_cursor_seq - expected;
 
@@ -240,6 +506,13 @@ ReservationInfo ReadCursor<Elem, _RP>::Reserve(const Cursor<Derived, Elem, P2>&
 	if ( is_no_available_data() ) 
 		return{ 0, 0, true};
 
+	// A single reader owns the claim sequence outright.
+	if constexpr (_RP == PublishPolicy::SINGLE) 
+	{
+		this->claim_sequence_.store(new_sequence, std::memory_order_relaxed);
+		return {expected, new_sequence, false};
+	}
+
 	// Now there is space, update claim sequence.
 	while (!this->claim_sequence_.compare_exchange_weak(expected, new_sequence)) 
 	{
@@ -252,10 +525,10 @@ ReservationInfo ReadCursor<Elem, _RP>::Reserve(const Cursor<Derived, Elem, P2>&
 }
 
 //---------------------------------------------------------------------------
-template <typename Elem, PublishPolicy _RP>
-ReadResult<Elem, _RP> ReadCursor<Elem,_RP>::Read(size_t slot_begin, size_t slot_end) 
+template <typename Elem, PublishPolicy _RP, typename _WS, Layout _SL>
+ReadResult<Elem, _RP, _WS, _SL> ReadCursor<Elem, _RP, _WS, _SL>::Read(size_t slot_begin, size_t slot_end) 
 {
-	return ReadResult<Elem, _RP>
+	return ReadResult<Elem, _RP, _WS, _SL>
 	{
 		this->buffer_->GetIterator(slot_begin), 
 		this->buffer_->GetIterator(slot_end), 
@@ -266,83 +539,252 @@ ReadResult<Elem, _RP> ReadCursor<Elem,_RP>::Read(size_t slot_begin, size_t slot_
 	};
 }
 
+//---------------------------------------------------------------------------
+template <typename Elem, PublishPolicy _RP, typename _WS, Layout _SL>
+ReadView<Elem, _RP, _WS, _SL> ReadCursor<Elem, _RP, _WS, _SL>::View(size_t slot_begin, size_t slot_end) 
+{
+	return ReadView<Elem, _RP, _WS, _SL>(this->buffer_->Spans(slot_begin, slot_end), slot_begin, slot_end, this);
+}
+
+//---------------------------------------------------------------------------
+template <typename Elem, PublishPolicy P, typename _WS, Layout _SL>
+ReadView<Elem, P, _WS, _SL>& ReadView<Elem, P, _WS, _SL>::operator=(ReadView&& other) noexcept 
+{
+	if (this != &other) 
+	{
+		Release();
+		err 			= std::exchange(other.err, true);
+		segments_ 		= std::exchange(other.segments_, {});
+		start_ 			= other.start_;
+		end_ 			= other.end_;
+		read_cursor_ 	= std::exchange(other.read_cursor_, nullptr);
+	}
+	return *this;
+}
+
 //---------------------------------------------------------------------------	
-template <typename Elem, PublishPolicy _RP>
-void ReadCursor<Elem, _RP>::Publish(size_t pos_begin, size_t pos_end) {
+template <typename Elem, PublishPolicy _RP, typename _WS, Layout _SL>
+void ReadCursor<Elem, _RP, _WS, _SL>::Publish(size_t pos_begin, size_t pos_end) {
 	Print("Attempting read publish: "
 				, "pos_begin", pos_begin
 				, "pos_end", pos_end
 				, "Read cursor update helper: ", this->cursor_updater_);
 
-	Cursor<ReadCursor<Elem, _RP>, Elem, _RP>::Publish (pos_begin, pos_end);
+	Cursor<ReadCursor<Elem, _RP, _WS, _SL>, Elem, _RP, _WS, _SL>::Publish (pos_begin, pos_end);
 }
 
 //---------------------------------------------------------------------------	
-template <typename Elem, PublishPolicy _WP, PublishPolicy _RP>
-	bool ReaderWriter<Elem, _WP, _RP>::Write(Elem&& data, bool is_eof) 
+template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL>
+	ReaderWriter<Elem, _WP, _RP, _WS, _SL>::ReaderWriter(typename RingBuffer<Elem, _SL>::SPtr buffer, ConsumerMode mode)
+		:
+		buffer_				(std::move(buffer)),
+		mode_				(mode),
+		write_cursor_		(buffer_)
+	{
+		// Competing readers all share the first cursor, which exists from the start 
+		// so writers are gated even before a reader is created.
+		if (mode_ == ConsumerMode::COMPETING) 
+		{
+			consumers_.push_back(std::make_unique<_ConsumerT>(buffer_));
+			gating_cursors_.Add(&consumers_.front()->cursor);
+		}
+	}
+
+//---------------------------------------------------------------------------	
+template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL>
+	Consumer<Elem, _RP, _WS, _SL>* ReaderWriter<Elem, _WP, _RP, _WS, _SL>::AddReader() 
+	{
+		if (mode_ == ConsumerMode::COMPETING) 
+			return consumers_.front().get();
+
+		return AddReader({});
+	}
+
+//---------------------------------------------------------------------------	
+template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL>
+	Consumer<Elem, _RP, _WS, _SL>* ReaderWriter<Elem, _WP, _RP, _WS, _SL>::AddReader(const std::vector<const _ConsumerT*>& upstream) 
+	{
+		assert(mode_ == ConsumerMode::BROADCAST);
+		auto& consumer = consumers_.emplace_back(std::make_unique<_ConsumerT>(buffer_));
+
+		for (const _ConsumerT* dependency: upstream) 
+		{
+			if (!consumer->upstream.Contains(&dependency->cursor)) 
+				consumer->upstream.Add(&dependency->cursor);
+			gating_cursors_.Remove(&dependency->cursor);
+		}
+		// A reader added after writes started sees only what is published from now on.
+		consumer->cursor.Reset(consumer->upstream.empty() ? write_cursor_.GetCursor() : consumer->upstream.GetCursor());
+		gating_cursors_.Add(&consumer->cursor);
+		return consumer.get();
+	}
+
+//---------------------------------------------------------------------------	
+template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL>
+template <typename T>
+	bool ReaderWriter<Elem, _WP, _RP, _WS, _SL>::Write(T&& data, bool is_eof) 
 	{
+		// Broadcast disruptor without readers: nobody can see the event, so it is dropped. 
+		// Not an error, or retry loops would spin until a reader turns up.
+		if (gating_cursors_.empty()) [[unlikely]] 
+			return false;
+
 		// Claim a space. Block if no space.
-		ReservationInfo reservation = write_cursor_.Reserve(read_cursor_);
+		ReservationInfo reservation = write_cursor_.Reserve(gating_cursors_);
 		
 		if (reservation.err) [[unlikely]] 
 			return true;
 
-		write_cursor_.Write(reservation.pos_begin, std::forward<Elem>(data), is_eof);
+		write_cursor_.Write(reservation.pos_begin, std::forward<T>(data), is_eof);
 		write_cursor_.Publish(reservation.pos_begin, reservation.pos_end);
 
 		return false;
 	}
 
 //---------------------------------------------------------------------------	
-template <typename Elem, PublishPolicy _WP, PublishPolicy _RP>
-	ReadResult<Elem, _RP> ReaderWriter<Elem, _WP, _RP>::Read(size_t num) 
+template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL>
+	WriteClaim<Elem, _WP, _WS, _SL> ReaderWriter<Elem, _WP, _RP, _WS, _SL>::Claim(size_t num) 
+	{
+		if (gating_cursors_.empty() || num == 0) [[unlikely]] 
+			return {};
+
+		// Blocks until at least one slot is free, then takes as many as are available up to num.
+		ReservationInfo reservation = write_cursor_.Reserve(gating_cursors_, num);
+
+		if (reservation.err) [[unlikely]] 
+			return {};
+
+		return write_cursor_.Claim(reservation.pos_begin, reservation.pos_end);
+	}
+
+//---------------------------------------------------------------------------	
+template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL>
+	WriteClaim<Elem, _WP, _WS, _SL> ReaderWriter<Elem, _WP, _RP, _WS, _SL>::TryClaim(size_t num) 
+	{
+		if (gating_cursors_.empty() || num == 0) [[unlikely]] 
+			return {};
+
+		ReservationInfo reservation = write_cursor_.Reserve(gating_cursors_, num, false);
+
+		if (reservation.err) 
+			return {};
+
+		return write_cursor_.Claim(reservation.pos_begin, reservation.pos_end);
+	}
+
+//---------------------------------------------------------------------------	
+template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL>
+	ReservationInfo ReaderWriter<Elem, _WP, _RP, _WS, _SL>::Reserve(_ConsumerT& consumer, size_t num) 
+	{
+		// Upstream readers never overtake the writer, so gating on them alone is enough.
+		return consumer.upstream.empty() 
+			? consumer.cursor.Reserve(write_cursor_, num) 
+			: consumer.cursor.Reserve(consumer.upstream, num);
+	}
+
+//---------------------------------------------------------------------------	
+template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL>
+	ReadResult<Elem, _RP, _WS, _SL> ReaderWriter<Elem, _WP, _RP, _WS, _SL>::Read(_ConsumerT& consumer, size_t num) 
 	{
 		// Claim a space. Return err if no space.
-		ReservationInfo reservation = read_cursor_.Reserve(write_cursor_, num);
+		ReservationInfo reservation = Reserve(consumer, num);
 
 		if (reservation.err) [[unlikely]] 
 			return  {}; // Initialised to error state.
 		
-		return std::move (read_cursor_.Read(reservation.pos_begin, reservation.pos_end));
+		return consumer.cursor.Read(reservation.pos_begin, reservation.pos_end);
 	}
 
 //---------------------------------------------------------------------------	
-template <typename Elem, PublishPolicy _WP, PublishPolicy _RP>
-	void ReaderWriter<Elem, _WP, _RP>::Reset() 
+template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL>
+	ReadView<Elem, _RP, _WS, _SL> ReaderWriter<Elem, _WP, _RP, _WS, _SL>::View(_ConsumerT& consumer, size_t num) 
 	{
-		this->read_cursor_.Reset();
-		this->write_cursor_.Reset();
+		ReservationInfo reservation = Reserve(consumer, num);
+
+		if (reservation.err) [[unlikely]] 
+			return  {}; // Initialised to error state.
+		
+		return consumer.cursor.View(reservation.pos_begin, reservation.pos_end);
+	}
+
+//---------------------------------------------------------------------------	
+template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL>
+	void ReaderWriter<Elem, _WP, _RP, _WS, _SL>::Reset(size_t sequence) 
+	{
+		for (auto& consumer: this->consumers_) 
+			consumer->cursor.Reset(sequence);
+		this->write_cursor_.Reset(sequence);
 	}
 
 //---------------------------------------------------------------------------	
-template <typename Elem, PublishPolicy _WP, PublishPolicy _RP>
-	Writer<Elem, _WP, _RP> SingleDisruptor<Elem, _WP, _RP>::CreateWriter () 
+template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL>
+	Writer<Elem, _WP, _RP, _WS, _SL> SingleDisruptor<Elem, _WP, _RP, _WS, _SL>::CreateWriter () 
 	{
-		return Writer<Elem, _WP, _RP>(reader_writer_);
+		return Writer<Elem, _WP, _RP, _WS, _SL>(reader_writer_);
 	}
 
 //---------------------------------------------------------------------------	
-template <typename Elem, PublishPolicy _WP, PublishPolicy _RP>
-	Reader<Elem, _WP, _RP> SingleDisruptor<Elem, _WP, _RP>::CreateReader () 
+template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL>
+	Reader<Elem, _WP, _RP, _WS, _SL> SingleDisruptor<Elem, _WP, _RP, _WS, _SL>::CreateReader () 
+	{
+		return Reader<Elem, _WP, _RP, _WS, _SL>(reader_writer_, reader_writer_->AddReader());
+	}
+
+//---------------------------------------------------------------------------
+template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL>
+	ReaderGroup<Elem, _WP, _RP, _WS, _SL> SingleDisruptor<Elem, _WP, _RP, _WS, _SL>::HandleEventsWith (size_t num) 
+	{
+		std::vector<Reader<Elem, _WP, _RP, _WS, _SL>> readers;
+		for (size_t i = 0; i < num; ++i) 
+			readers.push_back(CreateReader());
+		return {reader_writer_, std::move(readers)};
+	}
+
+//---------------------------------------------------------------------------
+template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL>
+	ReaderGroup<Elem, _WP, _RP, _WS, _SL> ReaderGroup<Elem, _WP, _RP, _WS, _SL>::Then (size_t num) const
 	{
-		return Reader<Elem, _WP, _RP>(reader_writer_);
+		std::vector<const Consumer<Elem, _RP, _WS, _SL>*> upstream;
+		for (const auto& reader: readers_) 
+			upstream.push_back(reader.consumer());
+
+		std::vector<_ReaderT> readers;
+		for (size_t i = 0; i < num; ++i) 
+			readers.emplace_back(reader_writer_, reader_writer_->AddReader(upstream));
+		return {reader_writer_, std::move(readers)};
 	}
 
 //---------------------------------------------------------------------------
-template <typename Elem, PublishPolicy _WP, PublishPolicy _RP>
-	void SingleDisruptor<Elem, _WP, _RP>::ResetReaderWriter() 
+template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL>
+	ReaderGroup<Elem, _WP, _RP, _WS, _SL> ReaderGroup<Elem, _WP, _RP, _WS, _SL>::And (const ReaderGroup& other) const
+	{
+		std::vector<_ReaderT> readers = readers_;
+		readers.insert(readers.end(), other.readers_.begin(), other.readers_.end());
+		return {reader_writer_, std::move(readers)};
+	}
+
+//---------------------------------------------------------------------------
+template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL>
+	void SingleDisruptor<Elem, _WP, _RP, _WS, _SL>::ResetReaderWriter() 
 	{
 		this->reader_writer_->Reset();
 	}
 
 //---------------------------------------------------------------------------
-template <typename Elem, PublishPolicy _WP, PublishPolicy _RP>
- 	SingleDisruptor<Elem, _WP, _RP> MakeSingleDisruptor() 
+template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL>
+	void SingleDisruptor<Elem, _WP, _RP, _WS, _SL>::StartAt(size_t sequence) 
+	{
+		this->reader_writer_->Reset(sequence);
+	}
+
+//---------------------------------------------------------------------------
+template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL, typename _Alloc>
+	SingleDisruptor<Elem, _WP, _RP, _WS, _SL> MakeSingleDisruptor(ConsumerMode mode, size_t capacity, _Alloc alloc) 
 	{
-		auto buffer = std::make_shared<RingBuffer<Elem>>();
+		auto buffer = std::make_shared<RingBuffer<Elem, _SL>>(capacity, std::move(alloc));
 
-		auto reader_writer = std::make_shared<ReaderWriter<Elem, _WP, _RP>>(buffer);
-		SingleDisruptor<Elem, _WP, _RP> disruptor(std::move(reader_writer), std::move(buffer));
+		auto reader_writer = std::make_shared<ReaderWriter<Elem, _WP, _RP, _WS, _SL>>(buffer, mode);
+		SingleDisruptor<Elem, _WP, _RP, _WS, _SL> disruptor(std::move(reader_writer), std::move(buffer));
 
 		return disruptor;
 	}
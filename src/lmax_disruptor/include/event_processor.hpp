@@ -0,0 +1,140 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <future>
+#include <limits>
+#include <thread>
+
+#include "disruptor.hpp"
+#include "thread_runner.hpp"
+
+// Managed consumer loop around a Reader. 
+// The processor drains whatever the ring holds in one batch, hands every event to the handler 
+// and releases the batch with a single cursor update. A handler is any type with
+//		void 	OnEvent(Elem& event, size_t sequence, bool end_of_batch);
+// and optionally
+//		void 	OnStart();
+//		void 	OnShutdown();
+// end_of_batch lets handlers flush I/O or publish downstream once per batch instead of once per event.
+namespace disruptor {
+
+	//---------------------------------------------------------------------------
+	// Runs on its own thread after Start(), or on the caller's with Run().
+	// Stops after Halt(), or by itself after handling an event marked end of stream.
+	// With competing readers only the reader that gets the end of stream event stops.
+	template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL, typename _Handler>
+	class BatchEventProcessor {
+		using 					_ReaderT 									= Reader<Elem, _WP, _RP, _WS, _SL>;
+	public:
+		static constexpr size_t 	MAX_BATCH 	= std::numeric_limits<size_t>::max();
+
+								BatchEventProcessor(	_ReaderT 	reader, 
+														_Handler 	handler, 
+														size_t 		max_batch = MAX_BATCH)
+														:
+														reader_ 		(std::move(reader)),
+														handler_ 		(std::move(handler)),
+														max_batch_ 		(max_batch)
+														{}
+								BatchEventProcessor(const BatchEventProcessor&) 	= delete;
+		BatchEventProcessor& 	operator=(const BatchEventProcessor&) 				= delete;
+								~BatchEventProcessor() 								{ Halt(); Join(); }
+
+		// Processes events on a new thread, placed as config says. Not thread-safe. A processor that
+		// was halted may be started again once joined, and resumes where its reader left off.
+		// Returns true if some of config could not be applied; the processor runs regardless.
+		bool 					Start(const ThreadConfig& config = {});
+		// Processes events on the calling thread until halted or the stream ends.
+		void 					Run();
+		// Asks the processor to stop after its current batch. Thread-safe.
+		void 					Halt();
+		// Waits for a started processor to stop.
+		void 					Join() 								{ if (thread_.joinable()) thread_.join(); }
+
+		bool 					is_running() const 					{ return running_.load(std::memory_order_acquire); }
+		_Handler& 				handler() 							{ return handler_; }
+		const _ReaderT& 		reader() const 						{ return reader_; }
+	private:
+		_ReaderT 				reader_;
+		_Handler 				handler_;
+		size_t 					max_batch_;
+		std::atomic<bool> 		running_{};
+		std::atomic<bool> 		halted_{};
+		std::thread 			thread_;
+	};
+
+	//---------------------------------------------------------------------------
+	template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL, typename _Handler>
+	BatchEventProcessor(Reader<Elem, _WP, _RP, _WS, _SL>, _Handler) -> BatchEventProcessor<Elem, _WP, _RP, _WS, _SL, _Handler>;
+
+	template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL, typename _Handler>
+	BatchEventProcessor(Reader<Elem, _WP, _RP, _WS, _SL>, _Handler, size_t) -> BatchEventProcessor<Elem, _WP, _RP, _WS, _SL, _Handler>;
+
+	//---------------------------------------------------------------------------
+	template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL, typename _Handler>
+	bool BatchEventProcessor<Elem, _WP, _RP, _WS, _SL, _Handler>::Start(const ThreadConfig& config) 
+	{
+		assert(!thread_.joinable());
+		// Cleared here rather than in Run(), so a Halt() straight after Start() is not lost.
+		halted_.store(false, std::memory_order_release);
+		// Running from here on, so a Join() straight after Start() cannot miss the thread.
+		running_.store(true, std::memory_order_release);
+		std::promise<bool> applied;
+		auto err = applied.get_future();
+		thread_ = std::thread([this, config, applied = std::move(applied)] () mutable { 
+			applied.set_value(!ConfigureThisThread(config).empty());
+			Run(); 
+		});
+		return err.get();
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL, typename _Handler>
+	void BatchEventProcessor<Elem, _WP, _RP, _WS, _SL, _Handler>::Run() 
+	{
+		running_.store(true, std::memory_order_release);
+		if constexpr (requires { handler_.OnStart(); }) 
+			handler_.OnStart();
+
+		_WS waiter;
+		while (!halted_.load(std::memory_order_acquire)) 
+		{
+			auto read_result = reader_.Read(max_batch_);
+			if (read_result.err) 
+			{
+				waiter.Wait(reader_.signal());
+				continue;
+			}
+			waiter = _WS{};
+
+			size_t sequence = read_result.sequence();
+			bool is_eof = false;
+			for (auto iter = read_result.begin; iter != read_result.end; ++sequence) 
+			{
+				auto&& slot = *iter;
+				is_eof |= slot.is_eof();
+				handler_.OnEvent(slot.data(), sequence, ++iter == read_result.end);
+			}
+			// One cursor update per batch.
+			read_result.Release();
+
+			if (is_eof) [[unlikely]] 
+				break;
+		}
+
+		if constexpr (requires { handler_.OnShutdown(); }) 
+			handler_.OnShutdown();
+		running_.store(false, std::memory_order_release);
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename Elem, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL, typename _Handler>
+	void BatchEventProcessor<Elem, _WP, _RP, _WS, _SL, _Handler>::Halt() 
+	{
+		halted_.store(true, std::memory_order_release);
+		// Wake the processor if it is blocked waiting for events.
+		_WS::Notify(reader_.signal());
+	}
+
+} // namespace disruptor
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace profiler{
+
+    //---------------------------------------------------------------------------
+    struct Stats{
+        double mean;
+        double max;
+        double min;
+        double stdev;
+        double p50{};
+        double p99{};
+        double p999{};
+        double p9999{};
+        uint64_t count{};
+    };
+
+    //---------------------------------------------------------------------------
+    // Fixed-memory latency histogram in the style of HdrHistogram.
+    // Values below 128 get their own bucket; above that every power of two is split into 64
+    // linear sub-buckets, so any recorded value is reported within 1/64 (~1.6%) of itself.
+    // About 30KB covers the whole uint64_t range.
+    //
+    // Record is wait-free but single-writer: give every recording thread its own histogram
+    // (see HistogramRegistry) and Merge them for reporting. Readers may merge or query
+    // while the owner records; they see a slightly stale but consistent-enough snapshot.
+    class LatencyHistogram{
+        static constexpr int        SUB_BITS        = 7;
+        static constexpr uint64_t   SUB_COUNT       = uint64_t{1} << SUB_BITS;
+        static constexpr uint64_t   HALF_COUNT      = SUB_COUNT / 2;
+        static constexpr size_t     BUCKETS         = SUB_COUNT + (64 - SUB_BITS) * HALF_COUNT;
+      public:
+        LatencyHistogram()                                  = default;
+        LatencyHistogram(const LatencyHistogram& other)     { Merge(other); }
+
+        // Wait-free. Only the owning thread may record.
+        void        Record(uint64_t value);
+        // Adds other's samples to this histogram. This histogram must not be recorded into concurrently.
+        void        Merge(const LatencyHistogram& other);
+        void        Reset();
+
+        uint64_t    count() const               { return count_.load(std::memory_order_relaxed); }
+        uint64_t    min() const                 { return count() ? min_.load(std::memory_order_relaxed) : 0; }
+        uint64_t    max() const                 { return max_.load(std::memory_order_relaxed); }
+        double      mean() const                { return count() ? static_cast<double>(sum_.load(std::memory_order_relaxed)) / static_cast<double>(count()) : 0.; }
+        // Smallest recorded value (to bucket precision) with at least percentile % of samples at or below it.
+        uint64_t    ValueAtPercentile(double percentile) const;
+        profiler::Stats GetStats() const;
+
+        static size_t   BucketIdx(uint64_t value);
+        // Lowest and highest value that fall into the bucket.
+        static uint64_t BucketLow(size_t idx);
+        static uint64_t BucketHigh(size_t idx)  { return idx + 1 < BUCKETS ? BucketLow(idx + 1) - 1 : std::numeric_limits<uint64_t>::max(); }
+
+      private:
+        // Single writer: a relaxed load and store is enough and avoids a locked instruction.
+        static void     Add(std::atomic<uint64_t>& counter, uint64_t delta) { counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed); }
+
+        std::array<std::atomic<uint64_t>, BUCKETS>  counts_{};
+        std::atomic<uint64_t>                       count_{};
+        std::atomic<uint64_t>                       sum_{};
+        std::atomic<uint64_t>                       min_{std::numeric_limits<uint64_t>::max()};
+        std::atomic<uint64_t>                       max_{};
+    };
+
+    //---------------------------------------------------------------------------
+    // Hands every thread its own histogram, so recording never contends, and merges them on demand.
+    // Histograms outlive their threads so samples from finished threads are still reported.
+    class HistogramRegistry{
+      public:
+        // The calling thread's histogram for this registry. Registration takes a lock once per thread.
+        LatencyHistogram&   Local();
+        LatencyHistogram    Merged() const;
+        // Not safe while threads are recording.
+        void                Reset();
+      private:
+        static uint64_t     NextId()    { static std::atomic<uint64_t> id{}; return ++id; }
+
+        // Threads find their histogram by id rather than address, which a later registry could reuse.
+        const uint64_t                  id_{NextId()};
+        mutable std::mutex              lock_;
+        // std::list keeps histogram addresses stable as threads register.
+        std::list<LatencyHistogram>     histograms_;
+    };
+
+    //---------------------------------------------------------------------------
+    inline size_t LatencyHistogram::BucketIdx(uint64_t value)
+    {
+        if (value < SUB_COUNT)
+            return value;
+        // value lies in [2^(SUB_BITS-1+exp), 2^(SUB_BITS+exp)), sub-bucket width 2^exp.
+        const int exp = static_cast<int>(std::bit_width(value)) - SUB_BITS;
+        return SUB_COUNT + static_cast<uint64_t>(exp - 1) * HALF_COUNT + ((value >> exp) - HALF_COUNT);
+    }
+
+    //---------------------------------------------------------------------------
+    inline uint64_t LatencyHistogram::BucketLow(size_t idx)
+    {
+        if (idx < SUB_COUNT)
+            return idx;
+        const int exp = static_cast<int>((idx - SUB_COUNT) / HALF_COUNT) + 1;
+        return ((idx - SUB_COUNT) % HALF_COUNT + HALF_COUNT) << exp;
+    }
+
+    //---------------------------------------------------------------------------
+    inline void LatencyHistogram::Record(uint64_t value)
+    {
+        Add(counts_[BucketIdx(value)], 1);
+        Add(count_, 1);
+        Add(sum_, value);
+        if (value < min_.load(std::memory_order_relaxed)) [[unlikely]]
+            min_.store(value, std::memory_order_relaxed);
+        if (value > max_.load(std::memory_order_relaxed)) [[unlikely]]
+            max_.store(value, std::memory_order_relaxed);
+    }
+
+    //---------------------------------------------------------------------------
+    inline void LatencyHistogram::Merge(const LatencyHistogram& other)
+    {
+        for (size_t i = 0; i < BUCKETS; ++i)
+            Add(counts_[i], other.counts_[i].load(std::memory_order_relaxed));
+        Add(count_, other.count_.load(std::memory_order_relaxed));
+        Add(sum_, other.sum_.load(std::memory_order_relaxed));
+        min_.store(std::min(min_.load(std::memory_order_relaxed), other.min_.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+        max_.store(std::max(max_.load(std::memory_order_relaxed), other.max_.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+    }
+
+    //---------------------------------------------------------------------------
+    inline void LatencyHistogram::Reset()
+    {
+        for (auto& c: counts_)
+            c.store(0, std::memory_order_relaxed);
+        count_.store(0, std::memory_order_relaxed);
+        sum_.store(0, std::memory_order_relaxed);
+        min_.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+    //---------------------------------------------------------------------------
+    inline uint64_t LatencyHistogram::ValueAtPercentile(double percentile) const
+    {
+        const uint64_t total = count();
+        if (total == 0)
+            return 0;
+        const uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile / 100. * static_cast<double>(total))));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i)
+        {
+            seen += counts_[i].load(std::memory_order_relaxed);
+            // Report the bucket's top, clamped to what was actually recorded.
+            if (seen >= target)
+                return std::min(BucketHigh(i), max());
+        }
+        return max();
+    }
+
+    //---------------------------------------------------------------------------
+    inline profiler::Stats LatencyHistogram::GetStats() const
+    {
+        profiler::Stats stats{mean(), static_cast<double>(max()), static_cast<double>(min()), 0};
+        stats.count = count();
+        if (stats.count == 0)
+            return stats;
+
+        // Standard deviation from bucket midpoints, as HdrHistogram does, clamped to the recorded range
+        // so that samples of a single value, which fill one bucket, report no deviation.
+        double variance = 0;
+        for (size_t i = 0; i < BUCKETS; ++i)
+        {
+            const uint64_t c = counts_[i].load(std::memory_order_relaxed);
+            if (c == 0)
+                continue;
+            const double mid = std::clamp((static_cast<double>(BucketLow(i)) + static_cast<double>(BucketHigh(i))) / 2, stats.min, stats.max);
+            variance += static_cast<double>(c) * std::pow(mid - stats.mean, 2);
+        }
+        stats.stdev = std::sqrt(variance / static_cast<double>(stats.count));
+        stats.p50   = static_cast<double>(ValueAtPercentile(50));
+        stats.p99   = static_cast<double>(ValueAtPercentile(99));
+        stats.p999  = static_cast<double>(ValueAtPercentile(99.9));
+        stats.p9999 = static_cast<double>(ValueAtPercentile(99.99));
+        return stats;
+    }
+
+    //---------------------------------------------------------------------------
+    inline LatencyHistogram& HistogramRegistry::Local()
+    {
+        // A thread that records into several registries finds its histograms by registry id.
+        thread_local std::vector<std::pair<uint64_t, LatencyHistogram*>> cache;
+        for (auto& [id, histogram]: cache)
+            if (id == id_)
+                return *histogram;
+
+        std::scoped_lock lk(lock_);
+        auto& histogram = histograms_.emplace_back();
+        cache.emplace_back(id_, &histogram);
+        return histogram;
+    }
+
+    //---------------------------------------------------------------------------
+    inline LatencyHistogram HistogramRegistry::Merged() const
+    {
+        LatencyHistogram merged;
+        std::scoped_lock lk(lock_);
+        for (const auto& histogram: histograms_)
+            merged.Merge(histogram);
+        return merged;
+    }
+
+    //---------------------------------------------------------------------------
+    inline void HistogramRegistry::Reset()
+    {
+        std::scoped_lock lk(lock_);
+        for (auto& histogram: histograms_)
+            histogram.Reset();
+    }
+
+} // namespace profiler
@@ -0,0 +1,603 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tsc_clock.hpp"
+
+// Append-only event journal in preallocated, memory-mapped segment files, for audit and restart.
+// A JournalHandler run by a BatchEventProcessor on its own Reader journals every event off the
+// producer path; a broadcast reader lets it run alongside the business logic:
+//
+//		disruptor::BatchEventProcessor journaller(disruptor.CreateReader(), disruptor::JournalHandler<Order>({"/data/journal"}));
+//		journaller.Start({"journal", {3}});
+//
+// A journal is a directory of <name>-<index>.journal files of segment_size bytes each:
+//		[segment header: magic, format version, index, segment size]		64 bytes
+//		[frame][frame]...[zeroes]
+// and a frame is
+//		[length: header and payload bytes][crc32c][sequence][timestamp ns since the epoch][payload]
+// padded to FRAME_ALIGN. The checksum covers everything but itself, so a frame torn by a crash
+// is detected rather than replayed. A zero length marks the end of a segment's frames.
+//
+// Frames reach the page cache as they are appended; SyncMode decides when they are pushed to disk.
+// OS failures throw std::system_error, as the shared memory ring does.
+namespace disruptor {
+
+	namespace journal {
+		constexpr uint64_t 	MAGIC 			= 0x4c4d4158'4a524e31; // "LMAXJRN1"
+		constexpr uint32_t 	FORMAT_VERSION 	= 1;
+		constexpr size_t 	FRAME_ALIGN 	= 8;
+
+		//---------------------------------------------------------------------------
+		struct alignas(64) SegmentHeader {
+			uint64_t 		magic;
+			uint32_t 		version;
+			uint32_t 		header_size;
+			uint64_t 		index;
+			uint64_t 		segment_size;
+		};
+
+		struct FrameHeader {
+			uint32_t 		length;
+			uint32_t 		checksum;
+			uint64_t 		sequence;
+			int64_t 		timestamp_ns;
+		};
+
+		static_assert(sizeof(SegmentHeader) == 64 && sizeof(FrameHeader) == 24);
+
+		constexpr size_t 	FrameBytes(size_t payload) 		{ return (sizeof(FrameHeader) + payload + FRAME_ALIGN - 1) & ~(FRAME_ALIGN - 1); }
+
+		//---------------------------------------------------------------------------
+		// CRC-32C (Castagnoli), with the SSE4.2 instruction where the CPU has it.
+		namespace detail {
+			inline const std::array<uint32_t, 256>& Crc32cTable()
+			{
+				static const auto table = [] {
+					std::array<uint32_t, 256> t{};
+					for (uint32_t i = 0; i < 256; ++i)
+					{
+						uint32_t crc = i;
+						for (int bit = 0; bit < 8; ++bit)
+							crc = (crc >> 1) ^ (0x82f63b78u & (0u - (crc & 1u)));
+						t[i] = crc;
+					}
+					return t;
+				}();
+				return table;
+			}
+
+			inline uint32_t Crc32cSoftware(uint32_t crc, const std::byte* data, size_t size)
+			{
+				const auto& table = Crc32cTable();
+				for (size_t i = 0; i < size; ++i)
+					crc = (crc >> 8) ^ table[(crc ^ static_cast<uint8_t>(data[i])) & 0xff];
+				return crc;
+			}
+
+		#if defined(__x86_64__)
+			__attribute__((target("sse4.2")))
+			inline uint32_t Crc32cHardware(uint32_t crc, const std::byte* data, size_t size)
+			{
+				uint64_t crc64 = crc;
+				for (; size >= 8; size -= 8, data += 8)
+				{
+					uint64_t word;
+					std::memcpy(&word, data, sizeof(word));
+					crc64 = __builtin_ia32_crc32di(crc64, word);
+				}
+				crc = static_cast<uint32_t>(crc64);
+				for (; size > 0; --size, ++data)
+					crc = __builtin_ia32_crc32qi(crc, static_cast<uint8_t>(*data));
+				return crc;
+			}
+		#endif
+		} // namespace detail
+
+		inline uint32_t Crc32c(const void* data, size_t size, uint32_t crc = 0)
+		{
+			const auto* bytes = static_cast<const std::byte*>(data);
+		#if defined(__x86_64__)
+			static const bool has_sse42 = __builtin_cpu_supports("sse4.2");
+			if (has_sse42)
+				return ~detail::Crc32cHardware(~crc, bytes, size);
+		#endif
+			return ~detail::Crc32cSoftware(~crc, bytes, size);
+		}
+
+		inline uint32_t FrameChecksum(const FrameHeader& header, const std::byte* payload, size_t size)
+		{
+			uint32_t crc = Crc32c(&header.sequence, sizeof(header.sequence) + sizeof(header.timestamp_ns));
+			crc = Crc32c(payload, size, crc);
+			return Crc32c(&header.length, sizeof(header.length), crc);
+		}
+
+		inline std::filesystem::path SegmentPath(const std::filesystem::path& directory, const std::string& name, uint64_t index)
+		{
+			char suffix[32];
+			std::snprintf(suffix, sizeof(suffix), "-%08llu.journal", static_cast<unsigned long long>(index));
+			return directory / (name + suffix);
+		}
+
+		// Index of the last segment of the journal, if it has any.
+		inline std::optional<uint64_t> LastSegment(const std::filesystem::path& directory, const std::string& name)
+		{
+			std::optional<uint64_t> last;
+			std::error_code ec;
+			for (const auto& entry: std::filesystem::directory_iterator(directory, ec))
+			{
+				const std::string file = entry.path().filename().string();
+				unsigned long long index;
+				char tail;
+				if (file.rfind(name + "-", 0) == 0 &&
+					std::sscanf(file.c_str() + name.size(), "-%llu.journa%c", &index, &tail) == 2 && tail == 'l' &&
+					SegmentPath(directory, name, index).filename() == file)
+					last = std::max<uint64_t>(last.value_or(0), index);
+			}
+			return last;
+		}
+
+		//---------------------------------------------------------------------------
+		// One mapped segment file.
+		class Segment {
+		public:
+			// create: make a new segment of size bytes; otherwise open an existing one, read-only unless writable.
+			static Segment 		Open(const std::filesystem::path& path, uint64_t index, size_t size, bool create, bool writable);
+
+								Segment() 								= default;
+								Segment(Segment&& other) noexcept 		{ *this = std::move(other); }
+			Segment& 			operator=(Segment&& other) noexcept
+			{
+				std::swap(mapping_, other.mapping_);
+				std::swap(size_, other.size_);
+				return *this;
+			}
+								~Segment() 								{ if (mapping_) ::munmap(mapping_, size_); }
+
+			std::byte* 			data() const 							{ return static_cast<std::byte*>(mapping_); }
+			size_t 				size() const 							{ return size_; }
+			bool 				is_open() const 						{ return mapping_ != nullptr; }
+			const SegmentHeader& header() const 						{ return *reinterpret_cast<const SegmentHeader*>(mapping_); }
+		private:
+			void* 				mapping_{};
+			size_t 				size_{};
+		};
+
+		inline Segment Segment::Open(const std::filesystem::path& path, uint64_t index, size_t size, bool create, bool writable)
+		{
+			const int fd = ::open(path.c_str(), (writable ? O_RDWR : O_RDONLY) | (create ? O_CREAT | O_EXCL : 0), 0644);
+			if (fd < 0)
+				throw std::system_error(errno, std::generic_category(), "open " + path.string());
+			auto fail = [&](int err, const char* what) {
+				::close(fd);
+				throw std::system_error(err, std::generic_category(), what);
+			};
+
+			if (create)
+			{
+				// Allocate the blocks now so appends never wait on the file system.
+				if (const int err = ::posix_fallocate(fd, 0, static_cast<off_t>(size)); err != 0)
+					fail(err, "posix_fallocate");
+			}
+			else
+			{
+				struct stat st{};
+				if (::fstat(fd, &st) != 0)
+					fail(errno, "fstat");
+				size = static_cast<size_t>(st.st_size);
+				if (size < sizeof(SegmentHeader))
+					fail(EINVAL, "journal segment truncated");
+			}
+
+			// Writers fault the whole segment in up front, off the append path.
+			void* mapping = ::mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+									MAP_SHARED | (writable ? MAP_POPULATE : 0), fd, 0);
+			const int err = errno;
+			::close(fd);
+			if (mapping == MAP_FAILED)
+				throw std::system_error(err, std::generic_category(), "mmap");
+
+			Segment segment;
+			segment.mapping_ = mapping;
+			segment.size_ = size;
+			auto& header = *static_cast<SegmentHeader*>(mapping);
+			if (create)
+			{
+				header = {MAGIC, FORMAT_VERSION, sizeof(SegmentHeader), index, size};
+			}
+			else if (header.magic != MAGIC || header.version != FORMAT_VERSION || header.header_size != sizeof(SegmentHeader) ||
+					header.index != index || header.segment_size != size)
+			{
+				throw std::system_error(std::make_error_code(std::errc::protocol_not_supported), "journal segment header mismatch: " + path.string());
+			}
+			return segment;
+		}
+
+		//---------------------------------------------------------------------------
+		// Offset just past the segment's last intact frame; updates last_sequence if it has any.
+		inline size_t ScanSegment(const Segment& segment, std::optional<uint64_t>& last_sequence)
+		{
+			size_t offset = sizeof(SegmentHeader);
+			while (offset + sizeof(FrameHeader) <= segment.size())
+			{
+				FrameHeader header;
+				std::memcpy(&header, segment.data() + offset, sizeof(header));
+				if (header.length < sizeof(header) || offset + header.length > segment.size())
+					break;
+				const size_t payload = header.length - sizeof(header);
+				if (header.checksum != FrameChecksum(header, segment.data() + offset + sizeof(header), payload))
+					break;
+				last_sequence = header.sequence;
+				offset += FrameBytes(payload);
+			}
+			return offset;
+		}
+	} // namespace journal
+
+	//---------------------------------------------------------------------------
+	enum class SyncMode {
+		// Leave write-back to the kernel: survives a process crash, not a machine crash.
+		NONE,
+		// Start write-back every sync_bytes without waiting for it.
+		ASYNC,
+		// Wait for the disk every sync_bytes.
+		SYNC
+	};
+
+	struct JournalOptions {
+		std::filesystem::path 	directory;
+		std::string 			name 			= "journal";
+		size_t 					segment_size 	= 64 << 20;
+		SyncMode 				sync 			= SyncMode::ASYNC;
+		// Appended bytes between syncs; 0 syncs on every Sync() call.
+		size_t 					sync_bytes 		= 1 << 20;
+	};
+
+	//---------------------------------------------------------------------------
+	// Appends frames to a journal. Not thread-safe: one writer per journal.
+	// Opening an existing journal resumes after its last intact frame, dropping a torn tail.
+	class JournalWriter {
+	public:
+		explicit 				JournalWriter(JournalOptions options);
+								JournalWriter(const JournalWriter&) 	= delete;
+		JournalWriter& 			operator=(const JournalWriter&) 		= delete;
+								// A sync failing here cannot be reported: call Sync(true) first to see it.
+								~JournalWriter() noexcept
+								{
+									try { Sync(true); }
+									catch (const std::system_error&) {}
+								}
+
+		// Returns true if the payload cannot fit in a segment.
+		bool 					Append(uint64_t sequence, const void* data, size_t size, int64_t timestamp_ns);
+		// Syncs as the options say once sync_bytes have been appended since the last sync, or always if forced.
+		void 					Sync(bool force = false);
+
+		// Sequence of the last frame appended, including by earlier writers of this journal.
+		std::optional<uint64_t> last_sequence() const 					{ return last_sequence_; }
+		uint64_t 				segment_index() const 					{ return index_; }
+		// Bytes appended by this writer, framing included.
+		uint64_t 				bytes_written() const 					{ return bytes_written_; }
+		const JournalOptions& 	options() const 						{ return options_; }
+	private:
+		void 					Roll();
+		void 					SyncRange(size_t begin, size_t end, bool wait);
+
+		JournalOptions 			options_;
+		journal::Segment 		segment_;
+		uint64_t 				index_{};
+		size_t 					offset_{sizeof(journal::SegmentHeader)};
+		size_t 					synced_offset_{sizeof(journal::SegmentHeader)};
+		uint64_t 				bytes_written_{};
+		std::optional<uint64_t> last_sequence_;
+	};
+
+	//---------------------------------------------------------------------------
+	struct JournalFrame {
+		uint64_t 					sequence;
+		int64_t 					timestamp_ns;
+		std::span<const std::byte> 	payload;
+	};
+
+	enum class JournalStatus {
+		OK,
+		// No more frames.
+		END,
+		// A frame failed its checksum or framing; nothing after it is read.
+		CORRUPT
+	};
+
+	//---------------------------------------------------------------------------
+	// Reads a journal front to back, one segment mapped at a time. Frames stay valid until the next call.
+	// Meant for journals no writer is appending to; a live tail may read as CORRUPT.
+	class JournalReader {
+	public:
+		// Throws if the journal has no segments.
+		explicit 				JournalReader(std::filesystem::path directory, std::string name = "journal");
+
+		JournalStatus 			Next(JournalFrame& frame);
+		// Skips frames before sequence; the next frame read is the first at or after it.
+		JournalStatus 			Seek(uint64_t sequence);
+	private:
+		bool 					OpenSegment(uint64_t index);
+
+		std::filesystem::path 	directory_;
+		std::string 			name_;
+		uint64_t 				last_index_{};
+		uint64_t 				index_{};
+		journal::Segment 		segment_;
+		size_t 					offset_{};
+		std::optional<JournalFrame> 	peeked_;
+	};
+
+	//---------------------------------------------------------------------------
+	// Handler for BatchEventProcessor that journals every event it is given, tagged with its ring
+	// sequence and the wall-clock time it was journaled. Syncs at the end of batches.
+	template <typename Elem>
+	class JournalHandler {
+		static_assert(std::is_trivially_copyable_v<Elem>, "Journaled events must be trivially copyable.");
+	public:
+		explicit 				JournalHandler(JournalOptions options)
+									:
+									writer_ 		(std::make_unique<JournalWriter>(std::move(options))),
+									// TSC reads are cheaper than the wall clock; offset them once.
+									wall_offset_ns_ (std::chrono::duration_cast<std::chrono::nanoseconds>(
+														std::chrono::system_clock::now().time_since_epoch()).count() -
+													profiler::TscClock::ToNanos(profiler::TscClock::Ticks()))
+									{}
+
+		void 					OnEvent(const Elem& event, size_t sequence, bool end_of_batch)
+		{
+			const bool err = writer_->Append(sequence, &event, sizeof(Elem),
+				wall_offset_ns_ + profiler::TscClock::ToNanos(profiler::TscClock::Ticks()));
+			if (err) [[unlikely]]
+				++dropped_;
+			if (end_of_batch)
+				writer_->Sync();
+		}
+		void 					OnShutdown() 							{ writer_->Sync(true); }
+
+		JournalWriter& 			writer() 								{ return *writer_; }
+		// Events that could not be journaled, because a frame holding one does not fit in a segment.
+		size_t 					dropped() const 						{ return dropped_; }
+	private:
+		// The processor moves its handler; the mapping stays put.
+		std::unique_ptr<JournalWriter> 	writer_;
+		int64_t 				wall_offset_ns_;
+		size_t 					dropped_{};
+	};
+
+	//---------------------------------------------------------------------------
+	enum class ReplayPace {
+		// As fast as the writer accepts events.
+		FULL_SPEED,
+		// Keeps the journaled gaps between events, divided by speed.
+		RECORDED
+	};
+
+	struct ReplayResult {
+		size_t 					events;
+		// END once the whole journal was replayed.
+		JournalStatus 			status;
+	};
+
+	// Writes every remaining frame of the journal to writer as an Elem. A frame whose payload is
+	// not an Elem stops the replay as CORRUPT.
+	template <typename Elem, typename _WriterT>
+	ReplayResult Replay(JournalReader& reader, _WriterT& writer, ReplayPace pace = ReplayPace::FULL_SPEED, double speed = 1.)
+	{
+		static_assert(std::is_trivially_copyable_v<Elem>, "Journaled events must be trivially copyable.");
+		using clock = std::chrono::steady_clock;
+
+		ReplayResult result{0, JournalStatus::OK};
+		clock::time_point start;
+		int64_t first_ns = 0;
+		JournalFrame frame;
+		while ((result.status = reader.Next(frame)) == JournalStatus::OK)
+		{
+			if (frame.payload.size() != sizeof(Elem))
+			{
+				result.status = JournalStatus::CORRUPT;
+				break;
+			}
+			if (pace == ReplayPace::RECORDED)
+			{
+				if (result.events == 0)
+				{
+					start = clock::now();
+					first_ns = frame.timestamp_ns;
+				}
+				const auto due = start + std::chrono::nanoseconds(static_cast<int64_t>(static_cast<double>(frame.timestamp_ns - first_ns) / speed));
+				// Sleep through long gaps, spin through the short ones the scheduler cannot hit.
+				if (due - clock::now() > std::chrono::microseconds(100))
+					std::this_thread::sleep_until(due - std::chrono::microseconds(50));
+				while (clock::now() < due) {}
+			}
+
+			Elem event;
+			std::memcpy(&event, frame.payload.data(), sizeof(Elem));
+			while (writer.Write(event)) {}
+			++result.events;
+		}
+		return result;
+	}
+
+	//---------------------------------------------------------------------------
+	inline JournalWriter::JournalWriter(JournalOptions options)
+		: options_(std::move(options))
+	{
+		assert(options_.segment_size > sizeof(journal::SegmentHeader) && options_.segment_size < (size_t{1} << 32));
+		std::filesystem::create_directories(options_.directory);
+
+		const auto last = journal::LastSegment(options_.directory, options_.name);
+		if (!last)
+		{
+			segment_ = journal::Segment::Open(journal::SegmentPath(options_.directory, options_.name, 0), 0, options_.segment_size, true, true);
+			return;
+		}
+
+		// Resume after the last intact frame of the last segment. The last sequence may be in an
+		// earlier segment if the last one was rolled to but never written.
+		index_ = *last;
+		segment_ = journal::Segment::Open(journal::SegmentPath(options_.directory, options_.name, index_), index_, 0, false, true);
+		offset_ = journal::ScanSegment(segment_, last_sequence_);
+		for (uint64_t index = index_; !last_sequence_ && index-- > 0 && std::filesystem::exists(journal::SegmentPath(options_.directory, options_.name, index)); )
+			journal::ScanSegment(journal::Segment::Open(journal::SegmentPath(options_.directory, options_.name, index), index, 0, false, false), last_sequence_);
+
+		std::byte* data = segment_.data();
+		// A torn tail would otherwise be read back after the frames appended over it.
+		std::memset(data + offset_, 0, segment_.size() - offset_);
+		synced_offset_ = offset_;
+	}
+
+	//---------------------------------------------------------------------------
+	inline bool JournalWriter::Append(uint64_t sequence, const void* data, size_t size, int64_t timestamp_ns)
+	{
+		const size_t frame_bytes = journal::FrameBytes(size);
+		if (frame_bytes > options_.segment_size - sizeof(journal::SegmentHeader))
+			return true;
+		if (offset_ + frame_bytes > segment_.size())
+			Roll();
+
+		std::byte* frame = segment_.data() + offset_;
+		journal::FrameHeader header{static_cast<uint32_t>(sizeof(journal::FrameHeader) + size), 0, sequence, timestamp_ns};
+		header.checksum = journal::FrameChecksum(header, static_cast<const std::byte*>(data), size);
+		std::memcpy(frame + sizeof(header), data, size);
+		std::memcpy(frame, &header, sizeof(header));
+
+		offset_ += frame_bytes;
+		bytes_written_ += frame_bytes;
+		last_sequence_ = sequence;
+		return false;
+	}
+
+	//---------------------------------------------------------------------------
+	inline void JournalWriter::Sync(bool force)
+	{
+		if (!segment_.is_open() || options_.sync == SyncMode::NONE || offset_ == synced_offset_)
+			return;
+		if (!force && offset_ - synced_offset_ < options_.sync_bytes)
+			return;
+		SyncRange(synced_offset_, offset_, force || options_.sync == SyncMode::SYNC);
+		synced_offset_ = offset_;
+	}
+
+	//---------------------------------------------------------------------------
+	inline void JournalWriter::SyncRange(size_t begin, size_t end, bool wait)
+	{
+		static const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+		begin &= ~(page - 1);
+		if (::msync(segment_.data() + begin, end - begin, wait ? MS_SYNC : MS_ASYNC) != 0)
+			throw std::system_error(errno, std::generic_category(), "msync");
+	}
+
+	//---------------------------------------------------------------------------
+	inline void JournalWriter::Roll()
+	{
+		// The segment is complete: before the next one starts, SYNC waits for it to reach the disk
+		// and ASYNC starts its write-back, as Sync would.
+		if (options_.sync != SyncMode::NONE && offset_ > synced_offset_)
+			SyncRange(synced_offset_, offset_, options_.sync == SyncMode::SYNC);
+		++index_;
+		segment_ = journal::Segment::Open(journal::SegmentPath(options_.directory, options_.name, index_), index_, options_.segment_size, true, true);
+		offset_ = synced_offset_ = sizeof(journal::SegmentHeader);
+	}
+
+	//---------------------------------------------------------------------------
+	inline JournalReader::JournalReader(std::filesystem::path directory, std::string name)
+		: directory_(std::move(directory)), name_(std::move(name))
+	{
+		const auto last = journal::LastSegment(directory_, name_);
+		if (!last)
+			throw std::system_error(std::make_error_code(std::errc::no_such_file_or_directory), "no journal segments in " + directory_.string());
+		last_index_ = *last;
+
+		// Segments are never deleted from the middle, but old ones may have been archived.
+		uint64_t first = 0;
+		while (first < last_index_ && !std::filesystem::exists(journal::SegmentPath(directory_, name_, first)))
+			++first;
+		OpenSegment(first);
+	}
+
+	//---------------------------------------------------------------------------
+	inline bool JournalReader::OpenSegment(uint64_t index)
+	{
+		if (index > last_index_)
+			return false;
+		segment_ = journal::Segment::Open(journal::SegmentPath(directory_, name_, index), index, 0, false, false);
+		index_ = index;
+		offset_ = sizeof(journal::SegmentHeader);
+		return true;
+	}
+
+	//---------------------------------------------------------------------------
+	inline JournalStatus JournalReader::Next(JournalFrame& frame)
+	{
+		if (peeked_)
+		{
+			frame = *peeked_;
+			peeked_.reset();
+			return JournalStatus::OK;
+		}
+
+		for (;;)
+		{
+			journal::FrameHeader header{};
+			if (offset_ + sizeof(header) <= segment_.size())
+				std::memcpy(&header, segment_.data() + offset_, sizeof(header));
+			if (header.length == 0)
+			{
+				if (!OpenSegment(index_ + 1))
+					return JournalStatus::END;
+				continue;
+			}
+
+			const std::byte* payload = segment_.data() + offset_ + sizeof(header);
+			const size_t size = header.length - sizeof(header);
+			if (header.length < sizeof(header) || offset_ + header.length > segment_.size() ||
+				header.checksum != journal::FrameChecksum(header, payload, size))
+				return JournalStatus::CORRUPT;
+
+			frame = {header.sequence, header.timestamp_ns, {payload, size}};
+			offset_ += journal::FrameBytes(size);
+			return JournalStatus::OK;
+		}
+	}
+
+	//---------------------------------------------------------------------------
+	inline JournalStatus JournalReader::Seek(uint64_t sequence)
+	{
+		JournalFrame frame;
+		JournalStatus status;
+		while ((status = Next(frame)) == JournalStatus::OK)
+		{
+			if (frame.sequence >= sequence)
+			{
+				peeked_ = frame;
+				break;
+			}
+		}
+		return status;
+	}
+
+} // namespace disruptor
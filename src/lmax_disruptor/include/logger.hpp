@@ -1,6 +1,376 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+
+#include <fmt/format.h>
+
+#include "disruptor.hpp"
+#include "tsc_clock.hpp"
+
+// Asynchronous binary logger.
+// Hot threads copy only the format string's address and the raw argument bytes into a ring;
+// a background thread formats with fmt and writes to the file in batches. Logging a message
+// costs one slot claim and a memcpy of its arguments, whatever the format.
+//
+//		logger::Logger log("engine.log");
+//		log.Info("order {} filled {} @ {}", id, qty, px);
 namespace logger
 {
-    
-    
-} // namespace logger
+    //---------------------------------------------------------------------------
+    enum class Level : uint8_t {DEBUG = 0, INFO, WARN, ERROR};
+
+    // What a hot thread does when the ring is full: lose the message or wait for the consumer.
+    enum class OverflowPolicy {DROP, BLOCK};
+
+    //---------------------------------------------------------------------------
+    struct Options {
+        size_t                      capacity        {1 << 16};
+        OverflowPolicy              overflow        {OverflowPolicy::DROP};
+        Level                       level           {Level::INFO};
+        // Formatted output is written once this much has accumulated, or when the ring runs empty.
+        size_t                      write_bytes     {64 * 1024};
+        // How long the consumer sleeps when there is nothing to log.
+        std::chrono::microseconds   idle_sleep      {100};
+    };
+
+    namespace detail
+    {
+        // Strings are copied into the record, everything else must be trivially copyable.
+        template <typename T>
+        constexpr bool is_string_v = std::is_convertible_v<const T&, std::string_view>;
+
+        template <typename T>
+        using stored_t = std::conditional_t<is_string_v<T>, std::string_view, T>;
+
+        // Bytes an argument takes in a record: strings are a length prefix plus however much of them fits.
+        template <typename T>
+        constexpr size_t fixed_size_v = is_string_v<T> ? sizeof(uint16_t) : sizeof(T);
+
+        using FormatFn = void (*)(fmt::memory_buffer& out, std::string_view format, const std::byte* args);
+
+        //---------------------------------------------------------------------------
+        template <typename T>
+        void Encode(std::byte*& out, const std::byte* end, const T& value)
+        {
+            if constexpr (is_string_v<T>)
+            {
+                std::string_view str;
+                if constexpr (std::is_pointer_v<T>)
+                    str = value ? std::string_view(value) : std::string_view();
+                else
+                    str = value;
+                // end already leaves room for the arguments after this one; the string gets what is left.
+                const auto left = static_cast<size_t>(end - out);
+                const auto room = left > sizeof(uint16_t) ? left - sizeof(uint16_t) : 0;
+                const auto size = static_cast<uint16_t>(std::min(str.size(), room));
+                std::memcpy(out, &size, sizeof(size));
+                std::memcpy(out + sizeof(size), str.data(), size);
+                out += sizeof(size) + size;
+            }
+            else
+            {
+                static_assert(std::is_trivially_copyable_v<T>, "Log arguments must be strings or trivially copyable");
+                std::memcpy(out, &value, sizeof(T));
+                out += sizeof(T);
+            }
+        }
+
+        //---------------------------------------------------------------------------
+        // Encodes args in order. Each argument's end is moved in by the fixed size of those after it,
+        // so a long string is truncated rather than crowding them past the record.
+        template <typename... Ts, typename... Args>
+        void EncodeArgs(std::byte* out, const std::byte* end, const Args&... args)
+        {
+            // trailing[i]: fixed bytes of arguments i and later.
+            constexpr auto trailing = [] {
+                std::array<size_t, sizeof...(Ts) + 1> sizes{fixed_size_v<Ts>..., 0};
+                for (size_t i = sizeof...(Ts); i-- > 0;)
+                    sizes[i] += sizes[i + 1];
+                return sizes;
+            }();
+            [[maybe_unused]] size_t next = 0;
+            (Encode<Ts>(out, end - trailing[++next], args), ...);
+        }
+
+        //---------------------------------------------------------------------------
+        template <typename T>
+        stored_t<T> Decode(const std::byte*& in)
+        {
+            if constexpr (is_string_v<T>)
+            {
+                uint16_t size;
+                std::memcpy(&size, in, sizeof(size));
+                std::string_view str(reinterpret_cast<const char*>(in + sizeof(size)), size);
+                in += sizeof(size) + size;
+                return str;
+            }
+            else
+            {
+                T value;
+                std::memcpy(&value, in, sizeof(T));
+                in += sizeof(T);
+                return value;
+            }
+        }
+
+        //---------------------------------------------------------------------------
+        // One instantiation per argument list, so a record only has to carry a function pointer.
+        template <typename... Args>
+        void FormatArgs(fmt::memory_buffer& out, std::string_view format, const std::byte* args)
+        {
+            // Braced initialisation decodes the arguments left to right.
+            const std::tuple<stored_t<Args>...> values{Decode<Args>(args)...};
+            std::apply([&](const auto&... v) { fmt::vformat_to(fmt::appender(out), format, fmt::make_format_args(v...)); }, values);
+        }
+    } // namespace detail
+
+    //---------------------------------------------------------------------------
+    // A ring slot: two cache lines.
+    struct alignas(64) Record {
+        static constexpr size_t     ARGS_BYTES      = 88;
+
+        detail::FormatFn            format_fn;
+        // The format string itself identifies the message; it must have static storage.
+        const char*                 format;
+        uint32_t                    format_size;
+        uint32_t                    thread_id;
+        uint64_t                    ticks;
+        Level                       level;
+        std::array<std::byte, ARGS_BYTES> args;
+    };
+    static_assert(sizeof(Record) == 128);
+
+    //---------------------------------------------------------------------------
+    // Any number of threads may log. Format strings must be literals (or otherwise outlive the
+    // logger), since only their address is copied. Messages are timestamped on the calling thread
+    // and written in the order they were claimed.
+    class Logger {
+        using _DisruptorT   = disruptor::SingleDisruptor<Record, disruptor::PublishPolicy::BUFFERED, disruptor::PublishPolicy::SINGLE>;
+      public:
+        // Opens path for appending; throws std::system_error if it cannot be opened.
+        explicit    Logger(const std::string& path, Options options = {});
+                    ~Logger();
+                    Logger(const Logger&)               = delete;
+        Logger&     operator=(const Logger&)            = delete;
+
+        // Returns true if the message was dropped because the ring was full.
+        template <typename... Args>
+        bool        Log(Level level, fmt::format_string<Args...> format, Args&&... args);
+
+        template <typename... Args>
+        bool        Debug(fmt::format_string<Args...> format, Args&&... args)  { return Log(Level::DEBUG, format, std::forward<Args>(args)...); }
+        template <typename... Args>
+        bool        Info(fmt::format_string<Args...> format, Args&&... args)   { return Log(Level::INFO, format, std::forward<Args>(args)...); }
+        template <typename... Args>
+        bool        Warn(fmt::format_string<Args...> format, Args&&... args)   { return Log(Level::WARN, format, std::forward<Args>(args)...); }
+        template <typename... Args>
+        bool        Error(fmt::format_string<Args...> format, Args&&... args)  { return Log(Level::ERROR, format, std::forward<Args>(args)...); }
+
+        // Blocks until every message published before the call is on disk. Not for hot threads.
+        void        Flush();
 
+        void        set_level(Level level)              { level_.store(level, std::memory_order_relaxed); }
+        Level       level() const                       { return level_.load(std::memory_order_relaxed); }
+        uint64_t    dropped() const                     { return dropped_.load(std::memory_order_relaxed); }
+
+      private:
+        static uint32_t     ThreadId()                  { static std::atomic<uint32_t> next{}; thread_local const uint32_t id = ++next; return id; }
+        static int64_t      WallOffsetNs();
+
+        void        Run();
+        void        FormatRecord(const Record& record);
+        void        FormatPrefix(int64_t ns, std::string_view level, uint32_t thread_id);
+        void        ReportDrops();
+        void        Write();
+
+        Options                                 options_;
+        std::FILE*                              file_;
+        _DisruptorT                             disruptor_;
+        decltype(disruptor_.CreateWriter())     writer_;
+        decltype(disruptor_.CreateReader())     reader_;
+        const int64_t                           wall_offset_ns_{WallOffsetNs()};
+        std::atomic<Level>                      level_;
+        std::atomic<bool>                       stop_{};
+        std::atomic<uint64_t>                   dropped_{};
+        // Highest write cursor a Flush waits for, and how far the file is known to be flushed.
+        std::atomic<size_t>                     flush_target_{};
+        std::atomic<size_t>                     flushed_{};
+
+        // Consumer-only state.
+        fmt::memory_buffer                      out_;
+        uint64_t                                reported_drops_{};
+        int64_t                                 date_second_{-1};
+        std::array<char, 24>                    date_{};
+        std::thread                             consumer_;
+    };
+
+    //---------------------------------------------------------------------------
+    inline Logger::Logger(const std::string& path, Options options)
+        :
+        options_        (options),
+        file_           (std::fopen(path.c_str(), "a")),
+        disruptor_      (disruptor::MakeSingleDisruptor<Record, disruptor::PublishPolicy::BUFFERED, disruptor::PublishPolicy::SINGLE>(disruptor::ConsumerMode::COMPETING, options.capacity)),
+        writer_         (disruptor_.CreateWriter()),
+        reader_         (disruptor_.CreateReader()),
+        level_          (options.level)
+    {
+        if (!file_)
+            throw std::system_error(errno, std::generic_category(), "fopen " + path);
+        // Output is already batched; stdio buffering would only add a copy.
+        std::setvbuf(file_, nullptr, _IONBF, 0);
+        consumer_ = std::thread([this] { Run(); });
+    }
+
+    //---------------------------------------------------------------------------
+    inline Logger::~Logger()
+    {
+        stop_.store(true, std::memory_order_release);
+        consumer_.join();
+        std::fclose(file_);
+    }
+
+    //---------------------------------------------------------------------------
+    template <typename... Args>
+    bool Logger::Log(Level level, fmt::format_string<Args...> format, Args&&... args)
+    {
+        static_assert((detail::fixed_size_v<std::decay_t<Args>> + ... + 0) <= Record::ARGS_BYTES, "Log arguments do not fit in a record");
+        if (level < level_.load(std::memory_order_relaxed))
+            return false;
+
+        auto claim = options_.overflow == OverflowPolicy::BLOCK ? writer_.Claim(1) : writer_.TryClaim(1);
+        if (claim.err) [[unlikely]]
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        Record& record      = claim[0].data();
+        const fmt::string_view str = format;
+        record.format_fn    = &detail::FormatArgs<std::decay_t<Args>...>;
+        record.format       = str.data();
+        record.format_size  = static_cast<uint32_t>(str.size());
+        record.thread_id    = ThreadId();
+        record.ticks        = profiler::TscClock::Ticks();
+        record.level        = level;
+        detail::EncodeArgs<std::decay_t<Args>...>(record.args.data(), record.args.data() + record.args.size(), args...);
+        return false;
+    }
+
+    //---------------------------------------------------------------------------
+    inline void Logger::Flush()
+    {
+        const size_t target = writer_.GetCursor();
+        size_t current = flush_target_.load(std::memory_order_relaxed);
+        while (current < target && !flush_target_.compare_exchange_weak(current, target)) {}
+        while (flushed_.load(std::memory_order_acquire) < target)
+            std::this_thread::sleep_for(options_.idle_sleep);
+    }
+
+    //---------------------------------------------------------------------------
+    // TscClock shares steady_clock's epoch; this moves its readings onto the wall clock.
+    inline int64_t Logger::WallOffsetNs()
+    {
+        const auto wall = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        return wall - profiler::TscClock::now().time_since_epoch().count();
+    }
+
+    //---------------------------------------------------------------------------
+    inline void Logger::Run()
+    {
+        static constexpr size_t BATCH = 256;
+        while (true)
+        {
+            // Checked before reading: an empty read after stop means everything has been logged.
+            const bool stopping = stop_.load(std::memory_order_acquire);
+            auto read_result = reader_.Read(BATCH);
+            if (read_result.err)
+            {
+                ReportDrops();
+                Write();
+                std::fflush(file_);
+                flushed_.store(reader_.GetCursor(), std::memory_order_release);
+                if (stopping)
+                    break;
+                std::this_thread::sleep_for(options_.idle_sleep);
+                continue;
+            }
+
+            for (auto iter = read_result.begin; iter != read_result.end; ++iter)
+                FormatRecord((*iter).data());
+            read_result.Release();
+            ReportDrops();
+
+            if (out_.size() >= options_.write_bytes)
+                Write();
+            // A Flush is waiting on messages already handled: don't make it wait for the ring to run empty.
+            if (flush_target_.load(std::memory_order_relaxed) > flushed_.load(std::memory_order_relaxed))
+            {
+                Write();
+                std::fflush(file_);
+                flushed_.store(reader_.GetCursor(), std::memory_order_release);
+            }
+        }
+    }
+
+    //---------------------------------------------------------------------------
+    // 2026-10-16 07:12:17.074123456 INFO  [3] message
+    inline void Logger::FormatRecord(const Record& record)
+    {
+        static constexpr std::array<std::string_view, 4> LEVELS{"DEBUG", "INFO ", "WARN ", "ERROR"};
+
+        FormatPrefix(profiler::TscClock::ToNanos(record.ticks) + wall_offset_ns_, LEVELS[static_cast<size_t>(record.level)], record.thread_id);
+        record.format_fn(out_, std::string_view(record.format, record.format_size), record.args.data());
+        out_.push_back('\n');
+    }
+
+    //---------------------------------------------------------------------------
+    inline void Logger::FormatPrefix(int64_t ns, std::string_view level, uint32_t thread_id)
+    {
+        const int64_t second = ns / 1'000'000'000;
+        // The date only changes once a second, so it is formatted once a second.
+        if (second != date_second_)
+        {
+            const std::time_t time = second;
+            std::tm tm;
+            gmtime_r(&time, &tm);
+            std::strftime(date_.data(), date_.size(), "%Y-%m-%d %H:%M:%S", &tm);
+            date_second_ = second;
+        }
+        fmt::format_to(fmt::appender(out_), "{}.{:09} {} [{}] ", date_.data(), ns % 1'000'000'000, level, thread_id);
+    }
+
+    //---------------------------------------------------------------------------
+    inline void Logger::ReportDrops()
+    {
+        const uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+        if (dropped == reported_drops_) [[likely]]
+            return;
+        FormatPrefix(profiler::TscClock::now().time_since_epoch().count() + wall_offset_ns_, "WARN ", 0);
+        fmt::format_to(fmt::appender(out_), "{} messages dropped\n", dropped - reported_drops_);
+        reported_drops_ = dropped;
+    }
+
+    //---------------------------------------------------------------------------
+    inline void Logger::Write()
+    {
+        if (out_.size() == 0)
+            return;
+        std::fwrite(out_.data(), 1, out_.size(), file_);
+        out_.clear();
+    }
+
+} // namespace logger
@@ -0,0 +1,424 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// Limit order book for one instrument, fed from a ring of add/modify/cancel/execute events as a
+// market data feed (e.g. ITCH) reports them, and publishing top-of-book changes to another ring:
+//
+//		auto feed = disruptor::MakeSingleDisruptor<disruptor::BookEvent>(...);
+//		auto tops = disruptor::MakeSingleDisruptor<disruptor::TopOfBook>(...);
+//		disruptor::BatchEventProcessor book(feed.CreateReader(), disruptor::OrderBookHandler({10'000, 20'000, 1 << 20}, tops.CreateWriter()));
+//
+// Nothing is node-based or allocated after construction. Each side's price levels are one array
+// indexed by tick offset from the lowest price, so finding a level is an index and the next best
+// level after one empties is a short scan over neighbouring memory. Orders live in a preallocated
+// pool of nodes, queued per level in time priority, and are found by id through an open-addressing
+// hash with linear probing.
+namespace disruptor {
+
+	//---------------------------------------------------------------------------
+	enum class Side: uint8_t {BUY = 0, SELL};
+
+	// ADD: a new order of quantity at price on side.
+	// MODIFY: the order's new price and quantity. It keeps its time priority only if the price is
+	// unchanged and the quantity does not grow, as exchanges rule.
+	// CANCEL: removes quantity from the order, or all of it when quantity is 0.
+	// EXECUTE: fills quantity of the order.
+	enum class BookEventType: uint8_t {ADD = 0, MODIFY, CANCEL, EXECUTE};
+
+	struct BookEvent {
+		BookEventType 	type;
+		Side 			side; 		// ADD only.
+		uint32_t 		quantity;
+		uint64_t 		order_id;
+		int64_t 		price; 		// In ticks. ADD and MODIFY only.
+	};
+
+	//---------------------------------------------------------------------------
+	// An empty side has zero quantity, and its price is meaningless.
+	struct TopOfBook {
+		int64_t 		bid_price{};
+		uint64_t 		bid_quantity{};
+		int64_t 		ask_price{};
+		uint64_t 		ask_quantity{};
+		// Sequence of the feed event after which the book looked like this.
+		size_t 			sequence{};
+
+		// Same best prices and quantities, whatever the sequence.
+		bool 			SameQuotes(const TopOfBook& other) const;
+	};
+
+	//---------------------------------------------------------------------------
+	enum class BookStatus{OK, UNKNOWN_ORDER, DUPLICATE_ORDER, OUT_OF_RANGE, FULL};
+
+	struct BookConfig {
+		// Prices in [min_price, max_price] ticks.
+		int64_t 		min_price;
+		int64_t 		max_price;
+		size_t 			max_orders;
+	};
+
+	//---------------------------------------------------------------------------
+	// Not thread-safe; owned by the one consumer applying the feed.
+	class OrderBook {
+	public:
+		explicit 				OrderBook(const BookConfig& config);
+
+		// Events that cannot apply leave the book as it was.
+		BookStatus 				Apply(const BookEvent& event);
+
+		TopOfBook 				top() const;
+		uint64_t 				LevelQuantity(Side side, int64_t price) const 	{ return InRange(price) ? levels_[Idx(side)][Offset(price)].quantity : 0; }
+		uint32_t 				LevelOrders(Side side, int64_t price) const 	{ return InRange(price) ? levels_[Idx(side)][Offset(price)].orders : 0; }
+		// Open quantity of an order, 0 if there is no such order.
+		uint64_t 				OrderQuantity(uint64_t order_id) const;
+		size_t 					order_count() const 							{ return order_count_; }
+		const BookConfig& 		config() const 									{ return config_; }
+	private:
+		static constexpr uint32_t 	NIL 	= std::numeric_limits<uint32_t>::max();
+		static constexpr size_t 	NONE 	= std::numeric_limits<size_t>::max();
+
+		struct Level {
+			uint64_t 			quantity{};
+			uint32_t 			orders{};
+			// Oldest and newest orders in the level's queue.
+			uint32_t 			head{NIL};
+			uint32_t 			tail{NIL};
+		};
+
+		struct OrderNode {
+			uint64_t 			id;
+			int64_t 			price;
+			uint32_t 			quantity;
+			uint32_t 			prev;
+			uint32_t 			next;
+			Side 				side;
+		};
+
+		// node is NIL in an empty bucket.
+		struct Bucket {
+			uint64_t 			id{};
+			uint32_t 			node{NIL};
+		};
+
+		static constexpr size_t 	Idx(Side side) 					{ return static_cast<size_t>(side); }
+		bool 					InRange(int64_t price) const 		{ return price >= config_.min_price && price <= config_.max_price; }
+		size_t 					Offset(int64_t price) const 		{ return static_cast<size_t>(price - config_.min_price); }
+		int64_t 				Price(size_t offset) const 			{ return config_.min_price + static_cast<int64_t>(offset); }
+		// Fibonacci hashing: ids are often sequential, which a plain mask would cluster.
+		size_t 					Home(uint64_t id) const 			{ return static_cast<size_t>((id * 0x9e3779b97f4a7c15ull) >> hash_shift_); }
+
+		BookStatus 				Add(uint64_t id, Side side, int64_t price, uint32_t quantity);
+		BookStatus 				Modify(uint64_t id, int64_t price, uint32_t quantity);
+		BookStatus 				Reduce(uint64_t id, uint32_t quantity);
+
+		// Queues a free node at the back of its level.
+		void 					Link(uint32_t node);
+		// Takes a node off its level, which may leave a new best price.
+		void 					Unlink(uint32_t node);
+
+		size_t 					Find(uint64_t id) const;
+		void 					Insert(uint64_t id, uint32_t node);
+		void 					Erase(size_t bucket);
+
+		BookConfig 				config_;
+		std::vector<Level> 		levels_[2];
+		// Offsets of the best bid (highest) and ask (lowest) levels, NONE when a side is empty.
+		size_t 					best_[2] 	{NONE, NONE};
+		size_t 					active_levels_[2] {};
+		std::vector<OrderNode> 	nodes_;
+		uint32_t 				free_nodes_{NIL};
+		std::vector<Bucket> 	buckets_;
+		size_t 					bucket_mask_;
+		unsigned 				hash_shift_;
+		size_t 					order_count_{};
+	};
+
+	//---------------------------------------------------------------------------
+	// Handler for a BatchEventProcessor over BookEvents. Applies every event, and at the end of each
+	// batch in which the best prices or quantities changed writes one TopOfBook to writer, so a busy
+	// feed is conflated rather than backing up the output ring. On shutdown the last top of book is
+	// written marked end of stream, which stops a processor downstream.
+	// _WriterT is anything with bool Write(TopOfBook, bool is_eof), e.g. a Writer<TopOfBook>.
+	template <typename _WriterT>
+	class OrderBookHandler {
+	public:
+								OrderBookHandler(const BookConfig& config, _WriterT writer)
+									: book_(config), writer_(std::move(writer)) {}
+
+		void 					OnEvent(BookEvent& event, size_t sequence, bool end_of_batch);
+		void 					OnShutdown() 							{ while (writer_.Write(last_, true)) {} }
+
+		const OrderBook& 		book() const 							{ return book_; }
+		// Events that did not apply: unknown or duplicate orders, prices out of range, a full book.
+		size_t 					rejected() const 						{ return rejected_; }
+		size_t 					published() const 						{ return published_; }
+	private:
+		OrderBook 				book_;
+		_WriterT 				writer_;
+		TopOfBook 				last_{};
+		size_t 					rejected_{};
+		size_t 					published_{};
+	};
+
+	//---------------------------------------------------------------------------
+	inline bool TopOfBook::SameQuotes(const TopOfBook& other) const
+	{
+		return bid_quantity == other.bid_quantity && ask_quantity == other.ask_quantity
+			&& (bid_quantity == 0 || bid_price == other.bid_price)
+			&& (ask_quantity == 0 || ask_price == other.ask_price);
+	}
+
+	//---------------------------------------------------------------------------
+	inline OrderBook::OrderBook(const BookConfig& config)
+		:
+		config_ 	(config),
+		nodes_ 		(config.max_orders)
+	{
+		assert(config_.min_price <= config_.max_price && config_.max_orders > 0 && config_.max_orders < NIL);
+		for (auto& levels: levels_)
+			levels.resize(Offset(config_.max_price) + 1);
+
+		for (size_t i = 0; i < nodes_.size(); ++i)
+			nodes_[i].next = i + 1 < nodes_.size() ? static_cast<uint32_t>(i + 1) : NIL;
+		free_nodes_ = 0;
+
+		// At most half full, so probe sequences stay short.
+		size_t buckets = 2;
+		hash_shift_ = 63;
+		while (buckets < 2 * config_.max_orders)
+		{
+			buckets *= 2;
+			--hash_shift_;
+		}
+		buckets_.resize(buckets);
+		bucket_mask_ = buckets - 1;
+	}
+
+	//---------------------------------------------------------------------------
+	inline BookStatus OrderBook::Apply(const BookEvent& event)
+	{
+		switch (event.type)
+		{
+			case BookEventType::ADD: 		return Add(event.order_id, event.side, event.price, event.quantity);
+			case BookEventType::MODIFY: 	return Modify(event.order_id, event.price, event.quantity);
+			case BookEventType::CANCEL: 	return Reduce(event.order_id, event.quantity);
+			case BookEventType::EXECUTE: 	return Reduce(event.order_id, event.quantity);
+		}
+		return BookStatus::OK;
+	}
+
+	//---------------------------------------------------------------------------
+	inline TopOfBook OrderBook::top() const
+	{
+		TopOfBook top;
+		if (const size_t bid = best_[Idx(Side::BUY)]; bid != NONE)
+		{
+			top.bid_price = Price(bid);
+			top.bid_quantity = levels_[Idx(Side::BUY)][bid].quantity;
+		}
+		if (const size_t ask = best_[Idx(Side::SELL)]; ask != NONE)
+		{
+			top.ask_price = Price(ask);
+			top.ask_quantity = levels_[Idx(Side::SELL)][ask].quantity;
+		}
+		return top;
+	}
+
+	//---------------------------------------------------------------------------
+	inline uint64_t OrderBook::OrderQuantity(uint64_t order_id) const
+	{
+		const size_t bucket = Find(order_id);
+		return bucket == NONE ? 0 : nodes_[buckets_[bucket].node].quantity;
+	}
+
+	//---------------------------------------------------------------------------
+	inline BookStatus OrderBook::Add(uint64_t id, Side side, int64_t price, uint32_t quantity)
+	{
+		if (!InRange(price))
+			return BookStatus::OUT_OF_RANGE;
+		if (Find(id) != NONE)
+			return BookStatus::DUPLICATE_ORDER;
+		if (free_nodes_ == NIL)
+			return BookStatus::FULL;
+
+		const uint32_t node = free_nodes_;
+		free_nodes_ = nodes_[node].next;
+		nodes_[node] = {id, price, quantity, NIL, NIL, side};
+		Link(node);
+		Insert(id, node);
+		++order_count_;
+		return BookStatus::OK;
+	}
+
+	//---------------------------------------------------------------------------
+	inline BookStatus OrderBook::Modify(uint64_t id, int64_t price, uint32_t quantity)
+	{
+		const size_t bucket = Find(id);
+		if (bucket == NONE)
+			return BookStatus::UNKNOWN_ORDER;
+		if (!InRange(price))
+			return BookStatus::OUT_OF_RANGE;
+		if (quantity == 0)
+			return Reduce(id, 0);
+
+		const uint32_t node = buckets_[bucket].node;
+		auto& order = nodes_[node];
+		if (price == order.price && quantity <= order.quantity)
+		{
+			levels_[Idx(order.side)][Offset(price)].quantity -= order.quantity - quantity;
+			order.quantity = quantity;
+			return BookStatus::OK;
+		}
+
+		// Loses priority: to the back of the (possibly new) level.
+		Unlink(node);
+		order.price = price;
+		order.quantity = quantity;
+		Link(node);
+		return BookStatus::OK;
+	}
+
+	//---------------------------------------------------------------------------
+	inline BookStatus OrderBook::Reduce(uint64_t id, uint32_t quantity)
+	{
+		const size_t bucket = Find(id);
+		if (bucket == NONE)
+			return BookStatus::UNKNOWN_ORDER;
+
+		const uint32_t node = buckets_[bucket].node;
+		auto& order = nodes_[node];
+		if (quantity != 0 && quantity < order.quantity)
+		{
+			levels_[Idx(order.side)][Offset(order.price)].quantity -= quantity;
+			order.quantity -= quantity;
+			return BookStatus::OK;
+		}
+
+		Unlink(node);
+		Erase(bucket);
+		order.next = free_nodes_;
+		free_nodes_ = node;
+		--order_count_;
+		return BookStatus::OK;
+	}
+
+	//---------------------------------------------------------------------------
+	inline void OrderBook::Link(uint32_t node)
+	{
+		auto& order = nodes_[node];
+		const size_t side = Idx(order.side);
+		const size_t offset = Offset(order.price);
+		auto& level = levels_[side][offset];
+
+		order.prev = level.tail;
+		order.next = NIL;
+		if (level.tail != NIL)
+			nodes_[level.tail].next = node;
+		else
+			level.head = node;
+		level.tail = node;
+		level.quantity += order.quantity;
+
+		if (level.orders++ == 0)
+		{
+			++active_levels_[side];
+			size_t& best = best_[side];
+			if (best == NONE || (order.side == Side::BUY ? offset > best : offset < best))
+				best = offset;
+		}
+	}
+
+	//---------------------------------------------------------------------------
+	inline void OrderBook::Unlink(uint32_t node)
+	{
+		const auto& order = nodes_[node];
+		const size_t side = Idx(order.side);
+		const size_t offset = Offset(order.price);
+		auto& level = levels_[side][offset];
+
+		(order.prev != NIL ? nodes_[order.prev].next : level.head) = order.next;
+		(order.next != NIL ? nodes_[order.next].prev : level.tail) = order.prev;
+		level.quantity -= order.quantity;
+
+		if (--level.orders != 0)
+			return;
+		size_t& best = best_[side];
+		if (--active_levels_[side] == 0)
+		{
+			best = NONE;
+			return;
+		}
+		if (best != offset)
+			return;
+		// The emptied level was the best: walk away from the spread to the next one in use.
+		const auto& levels = levels_[side];
+		if (order.side == Side::BUY)
+			do { --best; } while (levels[best].orders == 0);
+		else
+			do { ++best; } while (levels[best].orders == 0);
+	}
+
+	//---------------------------------------------------------------------------
+	inline size_t OrderBook::Find(uint64_t id) const
+	{
+		for (size_t i = Home(id);; i = (i + 1) & bucket_mask_)
+		{
+			const auto& bucket = buckets_[i];
+			if (bucket.node == NIL)
+				return NONE;
+			if (bucket.id == id)
+				return i;
+		}
+	}
+
+	//---------------------------------------------------------------------------
+	inline void OrderBook::Insert(uint64_t id, uint32_t node)
+	{
+		size_t i = Home(id);
+		while (buckets_[i].node != NIL)
+			i = (i + 1) & bucket_mask_;
+		buckets_[i] = {id, node};
+	}
+
+	//---------------------------------------------------------------------------
+	// Backward-shift deletion: later entries of the probe run move up into the hole, so lookups
+	// never need tombstones and stay as short as the load allows.
+	inline void OrderBook::Erase(size_t hole)
+	{
+		for (size_t i = (hole + 1) & bucket_mask_; buckets_[i].node != NIL; i = (i + 1) & bucket_mask_)
+		{
+			// Move the entry back unless its home lies in (hole, i], cyclically.
+			const size_t home = Home(buckets_[i].id);
+			if (((i - home) & bucket_mask_) >= ((i - hole) & bucket_mask_))
+			{
+				buckets_[hole] = buckets_[i];
+				hole = i;
+			}
+		}
+		buckets_[hole] = {};
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename _WriterT>
+	void OrderBookHandler<_WriterT>::OnEvent(BookEvent& event, size_t sequence, bool end_of_batch)
+	{
+		if (book_.Apply(event) != BookStatus::OK)
+			++rejected_;
+		if (!end_of_batch)
+			return;
+
+		auto top = book_.top();
+		if (top.SameQuotes(last_))
+			return;
+		top.sequence = sequence;
+		last_ = top;
+		while (writer_.Write(top, false)) {}
+		++published_;
+	}
+
+} // namespace disruptor
@@ -0,0 +1,291 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "allocator.hpp"
+#include "disruptor.hpp"
+
+// Preallocated payloads for large events.
+// Writing a large Elem copies all of it into the slot, and strings or vectors inside it still go to
+// the global heap for every event. Instead the ring can carry a PayloadHandle, a 4-byte index into
+// a pool of payloads built once up front. Payloads are reused rather than rebuilt, so containers
+// inside them keep their capacity and the hot path never allocates:
+//
+//		auto pool = disruptor::PayloadPool<Book>::Create(4096, 2, [] (Book& b) { b.levels.reserve(64); });
+//		auto cache = pool->CreateCache();				// one per producer thread
+//		auto handle = cache.Acquire();
+//		(*pool)[handle].levels.assign(...);
+//		writer.Write(handle, false);
+//
+// Consumers wrap their handler in a PooledHandler, which hands it the payload and then releases
+// the handle; the last of the pool's consumers to release it returns the block to the pool.
+//
+// Free blocks sit on one lock-free shared list and, in batches, in per-thread caches, so most
+// acquires and releases touch no shared state at all.
+namespace disruptor {
+
+	//---------------------------------------------------------------------------
+	struct PayloadHandle {
+		static constexpr uint32_t 	NIL 	= std::numeric_limits<uint32_t>::max();
+
+		uint32_t 		index {NIL};
+
+		// False when the pool had no free block.
+		bool 			valid() const 			{ return index != NIL; }
+	};
+
+	template <typename Payload, typename Alloc>
+	class PayloadCache;
+
+	//---------------------------------------------------------------------------
+	// capacity payloads, each released by consumers consumers before it is reused.
+	// Needs more blocks than the ring has slots, plus what producers and caches hold.
+	template <typename Payload, typename Alloc = HeapAllocator>
+	class PayloadPool: public std::enable_shared_from_this<PayloadPool<Payload, Alloc>> {
+		friend class PayloadCache<Payload, Alloc>;
+	public:
+		using 					SPtr 							= std::shared_ptr<PayloadPool>;
+		using 					InitFn 							= std::function<void(Payload&)>;
+
+		// init runs once on every payload, e.g. to reserve container capacity.
+		static SPtr 			Create(size_t capacity, size_t consumers, const InitFn& init = {}, Alloc alloc = {});
+								PayloadPool(const PayloadPool&) 				= delete;
+		PayloadPool& 			operator=(const PayloadPool&) 					= delete;
+								~PayloadPool();
+
+		// The caches of one thread; batch blocks move to and from the shared list at a time.
+		PayloadCache<Payload, Alloc> 	CreateCache(size_t batch = 32) 			{ return PayloadCache<Payload, Alloc>(this->shared_from_this(), batch); }
+
+		Payload& 				operator[](PayloadHandle handle) 				{ assert(handle.index < capacity_); return slots_[handle.index].payload; }
+		const Payload& 			operator[](PayloadHandle handle) const 			{ assert(handle.index < capacity_); return slots_[handle.index].payload; }
+		size_t 					capacity() const 								{ return capacity_; }
+		size_t 					consumers() const 								{ return consumers_; }
+		// Blocks on the shared list, not counting those in caches. Walks the list, so only exact while the pool is idle.
+		size_t 					CountShared() const;
+	private:
+		// Blocks are written by producers and released by consumers, so each gets its own cache lines.
+		struct alignas(hardware_destructive_interference_size) Slot {
+			Payload 				payload;
+			std::atomic<uint32_t> 	refs{};
+			std::atomic<uint32_t> 	next{PayloadHandle::NIL};
+		};
+
+		// The shared list's head: index in the low half, a tag bumped on every change in the high half against ABA.
+		static constexpr uint64_t 	Pack(uint32_t index, uint64_t head) 	{ return ((head >> 32) + 1) << 32 | index; }
+		static constexpr uint32_t 	IndexOf(uint64_t head) 					{ return static_cast<uint32_t>(head); }
+
+								PayloadPool(size_t capacity, size_t consumers, Alloc alloc);
+		// Pushes the blocks first..last, already linked through next.
+		void 					PushChain(uint32_t first, uint32_t last);
+		uint32_t 				Pop();
+
+		Alloc 					alloc_;
+		size_t 					capacity_;
+		size_t 					consumers_;
+		Slot* 					slots_{};
+		alignas(hardware_destructive_interference_size)
+		std::atomic<uint64_t> 	head_{PayloadHandle::NIL};
+	};
+
+	//---------------------------------------------------------------------------
+	// Free blocks owned by one thread. Producers acquire through theirs and consumers release through
+	// theirs; blocks released by one thread and acquired by another pass through the shared list.
+	// Move-only. Not thread-safe. Returns its blocks to the shared list on destruction.
+	template <typename Payload, typename Alloc = HeapAllocator>
+	class PayloadCache {
+		using 					_PoolSPtr 						= typename PayloadPool<Payload, Alloc>::SPtr;
+	public:
+								PayloadCache(_PoolSPtr pool, size_t batch);
+								PayloadCache(PayloadCache&&) noexcept 			= default;
+		PayloadCache& 			operator=(PayloadCache&&) noexcept 				= default;
+								~PayloadCache() 								{ Flush(); }
+
+		// A block referenced by all of the pool's consumers, or an invalid handle if the pool is empty.
+		PayloadHandle 			Acquire();
+		// Drops one consumer's reference; the last one frees the block.
+		void 					Release(PayloadHandle handle);
+		// Hands every cached block back to the shared list.
+		void 					Flush() 										{ if (pool_) Give(free_.size()); }
+
+		PayloadPool<Payload, Alloc>& 	pool() const 							{ return *pool_; }
+		size_t 					size() const 									{ return free_.size(); }
+	private:
+		void 					Give(size_t count);
+
+		_PoolSPtr 				pool_;
+		size_t 					batch_;
+		std::vector<uint32_t> 	free_;
+	};
+
+	//---------------------------------------------------------------------------
+	// Handler adaptor for rings of PayloadHandle: passes the payload on, then releases it.
+	// _Handler gets OnEvent(Payload&, sequence, end_of_batch).
+	template <typename _Handler, typename Payload, typename Alloc = HeapAllocator>
+	class PooledHandler {
+	public:
+								PooledHandler(_Handler handler, const typename PayloadPool<Payload, Alloc>::SPtr& pool, size_t batch = 32)
+									: handler_(std::move(handler)), cache_(pool->CreateCache(batch)) {}
+
+		void 					OnStart() 										{ if constexpr (requires { handler_.OnStart(); }) handler_.OnStart(); }
+		void 					OnShutdown()
+		{
+			if constexpr (requires { handler_.OnShutdown(); }) handler_.OnShutdown();
+			cache_.Flush();
+		}
+		void 					OnEvent(PayloadHandle& handle, size_t sequence, bool end_of_batch)
+		{
+			handler_.OnEvent(cache_.pool()[handle], sequence, end_of_batch);
+			cache_.Release(handle);
+		}
+
+		_Handler& 				handler() 										{ return handler_; }
+	private:
+		_Handler 				handler_;
+		PayloadCache<Payload, Alloc> 	cache_;
+	};
+
+	//---------------------------------------------------------------------------
+	template <typename _Handler, typename Payload, typename Alloc>
+	PooledHandler(_Handler, std::shared_ptr<PayloadPool<Payload, Alloc>>) -> PooledHandler<_Handler, Payload, Alloc>;
+
+	template <typename _Handler, typename Payload, typename Alloc>
+	PooledHandler(_Handler, std::shared_ptr<PayloadPool<Payload, Alloc>>, size_t) -> PooledHandler<_Handler, Payload, Alloc>;
+
+	//---------------------------------------------------------------------------
+	template <typename Payload, typename Alloc>
+	auto PayloadPool<Payload, Alloc>::Create(size_t capacity, size_t consumers, const InitFn& init, Alloc alloc) -> SPtr
+	{
+		SPtr pool(new PayloadPool(capacity, consumers, std::move(alloc)));
+		for (size_t i = 0; i < capacity; ++i)
+		{
+			if (init) init(pool->slots_[i].payload);
+			pool->slots_[i].next.store(i + 1 < capacity ? static_cast<uint32_t>(i + 1) : PayloadHandle::NIL, std::memory_order_relaxed);
+		}
+		pool->head_.store(capacity ? 0 : PayloadHandle::NIL, std::memory_order_release);
+		return pool;
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename Payload, typename Alloc>
+	PayloadPool<Payload, Alloc>::PayloadPool(size_t capacity, size_t consumers, Alloc alloc)
+		:
+		alloc_ 		(std::move(alloc)),
+		capacity_ 	(capacity),
+		consumers_ 	(consumers)
+	{
+		assert(capacity < PayloadHandle::NIL && consumers > 0);
+		slots_ = static_cast<Slot*>(alloc_.allocate(capacity_ * sizeof(Slot), alignof(Slot)));
+		for (size_t i = 0; i < capacity_; ++i)
+			new (slots_ + i) Slot();
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename Payload, typename Alloc>
+	PayloadPool<Payload, Alloc>::~PayloadPool()
+	{
+		for (size_t i = 0; i < capacity_; ++i)
+			slots_[i].~Slot();
+		alloc_.deallocate(slots_, capacity_ * sizeof(Slot), alignof(Slot));
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename Payload, typename Alloc>
+	void PayloadPool<Payload, Alloc>::PushChain(uint32_t first, uint32_t last)
+	{
+		uint64_t head = head_.load(std::memory_order_relaxed);
+		do {
+			slots_[last].next.store(IndexOf(head), std::memory_order_relaxed);
+		} while (!head_.compare_exchange_weak(head, Pack(first, head), std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename Payload, typename Alloc>
+	uint32_t PayloadPool<Payload, Alloc>::Pop()
+	{
+		uint64_t head = head_.load(std::memory_order_acquire);
+		while (IndexOf(head) != PayloadHandle::NIL)
+		{
+			// May read a block another thread has just popped; the tag then fails the exchange.
+			const uint32_t next = slots_[IndexOf(head)].next.load(std::memory_order_relaxed);
+			if (head_.compare_exchange_weak(head, Pack(next, head), std::memory_order_acquire, std::memory_order_acquire))
+				return IndexOf(head);
+		}
+		return PayloadHandle::NIL;
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename Payload, typename Alloc>
+	size_t PayloadPool<Payload, Alloc>::CountShared() const
+	{
+		size_t count = 0;
+		for (uint32_t i = IndexOf(head_.load(std::memory_order_acquire)); i != PayloadHandle::NIL; i = slots_[i].next.load(std::memory_order_relaxed))
+			++count;
+		return count;
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename Payload, typename Alloc>
+	PayloadCache<Payload, Alloc>::PayloadCache(_PoolSPtr pool, size_t batch)
+		:
+		pool_ 		(std::move(pool)),
+		batch_ 		(batch)
+	{
+		assert(batch_ > 0);
+		// Room for a full batch on top of the spill threshold, so the hot path never grows the vector.
+		free_.reserve(2 * batch_ + 1);
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename Payload, typename Alloc>
+	PayloadHandle PayloadCache<Payload, Alloc>::Acquire()
+	{
+		if (free_.empty())
+		{
+			for (uint32_t index; free_.size() < batch_ && (index = pool_->Pop()) != PayloadHandle::NIL;)
+				free_.push_back(index);
+			if (free_.empty())
+				return {};
+		}
+		const uint32_t index = free_.back();
+		free_.pop_back();
+		// Published to consumers along with the handle, by the ring's cursor.
+		pool_->slots_[index].refs.store(static_cast<uint32_t>(pool_->consumers_), std::memory_order_relaxed);
+		return {index};
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename Payload, typename Alloc>
+	void PayloadCache<Payload, Alloc>::Release(PayloadHandle handle)
+	{
+		assert(handle.valid());
+		// acq_rel: the last releaser must see every other consumer's reads done before reuse.
+		if (pool_->slots_[handle.index].refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+			return;
+		free_.push_back(handle.index);
+		if (free_.size() > 2 * batch_)
+			Give(batch_);
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename Payload, typename Alloc>
+	void PayloadCache<Payload, Alloc>::Give(size_t count)
+	{
+		if (count == 0)
+			return;
+		// Link the newest count blocks together and push them with one exchange.
+		const size_t first = free_.size() - count;
+		for (size_t i = first; i + 1 < free_.size(); ++i)
+			pool_->slots_[free_[i]].next.store(free_[i + 1], std::memory_order_relaxed);
+		pool_->PushChain(free_[first], free_.back());
+		free_.resize(first);
+	}
+
+} // namespace disruptor
@@ -2,83 +2,101 @@
 
 #include <vector>
 #include <chrono>
+#include <cmath>
+#include <iostream>
 #include <mutex>
 
-namespace profiler{
+#include "histogram.hpp"
+#include "tsc_clock.hpp"
 
-    std::mutex lock;
+namespace profiler{
 
-    // For now, this class can only be used in a single thread.
-    class ScopedProfiler{
+    // Records the lifetime of each instance in nanoseconds.
+    // Samples go into a per-thread histogram, so profiling from many threads never contends.
+    // Clock is any std::chrono clock; TscClock keeps the cost of the measurement itself to a few ns.
+    template <typename Clock = std::chrono::high_resolution_clock>
+    class BasicScopedProfiler{
       public:
 
-        static std::vector<double> data;
-
-        ScopedProfiler() { start_time_ = std::chrono::high_resolution_clock::now(); }
+        BasicScopedProfiler() { start_time_ = Clock::now(); }
 
-        ~ScopedProfiler() {
-            auto duration = (std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::high_resolution_clock::now()-start_time_)).count();
-            {
-                std::scoped_lock<std::mutex>lk (lock); data.push_back(duration);
-            }
+        ~BasicScopedProfiler() {
+            auto duration = (std::chrono::duration_cast<std::chrono::nanoseconds> (Clock::now()-start_time_)).count();
+            histograms().Local().Record(static_cast<uint64_t>(duration));
         }
+
+        // Samples of all threads merged.
+        static profiler::Stats      GetStats()  { return histograms().Merged().GetStats(); }
+        static void                 Reset()     { histograms().Reset(); }
    
     private:
-        using TimePoint     = std::chrono::time_point<std::chrono::high_resolution_clock>;
+        static HistogramRegistry&   histograms() { static HistogramRegistry registry; return registry; }
+
+        using TimePoint     = typename Clock::time_point;
         TimePoint           start_time_;
      };
 
-    //---------------------------------------------------------------------------
-     std::vector<double> ScopedProfiler::data{};
+    using ScopedProfiler    = BasicScopedProfiler<>;
+    using TscScopedProfiler = BasicScopedProfiler<TscClock>;
 
     //---------------------------------------------------------------------------
-        struct Stats{
-        double mean;
-        double max;
-        double min;
-        double stdev;
-    };
-    //---------------------------------------------------------------------------
-    std::ostream& operator<<(std::ostream& os, const Stats& s) {
-        os << "Mean: " <<s.mean<<", Min: "<<s.min << ", Max: "<< s.max<<", Stddev: "<<s.stdev<<'\n';
+    inline std::ostream& operator<<(std::ostream& os, const Stats& s) {
+        os << "Mean: " <<s.mean<<", Min: "<<s.min << ", Max: "<< s.max<<", Stddev: "<<s.stdev
+           << ", p50: "<<s.p50<<", p99: "<<s.p99<<", p99.9: "<<s.p999<<", p99.99: "<<s.p9999<<'\n';
         return os;
     }
     //---------------------------------------------------------------------------
     template<typename T>
     Stats GetStats(const std::vector<T>& arr) {
-        Stats stats{0, arr[0],arr[0], 0};
+        Stats stats{0, static_cast<double>(arr[0]), static_cast<double>(arr[0]), 0};
 
         for(const T& elem: arr) {
-            if (elem < stats.min) {stats.min = elem;}
-            if (elem > stats.max) {stats.max = elem;}
-            stats.mean += elem;
+            const auto value = static_cast<double>(elem);
+            if (value < stats.min) {stats.min = value;}
+            if (value > stats.max) {stats.max = value;}
+            stats.mean += value;
         }
         stats.mean/=static_cast<double>(arr.size());
         
         for(const T& elem: arr) {
-            stats.stdev+=std::pow(stats.mean-elem,2);
+            stats.stdev+=std::pow(stats.mean-static_cast<double>(elem),2);
         }
         stats.stdev /= static_cast<double>(arr.size());
         stats.stdev = std::sqrt(stats.stdev);      
+
+        std::vector<T> sorted(arr);
+        std::sort(sorted.begin(), sorted.end());
+        auto percentile = [&](double p) { return sorted[std::min(sorted.size() - 1, static_cast<size_t>(std::ceil(p / 100. * static_cast<double>(sorted.size()))) - 1)]; };
+        stats.p50   = static_cast<double>(percentile(50));
+        stats.p99   = static_cast<double>(percentile(99));
+        stats.p999  = static_cast<double>(percentile(99.9));
+        stats.p9999 = static_cast<double>(percentile(99.99));
+        stats.count = arr.size();
         return stats;
     }
     //---------------------------------------------------------------------------
-    class Timer {
-        using TimePoint = std::chrono::time_point<std::chrono::high_resolution_clock>;
+    // Times Start/Stop intervals. Single-threaded; samples go into a fixed-size histogram.
+    template <typename Clock = std::chrono::high_resolution_clock>
+    class BasicTimer {
+        using TimePoint = typename Clock::time_point;
       public:
-        Timer()         = default;
-        void    Start()     { start_time_ = std::chrono::high_resolution_clock::now(); }
-        void    Display()   { std::cout << GetStats(data_);  }
-        Stats   Stats()     { return GetStats(data_);}
+        BasicTimer()    = default;
+        void    Start()     { start_time_ = Clock::now(); }
+        void    Display()   { std::cout << histogram_.GetStats();  }
+        profiler::Stats Stats() { return histogram_.GetStats();}
         void    Stop()      {
                             auto duration = (std::chrono::duration_cast<std::chrono::nanoseconds> 
-                                (std::chrono::high_resolution_clock::now()-start_time_)).count();
-                            data_.push_back(duration);
+                                (Clock::now()-start_time_)).count();
+                            histogram_.Record(static_cast<uint64_t>(duration));
                             }       
+        const LatencyHistogram& histogram() const { return histogram_; }
       private:
-        std::vector<double>     data_{};
+        LatencyHistogram        histogram_{};
         TimePoint               start_time_;
 
     };
 
+    using Timer     = BasicTimer<>;
+    using TscTimer  = BasicTimer<TscClock>;
+
 } //namespace profiler
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "disruptor.hpp"
+#include "event_processor.hpp"
+#include "thread_runner.hpp"
+
+// Disruptor partitioned by key.
+// One ring is one serialization point: a single consumer caps throughput and competing consumers
+// lose per-key ordering. A ShardedDisruptor owns K independent rings, each drained by its own
+// consumer, and routes every event by the hash of its key. Events with the same key always land
+// on the same shard, so they are handled in publication order, while throughput scales with shards.
+//
+//		disruptor::ShardedDisruptor<Order, Symbol> orders(8, 4096);
+//		orders.Write(order.symbol, order);
+//		disruptor::ShardedProcessors processors(orders, [] (size_t shard) { return BookHandler{shard}; });
+//		processors.Start();
+namespace disruptor {
+
+	//---------------------------------------------------------------------------
+	// Load on one shard, for spotting hot keys and deciding on rebalancing.
+	struct ShardStats {
+		size_t 		shard;
+		// Events written to the shard so far.
+		size_t 		published;
+		// Events its consumer has released.
+		size_t 		consumed;
+		size_t 		backlog;
+	};
+
+	//---------------------------------------------------------------------------
+	template <typename Elem, typename Key, PublishPolicy _WP = PublishPolicy::BUFFERED, PublishPolicy _RP = PublishPolicy::BUFFERED,
+			typename _WS = BusySpinWait, Layout _SL = Layout::PADDED, typename _Hash = std::hash<Key>>
+	class ShardedDisruptor {
+		using 					_DisruptorT 							= SingleDisruptor<Elem, _WP, _RP, _WS, _SL>;
+	public:
+		using 					writer_type 							= Writer<Elem, _WP, _RP, _WS, _SL>;
+		using 					reader_type 							= Reader<Elem, _WP, _RP, _WS, _SL>;
+
+		// num_shards rings of capacity each; capacity must satisfy IsValidCapacity.
+								ShardedDisruptor(size_t num_shards, size_t capacity = DEFAULT_CAPACITY, _Hash hash = {});
+
+		// Shard every event with this key goes to. Stable for the lifetime of the disruptor.
+		size_t 					ShardOf(const Key& key) const;
+
+		// Thread-safe: any number of producers may write to any keys.
+		template <typename T = Elem>
+		bool 					Write(const Key& key, T&& data, bool is_eof = false) 		{ return writers_[ShardOf(key)].Write(std::forward<T>(data), is_eof); }
+		// Zero-copy batch for one key's shard.
+		WriteClaim<Elem, _WP, _WS, _SL> 	Claim(const Key& key, size_t num) 					{ return writers_[ShardOf(key)].Claim(num); }
+
+		// The single consumer of a shard. Only one thread may read a shard at a time.
+		reader_type& 			reader(size_t shard) 										{ return readers_[shard]; }
+		writer_type& 			writer(size_t shard) 										{ return writers_[shard]; }
+		size_t 					size() const 												{ return shards_.size(); }
+
+		std::vector<ShardStats> Stats() const;
+		// Most published shard over the mean; 1 is a perfectly even spread.
+		double 					Skew() const;
+	private:
+		_Hash 						hash_;
+		std::vector<_DisruptorT> 	shards_;
+		std::vector<writer_type> 	writers_;
+		std::vector<reader_type> 	readers_;
+	};
+
+	//---------------------------------------------------------------------------
+	// One BatchEventProcessor per shard, each on its own thread.
+	template <typename _ShardedT, typename _Handler>
+	class ShardedProcessors {
+		using 					_ReaderT 									= typename _ShardedT::reader_type;
+		using 					_ProcessorT 								= decltype(BatchEventProcessor(std::declval<_ReaderT>(), std::declval<_Handler>()));
+	public:
+		// make_handler(shard) builds the handler for each shard.
+		template <typename _MakeHandler>
+								ShardedProcessors(_ShardedT& sharded, _MakeHandler&& make_handler);
+
+		// Starts every processor. placement[i], if given, places shard i's thread.
+		// Returns true if any placement could not be applied.
+		bool 					Start(const std::vector<ThreadConfig>& placement = {});
+		void 					Halt() 									{ for (auto& processor: processors_) processor->Halt(); }
+		void 					Join() 									{ for (auto& processor: processors_) processor->Join(); }
+
+		_Handler& 				handler(size_t shard) 					{ return processors_[shard]->handler(); }
+		size_t 					size() const 							{ return processors_.size(); }
+	private:
+		// Processors own atomics and a thread, so they stay put.
+		std::vector<std::unique_ptr<_ProcessorT>> 	processors_;
+	};
+
+	template <typename _ShardedT, typename _MakeHandler>
+	ShardedProcessors(_ShardedT&, _MakeHandler&&) -> ShardedProcessors<_ShardedT, std::invoke_result_t<_MakeHandler, size_t>>;
+
+	//---------------------------------------------------------------------------
+	template <typename Elem, typename Key, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL, typename _Hash>
+	ShardedDisruptor<Elem, Key, _WP, _RP, _WS, _SL, _Hash>::ShardedDisruptor(size_t num_shards, size_t capacity, _Hash hash)
+		: hash_(std::move(hash))
+	{
+		assert(num_shards > 0);
+		shards_.reserve(num_shards);
+		writers_.reserve(num_shards);
+		readers_.reserve(num_shards);
+		for (size_t i = 0; i < num_shards; ++i)
+		{
+			shards_.push_back(MakeSingleDisruptor<Elem, _WP, _RP, _WS, _SL>(ConsumerMode::COMPETING, capacity));
+			writers_.push_back(shards_.back().CreateWriter());
+			readers_.push_back(shards_.back().CreateReader());
+		}
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename Elem, typename Key, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL, typename _Hash>
+	size_t ShardedDisruptor<Elem, Key, _WP, _RP, _WS, _SL, _Hash>::ShardOf(const Key& key) const
+	{
+		// std::hash of an integer is the identity: mix the bits so sequential keys still spread,
+		// then map onto the shards with a multiply rather than a divide.
+		uint64_t h = static_cast<uint64_t>(hash_(key));
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		// A GCC/Clang extension; __extension__ keeps -Wpedantic quiet about it.
+		__extension__ using uint128 = unsigned __int128;
+		return static_cast<size_t>((static_cast<uint128>(h) * shards_.size()) >> 64);
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename Elem, typename Key, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL, typename _Hash>
+	std::vector<ShardStats> ShardedDisruptor<Elem, Key, _WP, _RP, _WS, _SL, _Hash>::Stats() const
+	{
+		std::vector<ShardStats> stats;
+		stats.reserve(shards_.size());
+		for (size_t i = 0; i < shards_.size(); ++i)
+		{
+			// Consumed first: it never passes published, so the backlog can't go negative.
+			const size_t consumed = readers_[i].GetCursor();
+			const size_t published = writers_[i].GetCursor();
+			stats.push_back({i, published, consumed, published - consumed});
+		}
+		return stats;
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename Elem, typename Key, PublishPolicy _WP, PublishPolicy _RP, typename _WS, Layout _SL, typename _Hash>
+	double ShardedDisruptor<Elem, Key, _WP, _RP, _WS, _SL, _Hash>::Skew() const
+	{
+		size_t total = 0, most = 0;
+		for (const auto& writer: writers_)
+		{
+			total += writer.GetCursor();
+			most = std::max(most, writer.GetCursor());
+		}
+		return total ? static_cast<double>(most) * static_cast<double>(writers_.size()) / static_cast<double>(total) : 1.;
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename _ShardedT, typename _Handler>
+	template <typename _MakeHandler>
+	ShardedProcessors<_ShardedT, _Handler>::ShardedProcessors(_ShardedT& sharded, _MakeHandler&& make_handler)
+	{
+		processors_.reserve(sharded.size());
+		for (size_t i = 0; i < sharded.size(); ++i)
+			processors_.push_back(std::make_unique<_ProcessorT>(sharded.reader(i), make_handler(i)));
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename _ShardedT, typename _Handler>
+	bool ShardedProcessors<_ShardedT, _Handler>::Start(const std::vector<ThreadConfig>& placement)
+	{
+		bool err = false;
+		for (size_t i = 0; i < processors_.size(); ++i)
+			err |= processors_[i]->Start(i < placement.size() ? placement[i] : ThreadConfig{});
+		return err;
+	}
+
+} // namespace disruptor
@@ -0,0 +1,502 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "disruptor.hpp"
+
+// Disruptor over a named POSIX shared memory mapping (/dev/shm/<name>), so writers and readers
+// can run in separate processes without a socket hop. POSIX only.
+//
+// The mapping holds everything the processes share:
+//		[header: magic, layout version, slot size and alignment, capacity]
+//		[claim sequence][write cursor][wait signal]		each on its own cache lines
+//		[writer peers][reader peers]					one cache line each
+//		[slots]
+// Writers claim with a CAS and publish in order, as PublishPolicy::BLOCK does. Each reader owns a
+// peer entry with its own cursor and sees every event, as ConsumerMode::BROADCAST does. Writers are
+// gated on the slowest registered reader.
+//
+// Every peer records its pid. A peer whose process has died is stale: a stale reader would gate
+// writers forever, so writers reap stale peers while they wait on a full ring. A writer that dies
+// between Reserve and Publish leaves the ring stalled at its claim: its slot may be half written, so
+// nobody can publish past it, and every reader and later writer waits from then on. This is a limit
+// of the design, not something reaping recovers from. Readers can detect it with IsStalled(), which
+// holds once no registered writer is alive, and the ring must then be recreated.
+namespace disruptor {
+
+	namespace shm {
+		constexpr uint64_t 	MAGIC 			= 0x4c4d4158'53484d31; // "LMAXSHM1"
+		constexpr uint32_t 	LAYOUT_VERSION 	= 1;
+		constexpr size_t 	MAX_PEERS 		= 16;
+
+		//---------------------------------------------------------------------------
+		struct alignas(hardware_destructive_interference_size) Header {
+			uint64_t 				magic;
+			uint32_t 				version;
+			uint32_t 				slot_size;
+			uint32_t 				slot_align;
+			uint64_t 				capacity;
+			// Set last by the creator; the mapping must not be used before.
+			std::atomic<uint32_t> 	ready;
+		};
+
+		//---------------------------------------------------------------------------
+		// A registered writer or reader. pid 0: free, -1: being registered.
+		struct alignas(hardware_destructive_interference_size) Peer {
+			std::atomic<pid_t> 		pid;
+			// Readers: everything before this sequence has been released.
+			std::atomic<size_t> 	cursor;
+		};
+
+		//---------------------------------------------------------------------------
+		struct Control {
+			Header 					header;
+			alignas(hardware_destructive_interference_size)
+			std::atomic<size_t> 	claim_sequence;
+			alignas(hardware_destructive_interference_size)
+			std::atomic<size_t> 	write_cursor;
+			alignas(hardware_destructive_interference_size)
+			WaitSignal 				signal;
+			Peer 					writers[MAX_PEERS];
+			Peer 					readers[MAX_PEERS];
+		};
+
+		static_assert(std::atomic<size_t>::is_always_lock_free && std::atomic<pid_t>::is_always_lock_free,
+			"Atomics shared between processes must be lock-free.");
+
+		//---------------------------------------------------------------------------
+		// EPERM: the process exists but belongs to another user.
+		inline bool IsAlive(pid_t pid) 	{ return pid > 0 && (::kill(pid, 0) == 0 || errno == EPERM); }
+	} // namespace shm
+
+	template <typename Elem, typename _WS>
+	class ShmWriter;
+
+	template <typename Elem, typename _WS>
+	class ShmReader;
+
+	//---------------------------------------------------------------------------
+	// A ring in a named shared memory mapping. One process creates it, others open it by name.
+	// Events must be trivially copyable since they are read by other processes.
+	// OS failures and header mismatches throw std::system_error, as the allocators do.
+	template <typename Elem, typename _WS = BusySpinWait>
+	class ShmRing: public std::enable_shared_from_this<ShmRing<Elem, _WS>> {
+		static_assert(std::is_trivially_copyable_v<Elem>, "Shared memory events must be trivially copyable.");
+		// std::atomic::wait parks on a process-private futex, so blocked readers in other processes would never wake.
+		static_assert(!std::is_same_v<_WS, BlockingWait>, "BlockingWait does not work across processes.");
+	public:
+		using 					SPtr 									= std::shared_ptr<ShmRing>;
+		using 					slot_type 								= Sequence<Elem, Layout::PACKED>;
+
+		// Creates the mapping, replacing any left over from a previous run. The creator unlinks the name on destruction.
+		static SPtr 			Create(const std::string& name, size_t capacity = DEFAULT_CAPACITY);
+		// Attaches to a mapping created by another process. Its header must match this Elem.
+		static SPtr 			Open(const std::string& name);
+
+								ShmRing(const ShmRing&) 				= delete;
+		ShmRing& 				operator=(const ShmRing&) 				= delete;
+								~ShmRing();
+
+		ShmWriter<Elem, _WS> 	CreateWriter() 							{ return ShmWriter<Elem, _WS>(this->shared_from_this()); }
+		// Readers start at the current write cursor.
+		ShmReader<Elem, _WS> 	CreateReader() 							{ return ShmReader<Elem, _WS>(this->shared_from_this()); }
+
+		slot_type& 				at(size_t pos) 							{ return slots_[pos & mask_]; }
+		size_t 					size() const 							{ return mask_ + 1; }
+		size_t 					GetWriteCursor() const 					{ return control_->write_cursor.load(std::memory_order_acquire); }
+
+		// Position of the slowest reader, or nothing if there are no readers. Readers still registering gate too.
+		std::optional<size_t> 	GetGatingCursor() const;
+		size_t 					NumReaders() const;
+		// Unregisters peers whose processes have died. Returns how many were removed.
+		size_t 					ReapStalePeers();
+		// Claimed sequences are waiting on a writer that no longer exists.
+		bool 					IsStalled() const;
+
+	private:
+		friend class ShmWriter<Elem, _WS>;
+		friend class ShmReader<Elem, _WS>;
+
+		static constexpr size_t SlotsOffset() 							{ return (sizeof(shm::Control) + alignof(slot_type) - 1) & ~(alignof(slot_type) - 1); }
+		static size_t 			MappedBytes(size_t capacity) 			{ return SlotsOffset() + capacity * sizeof(slot_type); }
+
+								ShmRing(std::string name, void* mapping, size_t bytes, bool is_owner);
+
+		// Claims a free peer entry for this process, its cursor starting at the write cursor.
+		// Returns nullptr when all are taken.
+		shm::Peer* 				Register(shm::Peer (&peers)[shm::MAX_PEERS]);
+		static void 			Unregister(shm::Peer* peer) 			{ if (peer) peer->pid.store(0, std::memory_order_release); }
+
+		std::string 			name_;
+		void* 					mapping_;
+		size_t 					bytes_;
+		bool 					is_owner_;
+		shm::Control* 			control_;
+		slot_type* 				slots_;
+		size_t 					mask_;
+	};
+
+	//---------------------------------------------------------------------------
+	// Registers on construction and unregisters on destruction. Move-only.
+	// The same Reserve/Publish protocol as WriteCursor; Write is the one-slot shorthand.
+	template <typename Elem, typename _WS = BusySpinWait>
+	class ShmWriter {
+		using 					_RingSPtr 								= typename ShmRing<Elem, _WS>::SPtr;
+		// Waits on a full ring between attempts to reap stale readers.
+		static constexpr size_t REAP_INTERVAL 							= 1024;
+	public:
+		explicit 				ShmWriter(_RingSPtr ring);
+								ShmWriter(ShmWriter&& other) noexcept
+									: ring_(std::move(other.ring_)), peer_(std::exchange(other.peer_, nullptr)), cached_gate_(other.cached_gate_) {}
+								~ShmWriter() 							{ ShmRing<Elem, _WS>::Unregister(peer_); }
+
+		// Blocks until at least one slot is free. Errs if there are no readers or no free peer entry.
+		ReservationInfo 		Reserve(size_t no_of_slots = 1);
+		typename ShmRing<Elem, _WS>::slot_type& 	at(size_t pos) 		{ return ring_->at(pos); }
+		// Waits for earlier claims to be published first. If the writer holding an earlier claim
+		// dies before publishing it, this waits forever and readers see nothing more: IsStalled()
+		// reports it, and the ring has to be recreated.
+		void 					Publish(size_t pos_begin, size_t pos_end);
+
+		// Returns true on error, as Writer::Write does.
+		template <typename T = Elem>
+		bool 					Write(T&& data, bool is_eof = false);
+	private:
+		_RingSPtr 				ring_;
+		shm::Peer* 				peer_;
+		// Last seen position of the slowest reader, refreshed only when it cannot satisfy a reservation.
+		size_t 					cached_gate_{};
+	};
+
+	//---------------------------------------------------------------------------
+	// Registers on construction and unregisters on destruction. Move-only.
+	// Each reader sees every event; Publish releases the read slots back to the writers.
+	template <typename Elem, typename _WS = BusySpinWait>
+	class ShmReader {
+		using 					_RingSPtr 								= typename ShmRing<Elem, _WS>::SPtr;
+	public:
+		explicit 				ShmReader(_RingSPtr ring);
+								ShmReader(ShmReader&& other) noexcept
+									: ring_(std::move(other.ring_)), peer_(std::exchange(other.peer_, nullptr)),
+									claim_(other.claim_), cached_write_cursor_(other.cached_write_cursor_) {}
+								~ShmReader() 							{ ShmRing<Elem, _WS>::Unregister(peer_); }
+
+		// Non-blocking. Errs when there is nothing to read or no free peer entry, and keeps
+		// erring once the ring is stalled by a dead writer; see ShmRing::IsStalled().
+		ReservationInfo 		Reserve(size_t no_of_slots = 1);
+		const typename ShmRing<Elem, _WS>::slot_type& 	at(size_t pos) 	{ return ring_->at(pos); }
+		void 					Publish(size_t pos_begin, size_t pos_end);
+
+		size_t 					GetCursor() const 						{ return peer_ ? peer_->cursor.load(std::memory_order_acquire) : 0; }
+		bool 					is_registered() const 					{ return peer_ != nullptr; }
+	private:
+		_RingSPtr 				ring_;
+		shm::Peer* 				peer_;
+		size_t 					claim_{};
+		size_t 					cached_write_cursor_{};
+	};
+
+	//---------------------------------------------------------------------------
+	template <typename Elem, typename _WS>
+	ShmRing<Elem, _WS>::ShmRing(std::string name, void* mapping, size_t bytes, bool is_owner)
+		:
+		name_ 		(std::move(name)),
+		mapping_ 	(mapping),
+		bytes_ 		(bytes),
+		is_owner_ 	(is_owner),
+		control_ 	(static_cast<shm::Control*>(mapping)),
+		slots_ 		(reinterpret_cast<slot_type*>(static_cast<std::byte*>(mapping) + SlotsOffset())),
+		mask_ 		(control_->header.capacity - 1)
+	{}
+
+	//---------------------------------------------------------------------------
+	template <typename Elem, typename _WS>
+	ShmRing<Elem, _WS>::~ShmRing()
+	{
+		::munmap(mapping_, bytes_);
+		if (is_owner_)
+			::shm_unlink(name_.c_str());
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename Elem, typename _WS>
+	auto ShmRing<Elem, _WS>::Create(const std::string& name, size_t capacity) -> SPtr
+	{
+		assert(IsValidCapacity(capacity));
+		const size_t bytes = MappedBytes(capacity);
+
+		::shm_unlink(name.c_str());
+		const int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+		if (fd < 0)
+			throw std::system_error(errno, std::generic_category(), "shm_open");
+		if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0)
+		{
+			const int err = errno;
+			::close(fd);
+			::shm_unlink(name.c_str());
+			throw std::system_error(err, std::generic_category(), "ftruncate");
+		}
+		void* mapping = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		const int err = errno;
+		::close(fd);
+		if (mapping == MAP_FAILED)
+		{
+			::shm_unlink(name.c_str());
+			throw std::system_error(err, std::generic_category(), "mmap");
+		}
+
+		auto* control = new (mapping) shm::Control{};
+		control->header.magic 		= shm::MAGIC;
+		control->header.version 	= shm::LAYOUT_VERSION;
+		control->header.slot_size 	= sizeof(slot_type);
+		control->header.slot_align 	= alignof(slot_type);
+		control->header.capacity 	= capacity;
+		std::uninitialized_value_construct_n(reinterpret_cast<slot_type*>(static_cast<std::byte*>(mapping) + SlotsOffset()), capacity);
+		control->header.ready.store(1, std::memory_order_release);
+
+		return SPtr(new ShmRing(name, mapping, bytes, true));
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename Elem, typename _WS>
+	auto ShmRing<Elem, _WS>::Open(const std::string& name) -> SPtr
+	{
+		const int fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+		if (fd < 0)
+			throw std::system_error(errno, std::generic_category(), "shm_open");
+
+		struct stat st{};
+		if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(shm::Control))
+		{
+			::close(fd);
+			throw std::system_error(std::make_error_code(std::errc::resource_unavailable_try_again), "shm header not initialised");
+		}
+		const size_t bytes = static_cast<size_t>(st.st_size);
+		void* mapping = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		const int err = errno;
+		::close(fd);
+		if (mapping == MAP_FAILED)
+			throw std::system_error(err, std::generic_category(), "mmap");
+
+		const auto& header = static_cast<shm::Control*>(mapping)->header;
+		auto fail = [&](std::errc code, const char* what) {
+			::munmap(mapping, bytes);
+			throw std::system_error(std::make_error_code(code), what);
+		};
+		if (header.ready.load(std::memory_order_acquire) == 0)
+			fail(std::errc::resource_unavailable_try_again, "shm header not initialised");
+		if (header.magic != shm::MAGIC || header.version != shm::LAYOUT_VERSION)
+			fail(std::errc::protocol_not_supported, "shm layout version mismatch");
+		if (header.slot_size != sizeof(slot_type) || header.slot_align != alignof(slot_type))
+			fail(std::errc::invalid_argument, "shm slot type mismatch");
+		if (!IsValidCapacity(header.capacity) || bytes < MappedBytes(header.capacity))
+			fail(std::errc::invalid_argument, "shm capacity mismatch");
+
+		return SPtr(new ShmRing(name, mapping, bytes, false));
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename Elem, typename _WS>
+	shm::Peer* ShmRing<Elem, _WS>::Register(shm::Peer (&peers)[shm::MAX_PEERS])
+	{
+		for (auto& peer: peers)
+		{
+			pid_t expected = 0;
+			// Reserve the entry before reading the start: writers gate on it from here on, with the
+			// cursor a previous owner left, which is never ahead of the start. Had the start been
+			// read first, writers could lap it before the entry was visible.
+			if (peer.pid.compare_exchange_strong(expected, -1, std::memory_order_seq_cst))
+			{
+				peer.cursor.store(GetWriteCursor(), std::memory_order_release);
+				peer.pid.store(::getpid(), std::memory_order_release);
+				return &peer;
+			}
+		}
+		return nullptr;
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename Elem, typename _WS>
+	std::optional<size_t> ShmRing<Elem, _WS>::GetGatingCursor() const
+	{
+		std::optional<size_t> gate;
+		for (const auto& peer: control_->readers)
+		{
+			if (peer.pid.load(std::memory_order_acquire) == 0)
+				continue;
+			const size_t cursor = peer.cursor.load(std::memory_order_acquire);
+			gate = gate ? std::min(*gate, cursor) : cursor;
+		}
+		return gate;
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename Elem, typename _WS>
+	size_t ShmRing<Elem, _WS>::NumReaders() const
+	{
+		return static_cast<size_t>(std::count_if(std::begin(control_->readers), std::end(control_->readers),
+			[](const shm::Peer& peer) { return peer.pid.load(std::memory_order_acquire) > 0; }));
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename Elem, typename _WS>
+	size_t ShmRing<Elem, _WS>::ReapStalePeers()
+	{
+		size_t reaped = 0;
+		for (auto* peers: {control_->writers, control_->readers})
+		{
+			for (size_t i = 0; i < shm::MAX_PEERS; ++i)
+			{
+				pid_t pid = peers[i].pid.load(std::memory_order_acquire);
+				// Only the first of several reaping processes frees the entry.
+				if (pid > 0 && !shm::IsAlive(pid) && peers[i].pid.compare_exchange_strong(pid, 0, std::memory_order_acq_rel))
+					++reaped;
+			}
+		}
+		return reaped;
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename Elem, typename _WS>
+	bool ShmRing<Elem, _WS>::IsStalled() const
+	{
+		if (control_->write_cursor.load(std::memory_order_acquire) == control_->claim_sequence.load(std::memory_order_acquire))
+			return false;
+		return std::none_of(std::begin(control_->writers), std::end(control_->writers),
+			[](const shm::Peer& peer) { return shm::IsAlive(peer.pid.load(std::memory_order_acquire)); });
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename Elem, typename _WS>
+	ShmWriter<Elem, _WS>::ShmWriter(_RingSPtr ring)
+		:
+		ring_ 	(std::move(ring)),
+		peer_ 	(ring_->Register(ring_->control_->writers))
+	{}
+
+	//---------------------------------------------------------------------------
+	template <typename Elem, typename _WS>
+	ReservationInfo ShmWriter<Elem, _WS>::Reserve(size_t no_of_slots)
+	{
+		if (!peer_) [[unlikely]]
+			return {0, 0, true};
+
+		auto& claim_sequence = ring_->control_->claim_sequence;
+		const size_t capacity = ring_->size();
+		_WS waiter;
+		size_t waits = 0;
+
+		size_t expected = claim_sequence.load(std::memory_order_acquire);
+		while (true)
+		{
+			// As WriteCursor::Reserve: only look at the readers when the cached gate cannot satisfy the request.
+			size_t used = expected - cached_gate_;
+			if (used >= capacity || capacity - used < no_of_slots)
+			{
+				auto gate = ring_->GetGatingCursor();
+				// Nothing to gate on, so nothing may be written.
+				if (!gate)
+					return {0, 0, true};
+				cached_gate_ = *gate;
+				used = expected - cached_gate_;
+				if (used >= capacity)
+				{
+					// A dead reader would hold the ring full forever.
+					if (++waits % REAP_INTERVAL == 0)
+						ring_->ReapStalePeers();
+					waiter.Wait(ring_->control_->signal);
+					expected = claim_sequence.load(std::memory_order_acquire);
+					continue;
+				}
+			}
+
+			const size_t new_sequence = expected + std::min(capacity - used, no_of_slots);
+			if (claim_sequence.compare_exchange_weak(expected, new_sequence, std::memory_order_acq_rel))
+				return {expected, new_sequence, false};
+		}
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename Elem, typename _WS>
+	void ShmWriter<Elem, _WS>::Publish(size_t pos_begin, size_t pos_end)
+	{
+		using _Publisher = detail::CursorUpdateHelper<PublishPolicy::BLOCK>;
+		_WS waiter;
+		while (_Publisher::UpdateCursor(ring_->control_->write_cursor, pos_begin, pos_end) == detail::PublishUpdateStatus::PENDING)
+			waiter.Wait(ring_->control_->signal);
+		_WS::Notify(ring_->control_->signal);
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename Elem, typename _WS>
+	template <typename T>
+	bool ShmWriter<Elem, _WS>::Write(T&& data, bool is_eof)
+	{
+		ReservationInfo reservation = Reserve(1);
+		if (reservation.err) [[unlikely]]
+			return true;
+
+		auto& slot = at(reservation.pos_begin);
+		slot.data() = std::forward<T>(data);
+		slot.set_eof(is_eof);
+		Publish(reservation.pos_begin, reservation.pos_end);
+		return false;
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename Elem, typename _WS>
+	ShmReader<Elem, _WS>::ShmReader(_RingSPtr ring)
+		:
+		ring_ 	(std::move(ring)),
+		peer_ 	(ring_->Register(ring_->control_->readers)),
+		claim_ 	(peer_ ? peer_->cursor.load(std::memory_order_relaxed) : 0),
+		cached_write_cursor_ (claim_)
+	{}
+
+	//---------------------------------------------------------------------------
+	template <typename Elem, typename _WS>
+	ReservationInfo ShmReader<Elem, _WS>::Reserve(size_t no_of_slots)
+	{
+		if (!peer_) [[unlikely]]
+			return {0, 0, true};
+
+		// Only look at the writers when the cached cursor says the ring is empty.
+		if (cached_write_cursor_ <= claim_)
+		{
+			cached_write_cursor_ = ring_->GetWriteCursor();
+			if (cached_write_cursor_ <= claim_)
+				return {0, 0, true};
+		}
+
+		const size_t pos_begin = claim_;
+		claim_ += std::min(cached_write_cursor_ - claim_, no_of_slots);
+		return {pos_begin, claim_, false};
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename Elem, typename _WS>
+	void ShmReader<Elem, _WS>::Publish(size_t pos_begin, size_t pos_end)
+	{
+		// Reservations of a single reader are released in order.
+		assert(peer_);
+		detail::CursorUpdateHelper<PublishPolicy::SINGLE>::UpdateCursor(peer_->cursor, pos_begin, pos_end);
+		_WS::Notify(ring_->control_->signal);
+	}
+
+} // namespace disruptor
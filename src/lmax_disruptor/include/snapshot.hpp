@@ -0,0 +1,404 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "journal.hpp"
+
+// Snapshots of consumer state for warm restarts.
+// A consumer's state is a trivially copyable struct. Taking a snapshot copies it into a staging
+// buffer and returns; a background thread writes it to <name>-<sequence>.snapshot, fsyncs and
+// renames it into place, so a crash never leaves a half-written latest snapshot. The file is the
+// struct behind a small header, so loading maps it and uses it in place without parsing:
+//
+//		disruptor::SnapshotStore<BookState> store({"/data/snapshots", "book"});
+//		auto snapshot = store.LoadLatest();
+//		const size_t start = snapshot ? snapshot->sequence() : 0;
+//		disruptor.StartAt(start);
+//		journal_reader.Seek(start);		// then Replay() the events the snapshot does not cover
+//
+// A snapshot's sequence is the first sequence its state does not reflect, i.e. where to resume.
+namespace disruptor {
+
+	namespace snapshot {
+		constexpr uint64_t 	MAGIC 			= 0x4c4d4158'534e5031; // "LMAXSNP1"
+		constexpr uint32_t 	FORMAT_VERSION 	= 1;
+
+		//---------------------------------------------------------------------------
+		struct alignas(64) Header {
+			uint64_t 		magic;
+			uint32_t 		version;
+			uint32_t 		state_offset;
+			uint64_t 		state_size;
+			uint64_t 		sequence;
+			int64_t 		timestamp_ns;
+			// CRC-32C of the state bytes.
+			uint32_t 		checksum;
+		};
+
+		template <typename State>
+		constexpr size_t 	StateOffset() 				{ return std::max(sizeof(Header), alignof(State)); }
+
+		inline std::filesystem::path Path(const std::filesystem::path& directory, const std::string& name, uint64_t sequence)
+		{
+			char suffix[40];
+			std::snprintf(suffix, sizeof(suffix), "-%020llu.snapshot", static_cast<unsigned long long>(sequence));
+			return directory / (name + suffix);
+		}
+
+		// Sequences of the snapshots in the directory, newest first.
+		inline std::vector<uint64_t> List(const std::filesystem::path& directory, const std::string& name)
+		{
+			std::vector<uint64_t> sequences;
+			std::error_code ec;
+			for (const auto& entry: std::filesystem::directory_iterator(directory, ec))
+			{
+				const std::string file = entry.path().filename().string();
+				unsigned long long sequence;
+				if (file.rfind(name + "-", 0) == 0 &&
+					std::sscanf(file.c_str() + name.size(), "-%llu", &sequence) == 1 &&
+					Path(directory, name, sequence).filename() == file)
+					sequences.push_back(sequence);
+			}
+			std::sort(sequences.rbegin(), sequences.rend());
+			return sequences;
+		}
+	} // namespace snapshot
+
+	//---------------------------------------------------------------------------
+	// A loaded snapshot: the state lives in a private copy-on-write mapping of the file, so it can
+	// be used and modified in place. Move-only.
+	template <typename State>
+	class Snapshot {
+	public:
+								Snapshot(void* mapping, size_t bytes) 	: mapping_(mapping), bytes_(bytes) {}
+								Snapshot(Snapshot&& other) noexcept 	: mapping_(std::exchange(other.mapping_, nullptr)), bytes_(other.bytes_) {}
+		Snapshot& 				operator=(Snapshot&& other) noexcept 	{ std::swap(mapping_, other.mapping_); std::swap(bytes_, other.bytes_); return *this; }
+								~Snapshot() 							{ if (mapping_) ::munmap(mapping_, bytes_); }
+
+		State& 					state() 								{ return *reinterpret_cast<State*>(static_cast<std::byte*>(mapping_) + snapshot::StateOffset<State>()); }
+		// First sequence the state does not reflect.
+		uint64_t 				sequence() const 						{ return header().sequence; }
+		int64_t 				timestamp_ns() const 					{ return header().timestamp_ns; }
+	private:
+		const snapshot::Header& header() const 							{ return *static_cast<const snapshot::Header*>(mapping_); }
+
+		void* 					mapping_;
+		size_t 					bytes_;
+	};
+
+	//---------------------------------------------------------------------------
+	struct SnapshotOptions {
+		std::filesystem::path 	directory;
+		std::string 			name 		= "snapshot";
+		// Snapshots kept on disk; older ones are removed once a new one is written.
+		size_t 					keep 		= 2;
+	};
+
+	//---------------------------------------------------------------------------
+	// Writes snapshots of State on a background thread and loads the latest one back.
+	// Take() is meant for the single consumer thread that owns the state.
+	template <typename State>
+	class SnapshotStore {
+		static_assert(std::is_trivially_copyable_v<State>, "Snapshot state must be trivially copyable.");
+		static_assert(alignof(State) <= 4096, "Snapshot state is mapped at a page boundary.");
+	public:
+		explicit 				SnapshotStore(SnapshotOptions options);
+								SnapshotStore(const SnapshotStore&) 	= delete;
+		SnapshotStore& 			operator=(const SnapshotStore&) 		= delete;
+								~SnapshotStore();
+
+		// Copies the state, tagged with the first sequence it does not reflect, and returns without
+		// waiting for the disk. Returns true, taking nothing, while the previous snapshot is still being written.
+		bool 					Take(const State& state, uint64_t sequence);
+		// Waits until every snapshot taken so far is on disk.
+		void 					Flush();
+		// The newest intact snapshot, skipping any that fail their checks.
+		std::optional<Snapshot<State>> 	LoadLatest() const;
+
+		// Snapshots written so far.
+		size_t 					written() const 						{ return written_.load(std::memory_order_acquire); }
+		// errno of the last failed write, or 0.
+		int 					last_error() const 						{ return last_error_.load(std::memory_order_acquire); }
+	private:
+		void 					Run();
+		// Returns errno on failure.
+		int 					Write(uint64_t sequence, int64_t timestamp_ns);
+		void 					Prune();
+		std::optional<Snapshot<State>> 	Load(uint64_t sequence) const;
+
+		SnapshotOptions 		options_;
+		// Staging copy of the state being written; only touched by Take() while not busy.
+		std::unique_ptr<std::byte[]> 	staged_;
+		uint64_t 				staged_sequence_{};
+		int64_t 				staged_timestamp_ns_{};
+		std::atomic<bool> 		busy_{};
+		std::atomic<size_t> 	written_{};
+		std::atomic<int> 		last_error_{};
+		bool 					stop_{};
+		std::mutex 				mutex_;
+		std::condition_variable ready_;
+		std::condition_variable done_;
+		std::thread 			thread_;
+	};
+
+	//---------------------------------------------------------------------------
+	// Wraps a BatchEventProcessor handler that exposes its state as
+	//		const State& state() const;
+	// and snapshots that state at the end of a batch once every interval events, and on shutdown.
+	template <typename _Handler>
+	class SnapshotHandler {
+		using 					_StateT 								= std::decay_t<decltype(std::declval<const _Handler&>().state())>;
+	public:
+								SnapshotHandler(_Handler handler, SnapshotOptions options, size_t interval)
+									:
+									handler_ 		(std::move(handler)),
+									store_ 			(std::make_unique<SnapshotStore<_StateT>>(std::move(options))),
+									interval_ 		(interval)
+									{}
+
+		void 					OnStart() 								{ if constexpr (requires { handler_.OnStart(); }) handler_.OnStart(); }
+		void 					OnShutdown();
+		template <typename Elem>
+		void 					OnEvent(Elem& event, size_t sequence, bool end_of_batch);
+
+		_Handler& 				handler() 								{ return handler_; }
+		SnapshotStore<_StateT>& store() 								{ return *store_; }
+	private:
+		_Handler 				handler_;
+		// The processor moves its handler; the store's thread stays put.
+		std::unique_ptr<SnapshotStore<_StateT>> 	store_;
+		size_t 					interval_;
+		size_t 					since_snapshot_{};
+		std::optional<size_t> 	next_sequence_;
+	};
+
+	//---------------------------------------------------------------------------
+	template <typename State>
+	SnapshotStore<State>::SnapshotStore(SnapshotOptions options)
+		:
+		options_ 	(std::move(options)),
+		staged_ 	(std::make_unique<std::byte[]>(sizeof(State)))
+	{
+		assert(options_.keep > 0);
+		std::filesystem::create_directories(options_.directory);
+		thread_ = std::thread([this] { Run(); });
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename State>
+	SnapshotStore<State>::~SnapshotStore()
+	{
+		Flush();
+		{
+			std::lock_guard lock(mutex_);
+			stop_ = true;
+		}
+		ready_.notify_one();
+		thread_.join();
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename State>
+	bool SnapshotStore<State>::Take(const State& state, uint64_t sequence)
+	{
+		if (busy_.load(std::memory_order_acquire))
+			return true;
+		std::memcpy(staged_.get(), &state, sizeof(State));
+		staged_sequence_ = sequence;
+		staged_timestamp_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		{
+			std::lock_guard lock(mutex_);
+			busy_.store(true, std::memory_order_release);
+		}
+		ready_.notify_one();
+		return false;
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename State>
+	void SnapshotStore<State>::Flush()
+	{
+		std::unique_lock lock(mutex_);
+		done_.wait(lock, [this] { return !busy_.load(std::memory_order_acquire); });
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename State>
+	void SnapshotStore<State>::Run()
+	{
+		std::unique_lock lock(mutex_);
+		for (;;)
+		{
+			ready_.wait(lock, [this] { return stop_ || busy_.load(std::memory_order_acquire); });
+			if (!busy_.load(std::memory_order_acquire))
+				return;
+
+			lock.unlock();
+			const int err = Write(staged_sequence_, staged_timestamp_ns_);
+			if (err == 0)
+			{
+				written_.fetch_add(1, std::memory_order_release);
+				Prune();
+			}
+			last_error_.store(err, std::memory_order_release);
+			lock.lock();
+
+			busy_.store(false, std::memory_order_release);
+			done_.notify_all();
+		}
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename State>
+	int SnapshotStore<State>::Write(uint64_t sequence, int64_t timestamp_ns)
+	{
+		constexpr size_t offset = snapshot::StateOffset<State>();
+		auto buffer = std::make_unique<std::byte[]>(offset + sizeof(State));
+		snapshot::Header header{snapshot::MAGIC, snapshot::FORMAT_VERSION, static_cast<uint32_t>(offset), sizeof(State), sequence, timestamp_ns,
+								journal::Crc32c(staged_.get(), sizeof(State))};
+		std::memcpy(buffer.get(), &header, sizeof(header));
+		std::memcpy(buffer.get() + offset, staged_.get(), sizeof(State));
+
+		// Written aside and renamed, so the snapshot under its final name is always complete.
+		const auto path = snapshot::Path(options_.directory, options_.name, sequence);
+		const auto temporary = options_.directory / (options_.name + ".tmp");
+		const int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0)
+			return errno;
+		size_t done = 0;
+		while (done < offset + sizeof(State))
+		{
+			const ssize_t n = ::write(fd, buffer.get() + done, offset + sizeof(State) - done);
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n <= 0)
+			{
+				const int err = n < 0 ? errno : EIO;
+				::close(fd);
+				return err;
+			}
+			done += static_cast<size_t>(n);
+		}
+		if (::fdatasync(fd) != 0)
+		{
+			const int err = errno;
+			::close(fd);
+			return err;
+		}
+		::close(fd);
+		if (::rename(temporary.c_str(), path.c_str()) != 0)
+			return errno;
+
+		// Make the rename itself durable.
+		const int dir = ::open(options_.directory.c_str(), O_RDONLY | O_DIRECTORY);
+		if (dir >= 0)
+		{
+			::fsync(dir);
+			::close(dir);
+		}
+		return 0;
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename State>
+	void SnapshotStore<State>::Prune()
+	{
+		const auto sequences = snapshot::List(options_.directory, options_.name);
+		for (size_t i = options_.keep; i < sequences.size(); ++i)
+		{
+			std::error_code ec;
+			std::filesystem::remove(snapshot::Path(options_.directory, options_.name, sequences[i]), ec);
+		}
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename State>
+	std::optional<Snapshot<State>> SnapshotStore<State>::LoadLatest() const
+	{
+		for (uint64_t sequence: snapshot::List(options_.directory, options_.name))
+		{
+			if (auto loaded = Load(sequence))
+				return loaded;
+		}
+		return std::nullopt;
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename State>
+	std::optional<Snapshot<State>> SnapshotStore<State>::Load(uint64_t sequence) const
+	{
+		constexpr size_t bytes = snapshot::StateOffset<State>() + sizeof(State);
+		const auto path = snapshot::Path(options_.directory, options_.name, sequence);
+		const int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return std::nullopt;
+		struct stat st{};
+		if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) != bytes)
+		{
+			::close(fd);
+			return std::nullopt;
+		}
+		void* mapping = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (mapping == MAP_FAILED)
+			return std::nullopt;
+
+		Snapshot<State> loaded(mapping, bytes);
+		const auto& header = *static_cast<const snapshot::Header*>(mapping);
+		if (header.magic != snapshot::MAGIC || header.version != snapshot::FORMAT_VERSION ||
+			header.state_offset != snapshot::StateOffset<State>() || header.state_size != sizeof(State) ||
+			header.sequence != sequence || header.checksum != journal::Crc32c(&loaded.state(), sizeof(State)))
+			return std::nullopt;
+		return loaded;
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename _Handler>
+	template <typename Elem>
+	void SnapshotHandler<_Handler>::OnEvent(Elem& event, size_t sequence, bool end_of_batch)
+	{
+		handler_.OnEvent(event, sequence, end_of_batch);
+		next_sequence_ = sequence + 1;
+		if (++since_snapshot_ >= interval_ && end_of_batch && !store_->Take(handler_.state(), *next_sequence_))
+			since_snapshot_ = 0;
+	}
+
+	//---------------------------------------------------------------------------
+	template <typename _Handler>
+	void SnapshotHandler<_Handler>::OnShutdown()
+	{
+		if constexpr (requires { handler_.OnShutdown(); })
+			handler_.OnShutdown();
+		if (next_sequence_)
+		{
+			// The last snapshot may still be in flight; this one covers everything handled.
+			store_->Flush();
+			store_->Take(handler_.state(), *next_sequence_);
+			store_->Flush();
+		}
+	}
+
+} // namespace disruptor
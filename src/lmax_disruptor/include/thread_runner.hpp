@@ -0,0 +1,370 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Placement of disruptor participants on CPUs.
+// Threads that float between cores pay for migrations and cold caches in the middle of a run,
+// and two busy-spinning threads on hyperthreads of one core halve each other's throughput.
+// ThreadRunner pins every producer and consumer to its configured CPUs, optionally with
+// SCHED_FIFO priority, names it, warns about placements that share a physical core and
+// reports the whole placement so a run can be reproduced.
+//
+//		disruptor::ThreadRunner runner;
+//		runner.Start({"writer", {2}}, [&] { ... });
+//		runner.Start({"reader", {4}, 10}, [&] { ... });
+//		std::cout << runner.Report();
+namespace disruptor {
+
+	//---------------------------------------------------------------------------
+	// Parses the kernel's CPU list format, e.g. "0-3,8,10-11". Malformed entries are skipped.
+	inline std::vector<int> ParseCpuList(std::string_view list)
+	{
+		std::vector<int> cpus;
+		while (!list.empty())
+		{
+			const size_t comma = list.find(',');
+			std::string_view item = list.substr(0, comma);
+			list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
+
+			while (!item.empty() && std::isspace(static_cast<unsigned char>(item.back())))
+				item.remove_suffix(1);
+			int first = 0, last = 0;
+			const auto [ptr, ec] = std::from_chars(item.data(), item.data() + item.size(), first);
+			if (ec != std::errc{})
+				continue;
+			last = first;
+			if (ptr != item.data() + item.size() && (*ptr != '-' || std::from_chars(ptr + 1, item.data() + item.size(), last).ec != std::errc{}))
+				continue;
+			for (int cpu = first; cpu <= last; ++cpu)
+				cpus.push_back(cpu);
+		}
+		return cpus;
+	}
+
+	//---------------------------------------------------------------------------
+	// The inverse of ParseCpuList: "0-3,8".
+	inline std::string FormatCpuList(std::vector<int> cpus)
+	{
+		std::sort(cpus.begin(), cpus.end());
+		cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+		std::string list;
+		for (size_t i = 0; i < cpus.size();)
+		{
+			size_t j = i;
+			while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+				++j;
+			if (!list.empty())
+				list += ',';
+			list += std::to_string(cpus[i]);
+			if (j > i)
+				list += '-' + std::to_string(cpus[j]);
+			i = j + 1;
+		}
+		return list;
+	}
+
+	//---------------------------------------------------------------------------
+	struct CpuInfo {
+		int 				cpu 		{-1};
+		int 				core_id 	{-1};
+		int 				package_id 	{-1};
+		int 				numa_node 	{-1};
+		// Logical CPUs on the same physical core, this one included.
+		std::vector<int> 	siblings;
+		// Listed in isolcpus, i.e. kept free of ordinary tasks by the scheduler.
+		bool 				isolated 	{};
+	};
+
+	//---------------------------------------------------------------------------
+	// The machine's CPUs as sysfs describes them. Unknown fields stay at -1, e.g. in containers
+	// that hide parts of sysfs.
+	class CpuTopology {
+	public:
+		// root is normally /sys/devices/system/cpu; tests point it at a fake tree.
+		static CpuTopology 		Detect(const std::filesystem::path& root = "/sys/devices/system/cpu");
+
+		const std::vector<CpuInfo>& 	cpus() const 					{ return cpus_; }
+		const CpuInfo* 			Find(int cpu) const;
+		// Different logical CPUs on the same physical core.
+		bool 					AreSiblings(int a, int b) const;
+		// One line per CPU: core, package, NUMA node, siblings and isolation.
+		std::string 			Describe() const;
+	private:
+		std::vector<CpuInfo> 	cpus_;
+	};
+
+	//---------------------------------------------------------------------------
+	struct ThreadConfig {
+		// Thread name as shown by top and perf; the kernel keeps 15 characters.
+		std::string 		name;
+		// CPUs the thread may run on. Empty: left to the scheduler.
+		std::vector<int> 	cpus;
+		// SCHED_FIFO priority, 1-99. 0: keep the default policy. Needs CAP_SYS_NICE.
+		int 				fifo_priority 	{};
+	};
+
+	//---------------------------------------------------------------------------
+	// Applies config to the calling thread. Returns what could not be applied, empty on success;
+	// settings that fail are skipped, the rest still apply.
+	inline std::vector<std::string> 	ConfigureThisThread(const ThreadConfig& config);
+
+	//---------------------------------------------------------------------------
+	// What a thread asked for, and what went wrong applying it.
+	struct ThreadPlacement {
+		ThreadConfig 				config;
+		std::vector<std::string> 	errors;
+	};
+
+	//---------------------------------------------------------------------------
+	// Starts and owns configured threads. Start and the accessors are not thread-safe;
+	// use one runner from the thread that sets up the pipeline.
+	class ThreadRunner {
+	public:
+		explicit 				ThreadRunner(CpuTopology topology = CpuTopology::Detect()) 	: topology_(std::move(topology)) {}
+								ThreadRunner(const ThreadRunner&) 				= delete;
+		ThreadRunner& 			operator=(const ThreadRunner&) 					= delete;
+								~ThreadRunner() 								{ Join(); }
+
+		// Runs fn on a new thread once the config has been applied. Returns true if any of it
+		// could not be; the thread runs regardless and the errors are in placements().
+		template <typename Fn>
+		bool 					Start(ThreadConfig config, Fn&& fn);
+		void 					Join();
+
+		const CpuTopology& 		topology() const 								{ return topology_; }
+		const std::deque<ThreadPlacement>& 	placements() const 					{ return placements_; }
+		// Placements that share a CPU or a physical core, and CPUs the topology does not know.
+		const std::vector<std::string>& 	warnings() const 					{ return warnings_; }
+		// Topology, every thread's placement, errors and warnings.
+		std::string 			Report() const;
+	private:
+		void 					CheckPlacement(const ThreadConfig& config);
+
+		CpuTopology 				topology_;
+		std::deque<ThreadPlacement> placements_;
+		std::vector<std::string> 	warnings_;
+		std::vector<std::thread> 	threads_;
+	};
+
+	namespace detail {
+		//---------------------------------------------------------------------------
+		inline int ReadSysfsInt(const std::filesystem::path& path)
+		{
+			std::ifstream file(path);
+			int value = -1;
+			return file >> value ? value : -1;
+		}
+
+		inline std::string ReadSysfsLine(const std::filesystem::path& path)
+		{
+			std::ifstream file(path);
+			std::string line;
+			std::getline(file, line);
+			return line;
+		}
+	} // namespace detail
+
+	//---------------------------------------------------------------------------
+	inline CpuTopology CpuTopology::Detect(const std::filesystem::path& root)
+	{
+		namespace fs = std::filesystem;
+		CpuTopology topology;
+		std::error_code ec;
+		if (!fs::is_directory(root, ec))
+			return topology;
+
+		const std::vector<int> isolated = ParseCpuList(detail::ReadSysfsLine(root / "isolated"));
+		std::vector<int> online = ParseCpuList(detail::ReadSysfsLine(root / "online"));
+		if (online.empty())
+		{
+			// No online list: every cpuN directory counts.
+			for (const auto& entry: fs::directory_iterator(root, ec))
+			{
+				const std::string name = entry.path().filename().string();
+				int cpu;
+				if (name.starts_with("cpu") && std::from_chars(name.data() + 3, name.data() + name.size(), cpu).ptr == name.data() + name.size())
+					online.push_back(cpu);
+			}
+			std::sort(online.begin(), online.end());
+		}
+
+		for (int cpu: online)
+		{
+			const fs::path dir = root / ("cpu" + std::to_string(cpu));
+			CpuInfo info;
+			info.cpu 		= cpu;
+			info.core_id 	= detail::ReadSysfsInt(dir / "topology" / "core_id");
+			info.package_id = detail::ReadSysfsInt(dir / "topology" / "physical_package_id");
+			info.siblings 	= ParseCpuList(detail::ReadSysfsLine(dir / "topology" / "thread_siblings_list"));
+			if (info.siblings.empty())
+				info.siblings.push_back(cpu);
+			info.isolated 	= std::find(isolated.begin(), isolated.end(), cpu) != isolated.end();
+			// The CPU's NUMA node shows up as a nodeN link in its directory.
+			for (const auto& entry: fs::directory_iterator(dir, ec))
+			{
+				const std::string name = entry.path().filename().string();
+				int node;
+				if (name.starts_with("node") && std::from_chars(name.data() + 4, name.data() + name.size(), node).ptr == name.data() + name.size())
+					info.numa_node = node;
+			}
+			topology.cpus_.push_back(std::move(info));
+		}
+		return topology;
+	}
+
+	//---------------------------------------------------------------------------
+	inline const CpuInfo* CpuTopology::Find(int cpu) const
+	{
+		const auto iter = std::find_if(cpus_.begin(), cpus_.end(), [cpu] (const CpuInfo& info) { return info.cpu == cpu; });
+		return iter == cpus_.end() ? nullptr : &*iter;
+	}
+
+	//---------------------------------------------------------------------------
+	inline bool CpuTopology::AreSiblings(int a, int b) const
+	{
+		const CpuInfo* info = Find(a);
+		return a != b && info && std::find(info->siblings.begin(), info->siblings.end(), b) != info->siblings.end();
+	}
+
+	//---------------------------------------------------------------------------
+	inline std::string CpuTopology::Describe() const
+	{
+		std::ostringstream out;
+		for (const auto& info: cpus_)
+		{
+			out << "cpu " << info.cpu
+				<< ": core " << info.core_id
+				<< ", package " << info.package_id
+				<< ", node " << info.numa_node
+				<< ", siblings " << FormatCpuList(info.siblings)
+				<< (info.isolated ? ", isolated" : "") << '\n';
+		}
+		return out.str();
+	}
+
+#if defined(__linux__)
+	//---------------------------------------------------------------------------
+	inline std::vector<std::string> ConfigureThisThread(const ThreadConfig& config)
+	{
+		std::vector<std::string> errors;
+		if (!config.name.empty())
+		{
+			// Longer names fail with ERANGE rather than being truncated.
+			const std::string name = config.name.substr(0, 15);
+			if (const int err = pthread_setname_np(pthread_self(), name.c_str()); err != 0)
+				errors.push_back("name " + name + ": " + std::strerror(err));
+		}
+		if (!config.cpus.empty())
+		{
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			for (int cpu: config.cpus)
+				if (cpu >= 0 && cpu < CPU_SETSIZE)
+					CPU_SET(static_cast<size_t>(cpu), &set);
+			if (const int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set); err != 0)
+				errors.push_back("affinity " + FormatCpuList(config.cpus) + ": " + std::strerror(err));
+		}
+		if (config.fifo_priority > 0)
+		{
+			sched_param param{};
+			param.sched_priority = config.fifo_priority;
+			if (const int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param); err != 0)
+				errors.push_back("SCHED_FIFO " + std::to_string(config.fifo_priority) + ": " + std::strerror(err));
+		}
+		return errors;
+	}
+#else
+	//---------------------------------------------------------------------------
+	inline std::vector<std::string> ConfigureThisThread(const ThreadConfig& config)
+	{
+		if (config.cpus.empty() && config.fifo_priority == 0)
+			return {};
+		return {"thread placement is only supported on Linux"};
+	}
+#endif
+
+	//---------------------------------------------------------------------------
+	template <typename Fn>
+	bool ThreadRunner::Start(ThreadConfig config, Fn&& fn)
+	{
+		CheckPlacement(config);
+		auto& placement = placements_.emplace_back(ThreadPlacement{std::move(config), {}});
+
+		// Wait for the settings to be applied so placements() is complete once Start returns.
+		std::promise<std::vector<std::string>> applied;
+		auto errors = applied.get_future();
+		threads_.emplace_back([applied = std::move(applied), &config = placement.config, fn = std::forward<Fn>(fn)] () mutable {
+			applied.set_value(ConfigureThisThread(config));
+			fn();
+		});
+		placement.errors = errors.get();
+		return !placement.errors.empty();
+	}
+
+	//---------------------------------------------------------------------------
+	inline void ThreadRunner::Join()
+	{
+		for (auto& thread: threads_)
+			if (thread.joinable())
+				thread.join();
+	}
+
+	//---------------------------------------------------------------------------
+	inline void ThreadRunner::CheckPlacement(const ThreadConfig& config)
+	{
+		for (int cpu: config.cpus)
+		{
+			if (!topology_.cpus().empty() && !topology_.Find(cpu))
+				warnings_.push_back(config.name + ": cpu " + std::to_string(cpu) + " is not online");
+			for (const auto& other: placements_)
+			{
+				for (int other_cpu: other.config.cpus)
+				{
+					if (cpu == other_cpu)
+						warnings_.push_back(config.name + " and " + other.config.name + " share cpu " + std::to_string(cpu));
+					else if (topology_.AreSiblings(cpu, other_cpu))
+						warnings_.push_back(config.name + " (cpu " + std::to_string(cpu) + ") and " + other.config.name
+							+ " (cpu " + std::to_string(other_cpu) + ") are hyperthreads of the same core");
+				}
+			}
+		}
+	}
+
+	//---------------------------------------------------------------------------
+	inline std::string ThreadRunner::Report() const
+	{
+		std::ostringstream out;
+		out << "topology:\n" << topology_.Describe() << "threads:\n";
+		for (const auto& placement: placements_)
+		{
+			const auto& config = placement.config;
+			out << config.name << ": cpus " << (config.cpus.empty() ? "any" : FormatCpuList(config.cpus));
+			if (config.fifo_priority > 0)
+				out << ", SCHED_FIFO " << config.fifo_priority;
+			for (const auto& error: placement.errors)
+				out << ", failed " << error;
+			out << '\n';
+		}
+		for (const auto& warning: warnings_)
+			out << "warning: " << warning << '\n';
+		return out.str();
+	}
+
+} // namespace disruptor
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+namespace profiler{
+
+    //---------------------------------------------------------------------------
+    // Clock reading the CPU's time stamp counter: a handful of ns per call instead of the tens of ns
+    // a vDSO clock_gettime costs. Meets the std::chrono clock requirements, so it can be used
+    // wherever a chrono clock is, e.g. BasicTimer<TscClock> or event timestamps.
+    //
+    // The counter is only used when the CPU reports an invariant TSC (constant rate across
+    // frequency and sleep states); otherwise, and on other architectures, it falls back to
+    // steady_clock at runtime. Ticks are converted to ns with a rate calibrated against steady_clock
+    // on first use (about 10 ms), and time points share steady_clock's epoch.
+    class TscClock{
+      public:
+        using rep           = int64_t;
+        using period        = std::nano;
+        using duration      = std::chrono::nanoseconds;
+        using time_point    = std::chrono::time_point<TscClock>;
+        static constexpr bool is_steady = true;
+
+        static time_point   now() noexcept          { return time_point(duration(ToNanos(Ticks()))); }
+
+        // Raw counter. The fence keeps earlier loads from being reordered past the read.
+        static uint64_t     Ticks() noexcept;
+        // Counter read after all earlier instructions have completed; for the end of a measured interval.
+        static uint64_t     TicksEnd() noexcept;
+
+        static int64_t      ToNanos(uint64_t ticks) noexcept;
+        // Whether the TSC is in use rather than the steady_clock fallback.
+        static bool         is_tsc() noexcept       { return calibration().is_tsc; }
+        static double       ns_per_tick() noexcept  { return calibration().ns_per_tick; }
+
+      private:
+        struct Calibration{
+            bool        is_tsc;
+            double      ns_per_tick;
+            uint64_t    tick0;
+            int64_t     ns0;
+        };
+
+        static bool                 HasInvariantTsc() noexcept;
+        static Calibration          Calibrate() noexcept;
+        static const Calibration&   calibration() noexcept  { static const Calibration c = Calibrate(); return c; }
+        static int64_t              SteadyNanos() noexcept  { return std::chrono::duration_cast<duration>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+    };
+
+    //---------------------------------------------------------------------------
+    inline bool TscClock::HasInvariantTsc() noexcept
+    {
+    #if defined(__x86_64__) || defined(__i386__)
+        unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+        // CPUID.80000007H:EDX[8] is the invariant TSC flag.
+        return __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) && (edx & (1u << 8));
+    #else
+        return false;
+    #endif
+    }
+
+    //---------------------------------------------------------------------------
+    inline TscClock::Calibration TscClock::Calibrate() noexcept
+    {
+        if (!HasInvariantTsc())
+            return {false, 1., 0, 0};
+
+    #if defined(__x86_64__) || defined(__i386__)
+        constexpr int64_t CALIBRATION_NS = 10'000'000;
+        _mm_lfence();
+        const uint64_t tick0 = __rdtsc();
+        const int64_t ns0 = SteadyNanos();
+        int64_t ns1 = ns0;
+        while (ns1 - ns0 < CALIBRATION_NS)
+            ns1 = SteadyNanos();
+        _mm_lfence();
+        const uint64_t tick1 = __rdtsc();
+        return {true, static_cast<double>(ns1 - ns0) / static_cast<double>(tick1 - tick0), tick0, ns0};
+    #else
+        return {false, 1., 0, 0};
+    #endif
+    }
+
+    //---------------------------------------------------------------------------
+    inline uint64_t TscClock::Ticks() noexcept
+    {
+    #if defined(__x86_64__) || defined(__i386__)
+        if (calibration().is_tsc) [[likely]]
+        {
+            _mm_lfence();
+            return __rdtsc();
+        }
+    #endif
+        return static_cast<uint64_t>(SteadyNanos());
+    }
+
+    //---------------------------------------------------------------------------
+    inline uint64_t TscClock::TicksEnd() noexcept
+    {
+    #if defined(__x86_64__) || defined(__i386__)
+        if (calibration().is_tsc) [[likely]]
+        {
+            unsigned int aux;
+            const uint64_t ticks = __rdtscp(&aux);
+            // Keep later instructions from starting before the read.
+            _mm_lfence();
+            return ticks;
+        }
+    #endif
+        return static_cast<uint64_t>(SteadyNanos());
+    }
+
+    //---------------------------------------------------------------------------
+    inline int64_t TscClock::ToNanos(uint64_t ticks) noexcept
+    {
+        const Calibration& c = calibration();
+        if (!c.is_tsc)
+            return static_cast<int64_t>(ticks);
+        return c.ns0 + static_cast<int64_t>(static_cast<double>(static_cast<int64_t>(ticks - c.tick0)) * c.ns_per_tick);
+    }
+
+} // namespace profiler
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Wait strategies decide what a thread does while it cannot make progress,
+// e.g. a writer waiting for readers to free space or a publisher waiting for its predecessor.
+// They trade latency against CPU usage and are selected per ring as a template policy.
+//
+// Every strategy is used the same way. The waiter keeps one strategy object per wait and calls
+// Wait(signal) each time its condition is not met. Whoever changes the condition calls
+// Notify(signal) afterwards. Only the blocking strategy needs the signal; the others ignore it.
+namespace disruptor {
+
+	// Bumped by publishers that use a blocking strategy; blocked waiters sleep on it.
+	using WaitSignal = std::atomic<uint32_t>;
+
+	namespace detail {
+		//---------------------------------------------------------------------------
+		// Tells the core we are spinning: frees pipeline resources for the sibling hyperthread
+		// and avoids the memory-order mis-speculation penalty when the spin exits.
+		inline void CpuRelax()
+		{
+		#if defined(__x86_64__) || defined(__i386__)
+			_mm_pause();
+		#elif defined(__aarch64__)
+			asm volatile("yield" ::: "memory");
+		#endif
+		}
+	} // namespace detail
+
+	//---------------------------------------------------------------------------
+	// Lowest latency. Burns a whole core but pauses between polls.
+	class BusySpinWait {
+	public:
+		void 			Wait(const WaitSignal&) 				{ detail::CpuRelax(); }
+		static void 	Notify(WaitSignal&) 					{}
+	};
+
+	//---------------------------------------------------------------------------
+	// Spins for a while, then gives the core away on each further poll.
+	class SpinThenYieldWait {
+		static constexpr uint32_t 	SPIN_LIM = 100;
+	public:
+		void 			Wait(const WaitSignal&)
+		{
+			if (spins_ < SPIN_LIM) 	{ ++spins_; detail::CpuRelax(); }
+			else 					{ std::this_thread::yield(); }
+		}
+		static void 	Notify(WaitSignal&) 					{}
+	private:
+		uint32_t 		spins_{};
+	};
+
+	//---------------------------------------------------------------------------
+	// Doubles the number of pauses between polls up to a cap.
+	// Backs contending publishers off each other without leaving the core.
+	class BackoffWait {
+		static constexpr uint32_t 	PAUSE_LIM = 1024;
+	public:
+		void 			Wait(const WaitSignal&)
+		{
+			for (uint32_t i = 0; i < pauses_; ++i)
+				detail::CpuRelax();
+			pauses_ = std::min(pauses_ * 2, PAUSE_LIM);
+		}
+		static void 	Notify(WaitSignal&) 					{}
+	private:
+		uint32_t 		pauses_{1};
+	};
+
+	//---------------------------------------------------------------------------
+	// Spins, then yields, then sleeps. Good for background rings where latency is secondary.
+	class SleepingWait {
+		static constexpr uint32_t 	SPIN_LIM 	= 100;
+		static constexpr uint32_t 	YIELD_LIM 	= 200;
+		static constexpr auto 		SLEEP 		= std::chrono::microseconds(50);
+	public:
+		void 			Wait(const WaitSignal&)
+		{
+			if (retries_ < SPIN_LIM) 		{ ++retries_; detail::CpuRelax(); }
+			else if (retries_ < YIELD_LIM) 	{ ++retries_; std::this_thread::yield(); }
+			else 							{ std::this_thread::sleep_for(SLEEP); }
+		}
+		static void 	Notify(WaitSignal&) 					{}
+	private:
+		uint32_t 		retries_{};
+	};
+
+	//---------------------------------------------------------------------------
+	// Spins briefly, then parks the thread on the signal (futex on Linux) until notified.
+	// Lowest CPU usage; publishers pay an atomic increment and a wake-up check per publish.
+	class BlockingWait {
+		static constexpr uint32_t 	SPIN_LIM = 100;
+	public:
+		void 			Wait(const WaitSignal& signal)
+		{
+			// The signal value is recorded before the caller rechecks its condition,
+			// so a notify between the check and the wait is never lost.
+			if (spins_ < SPIN_LIM) 	{ ++spins_; detail::CpuRelax(); }
+			else if (armed_) 		{ signal.wait(epoch_, std::memory_order_acquire); }
+			epoch_ = signal.load(std::memory_order_acquire);
+			armed_ = true;
+		}
+		static void 	Notify(WaitSignal& signal)
+		{
+			signal.fetch_add(1, std::memory_order_release);
+			signal.notify_all();
+		}
+	private:
+		uint32_t 		spins_{};
+		uint32_t 		epoch_{};
+		bool 			armed_{};
+	};
+
+} // namespace disruptor
@@ -1,16 +1,37 @@
 #define CATCH_CONFIG_MAIN
 #include "disruptor.hpp"
+#include "event_processor.hpp"
+#include "shm_disruptor.hpp"
 
 #include <array>
+#include <barrier>
 #include <catch2/catch.hpp>
 
+#include <filesystem>
+#include <fstream>
 #include <future>
 #include <iostream>
 #include <numeric>
 #include <limits>
+#include <map>
+#include <random>
+#include <tuple>
+#include <unordered_map>
+
+#include <sys/wait.h>
 
 #include "barrier.hpp"
+#include "byte_ring.hpp"
+#include "histogram.hpp"
+#include "journal.hpp"
+#include "logger.hpp"
+#include "order_book.hpp"
+#include "payload_pool.hpp"
+#include "thread_runner.hpp"
 #include "scoped_profiler.hpp"
+#include "sharded_disruptor.hpp"
+#include "snapshot.hpp"
+#include "tsc_clock.hpp"
 
 #include "test_helpers.hpp"
 
@@ -40,8 +61,8 @@ TEST_CASE("TEST BUFFERED CURSOR HELPER IN PARALLEL") {
 
 	for (size_t i = NoOfWriters; i > 0; --i) {
 
-		auto fn  = [&helper] (size_t prev_i, size_t i) {
-			return helper.UpdateCursor(prev_i, i);
+		auto fn  = [&helper] (size_t pos_begin, size_t pos_end) {
+			return helper.UpdateCursor(pos_begin, pos_end);
 		};
 		futures[i-1] = std::async(std::launch::async, fn, i-1,i);
 	}
@@ -58,6 +79,56 @@ TEST_CASE("TEST BUFFERED CURSOR HELPER IN PARALLEL") {
 
 }
 
+TEST_CASE("TEST AVAILABILITY CURSOR HELPER OUT OF ORDER") {
+	// When more publishes are pending than the BUFFERED helper could hold,
+	// the availability helper must not stall and the cursor must only advance over contiguous slots.
+	constexpr size_t Capacity = 128;
+	constexpr size_t NoOfWriters = 100;
+	disruptor::detail::CursorUpdateHelper<disruptor::PublishPolicy::AVAILABILITY> helper("Writer", Capacity);
+
+	for (size_t i = NoOfWriters-1; i > 0; --i) {
+		REQUIRE(helper.UpdateCursor(i, i+1) == disruptor::detail::PublishUpdateStatus::SUCCESS);
+		REQUIRE(helper.cursor() == 0);
+	}
+	helper.UpdateCursor(0, 1);
+	REQUIRE(helper.cursor() == NoOfWriters);
+
+	// The next lap must not be confused with the previous one.
+	helper.UpdateCursor(NoOfWriters, Capacity);
+	helper.UpdateCursor(Capacity+1, Capacity+2);
+	REQUIRE(helper.cursor() == Capacity);
+	helper.UpdateCursor(Capacity, Capacity+1);
+	REQUIRE(helper.cursor() == Capacity+2);
+}
+
+TEST_CASE("TEST AVAILABILITY CURSOR HELPER IN PARALLEL") {
+	constexpr size_t Capacity = 512;
+	constexpr size_t NoOfWriters = 64;
+	disruptor::detail::CursorUpdateHelper<disruptor::PublishPolicy::AVAILABILITY> helper("Writer", Capacity);
+
+	std::array<std::future<disruptor::detail::PublishUpdateStatus>, NoOfWriters> futures{};
+	for (size_t i = NoOfWriters; i > 0; --i) {
+		auto fn  = [&helper] (size_t pos_begin, size_t pos_end) {
+			return helper.UpdateCursor(pos_begin, pos_end);
+		};
+		futures[i-1] = std::async(std::launch::async, fn, i-1,i);
+	}
+
+	for (auto& future: futures) {
+		REQUIRE(future.get() == disruptor::detail::PublishUpdateStatus::SUCCESS);
+	}
+	REQUIRE(helper.cursor() == NoOfWriters);
+}
+
+TEST_CASE("TEST SINGLE CURSOR HELPER SEQUENTIALLY") {
+	disruptor::detail::CursorUpdateHelper<disruptor::PublishPolicy::SINGLE> helper;
+	constexpr size_t NoOfWrites = 20;
+	for (size_t i = 0; i < NoOfWrites; ++i) {
+		REQUIRE(helper.UpdateCursor(i, i+1) == disruptor::detail::PublishUpdateStatus::SUCCESS);
+		REQUIRE(helper.cursor() == i+1);
+	}
+}
+
 SCENARIO( "Writer Performance Tests") {
 	// When we use writers to write to a buffer in parallel without reading. 
 	// As long as the number of writes are under the ring buffer capacity (~512),
@@ -77,7 +148,7 @@ SCENARIO( "Writer Performance Tests") {
 
 		WHEN ("Writer write unique set of data without a reader reading") {
 			constexpr size_t NoOfWritesPerWriter = 100;
-			barrier::Barrier <NoOfWriters>b;
+			barrier::Barrier b(NoOfWriters);
 
 			auto callback = std::bind (&DisruptorType::ResetReaderWriter, disruptor);
 			auto loop = [&] (WriterType& writer, const size_t data) {
@@ -85,7 +156,7 @@ SCENARIO( "Writer Performance Tests") {
 				size_t data_t = data;
 
 				for (size_t i = 0; i < NoOfWritesPerWriter; ++i) {	
-					b.Wait(callback);
+					b.Wait(data / NoOfWritesPerWriter, callback);
 					auto d = data_t;
 					writer.Write(std::forward<size_t>(d));
 					++data_t;
@@ -196,7 +267,7 @@ SCENARIO( "Reader Performance Tests") {
 					// We require that each data is unique so we create hash table of values;
 					// If any value appears more than once, 
 					// then our unique assumption is incorrect and thus our system is faulty.
-					std::array<size_t, NoOfWriters*NoOfWritesPerWriter> value_count{};
+					std::vector<size_t> value_count(NoOfWriters*NoOfWritesPerWriter);
 
 					for (size_t i=0; i< NoOfWriters*NoOfWritesPerWriter;++i) {
 						const auto idx = sink[i];	
@@ -211,6 +282,1978 @@ SCENARIO( "Reader Performance Tests") {
 	}
 
 }
+TEST_CASE("TEST AVAILABILITY PUBLISH POLICY READS ALL WRITES") {
+	// Many writers and competing readers all publishing out of order.
+	constexpr size_t NoOfWriters = 8;
+	constexpr size_t NoOfReaders = 2;
+	constexpr size_t NoOfWritesPerWriter = 1e4;
+	constexpr size_t NoOfWrites = NoOfWriters*NoOfWritesPerWriter;
+
+	auto disruptor = disruptor::MakeSingleDisruptor<size_t, disruptor::PublishPolicy::AVAILABILITY, disruptor::PublishPolicy::AVAILABILITY>();
+
+	std::vector<std::future<void>> writers;
+	for (size_t i = 0; i < NoOfWriters; ++i) {
+		writers.push_back(std::async(std::launch::async, [writer = disruptor.CreateWriter(), i] () mutable {
+			for (size_t j = i*NoOfWritesPerWriter; j < (i+1)*NoOfWritesPerWriter; ++j) {
+				size_t d = j;
+				while(writer.Write(std::move(d))) {}
+			}
+		}));
+	}
+
+	std::atomic<size_t> read_count{};
+	auto read_loop = [&, reader = disruptor.CreateReader()] () mutable {
+		std::vector<size_t> sink;
+		while (read_count.load() < NoOfWrites) {
+			auto read_result = reader.Read(64);
+			if (read_result.err) { continue; }
+			size_t n = 0;
+			for (auto iter = read_result.begin; iter != read_result.end; ++iter, ++n) {
+				sink.push_back((*iter).data());
+			}
+			read_result.Release();
+			read_count += n;
+		}
+		return sink;
+	};
+
+	std::vector<std::future<std::vector<size_t>>> readers;
+	for (size_t i = 0; i < NoOfReaders; ++i) {
+		readers.push_back(std::async(std::launch::async, read_loop));
+	}
+
+	std::vector<size_t> value_count(NoOfWrites);
+	for (auto& reader: readers) {
+		for (auto value: reader.get()) {
+			++value_count[value];
+		}
+	}
+	for (auto& writer: writers) {
+		writer.wait();
+	}
+
+	REQUIRE(read_count.load() == NoOfWrites);
+	REQUIRE(std::all_of(value_count.begin(), value_count.end(), [](size_t count) { return count == 1; }));
+}
+
+TEST_CASE("TEST CACHED GATES ON A SMALL RING") {
+	// A tiny ring keeps every writer and reader on the full/empty boundary,
+	// so cached gate positions are constantly stale and refreshed.
+	using WriteCursorT = disruptor::WriteCursor<size_t, disruptor::PublishPolicy::BLOCK>;
+	using ReadCursorT = disruptor::ReadCursor<size_t, disruptor::PublishPolicy::BLOCK>;
+	static_assert(alignof(WriteCursorT) >= hardware_destructive_interference_size);
+	static_assert(alignof(ReadCursorT) >= hardware_destructive_interference_size);
+
+	constexpr size_t NoOfWriters = 4;
+	constexpr size_t NoOfReaders = 2;
+	constexpr size_t NoOfWritesPerWriter = 1e3;
+	constexpr size_t NoOfWrites = NoOfWriters*NoOfWritesPerWriter;
+
+	auto disruptor = disruptor::MakeSingleDisruptor<size_t, disruptor::PublishPolicy::BLOCK, disruptor::PublishPolicy::BLOCK>(
+		disruptor::ConsumerMode::COMPETING, 8);
+
+	std::vector<std::future<void>> writers;
+	for (size_t i = 0; i < NoOfWriters; ++i) {
+		writers.push_back(std::async(std::launch::async, [writer = disruptor.CreateWriter(), i] () mutable {
+			for (size_t j = i*NoOfWritesPerWriter; j < (i+1)*NoOfWritesPerWriter; ++j) {
+				size_t d = j;
+				while(writer.Write(std::move(d))) {}
+			}
+		}));
+	}
+
+	std::atomic<size_t> read_count{};
+	auto read_loop = [&, reader = disruptor.CreateReader()] () mutable {
+		std::vector<size_t> sink;
+		while (read_count.load() < NoOfWrites) {
+			auto read_result = reader.Read(4);
+			if (read_result.err) { continue; }
+			size_t n = 0;
+			for (auto iter = read_result.begin; iter != read_result.end; ++iter, ++n) {
+				sink.push_back((*iter).data());
+			}
+			read_result.Release();
+			read_count += n;
+		}
+		return sink;
+	};
+
+	std::vector<std::future<std::vector<size_t>>> readers;
+	for (size_t i = 0; i < NoOfReaders; ++i) {
+		readers.push_back(std::async(std::launch::async, read_loop));
+	}
+
+	std::vector<size_t> value_count(NoOfWrites);
+	for (auto& reader: readers) {
+		for (auto value: reader.get()) {
+			++value_count[value];
+		}
+	}
+	for (auto& writer: writers) {
+		writer.wait();
+	}
+
+	REQUIRE(read_count.load() == NoOfWrites);
+	REQUIRE(std::all_of(value_count.begin(), value_count.end(), [](size_t count) { return count == 1; }));
+}
+
+TEST_CASE("TEST GATES ARE ONLY REFRESHED AT THE RING BOUNDARIES") {
+	constexpr size_t Capacity = 8;
+	auto disruptor = disruptor::MakeSingleDisruptor<size_t, disruptor::PublishPolicy::SINGLE, disruptor::PublishPolicy::SINGLE>(
+		disruptor::ConsumerMode::COMPETING, Capacity);
+	auto writer = disruptor.CreateWriter();
+	auto reader = disruptor.CreateReader();
+
+	// An empty ring has room for a whole lap without looking at the reader.
+	for (size_t i = 0; i < Capacity; ++i) {
+		REQUIRE_FALSE(writer.Write(i));
+	}
+	REQUIRE(writer.GateRefreshes() == 0);
+
+	// The reader's cache starts out empty, and says so again once the lap is read.
+	auto read_result = reader.Read(Capacity);
+	REQUIRE(read_result.end != read_result.begin);
+	read_result.Release();
+	REQUIRE(reader.Read(1).err);
+	REQUIRE(reader.GateRefreshes() == 2);
+
+	// A full cache is refreshed once, then covers the next lap.
+	for (size_t i = Capacity; i < 2*Capacity; ++i) {
+		REQUIRE_FALSE(writer.Write(i));
+	}
+	REQUIRE(writer.GateRefreshes() == 1);
+}
+
+TEST_CASE("TEST SINGLE WRITER SINGLE READER READS ALL WRITES IN ORDER") {
+	constexpr size_t NoOfWrites = 1e5;
+	auto disruptor = disruptor::MakeSingleDisruptor<size_t, disruptor::PublishPolicy::SINGLE, disruptor::PublishPolicy::SINGLE>();
+
+	auto writer_task = std::async(std::launch::async, [writer = disruptor.CreateWriter()] () mutable {
+		for (size_t i = 0; i < NoOfWrites; ++i) {
+			size_t d = i;
+			while(writer.Write(std::move(d))) {}
+		}
+	});
+
+	auto reader = disruptor.CreateReader();
+	size_t expected = 0;
+	bool in_order = true;
+	while (expected < NoOfWrites) {
+		auto read_result = reader.Read(128);
+		if (read_result.err) { continue; }
+		for (auto iter = read_result.begin; iter != read_result.end; ++iter) {
+			in_order &= (*iter).data() == expected++;
+		}
+		read_result.Release();
+	}
+	writer_task.wait();
+	REQUIRE(in_order);
+}
+
+TEST_CASE("TEST BROADCAST READERS EACH READ ALL WRITES") {
+	// Every broadcast reader must see the full stream in order, 
+	// and the writer must never overwrite a slot the slowest reader has not released.
+	constexpr size_t NoOfReaders = 3;
+	constexpr size_t NoOfWrites = 1e4;
+
+	auto disruptor = disruptor::MakeSingleDisruptor<size_t, disruptor::PublishPolicy::SINGLE, disruptor::PublishPolicy::SINGLE>(disruptor::ConsumerMode::BROADCAST);
+
+	std::vector<std::future<bool>> readers;
+	for (size_t i = 0; i < NoOfReaders; ++i) {
+		readers.push_back(std::async(std::launch::async, [reader = disruptor.CreateReader()] () mutable {
+			size_t expected = 0;
+			bool in_order = true;
+			while (expected < NoOfWrites) {
+				auto read_result = reader.Read(128);
+				if (read_result.err) { continue; }
+				for (auto iter = read_result.begin; iter != read_result.end; ++iter) {
+					in_order &= (*iter).data() == expected++;
+				}
+				read_result.Release();
+			}
+			return in_order;
+		}));
+	}
+
+	auto writer = disruptor.CreateWriter();
+	for (size_t i = 0; i < NoOfWrites; ++i) {
+		size_t d = i;
+		while(writer.Write(std::move(d))) {}
+	}
+
+	for (auto& reader: readers) {
+		REQUIRE(reader.get());
+	}
+	REQUIRE(writer.GetCursor() == NoOfWrites);
+}
+
+TEST_CASE("TEST BROADCAST READERS ADDED LATE START AT THE WRITE CURSOR") {
+	auto disruptor = disruptor::MakeSingleDisruptor<size_t, disruptor::PublishPolicy::SINGLE, disruptor::PublishPolicy::SINGLE>(
+		disruptor::ConsumerMode::BROADCAST, 8);
+	auto writer = disruptor.CreateWriter();
+	auto read_all = [] (auto& reader) {
+		std::vector<size_t> values;
+		auto read_result = reader.Read(16);
+		if (read_result.err) { return values; }
+		for (auto iter = read_result.begin; iter != read_result.end; ++iter) {
+			values.push_back((*iter).data());
+		}
+		read_result.Release();
+		return values;
+	};
+
+	// Nobody to deliver to: dropped, but not an error a retry loop would spin on.
+	for (size_t i = 0; i < 3; ++i) {
+		REQUIRE_FALSE(writer.Write(i));
+	}
+	auto early = disruptor.CreateReader();
+	for (size_t i = 3; i < 8; ++i) {
+		REQUIRE_FALSE(writer.Write(i));
+	}
+	auto late = disruptor.CreateReader();
+	REQUIRE_FALSE(writer.Write(size_t{8}));
+
+	REQUIRE(read_all(early) == std::vector<size_t>{3, 4, 5, 6, 7, 8});
+	REQUIRE(read_all(late) == std::vector<size_t>{8});
+}
+
+TEST_CASE("TEST BROADCAST WRITER IS GATED ON SLOWEST READER") {
+	auto disruptor = disruptor::MakeSingleDisruptor<size_t, disruptor::PublishPolicy::BLOCK, disruptor::PublishPolicy::BLOCK>(disruptor::ConsumerMode::BROADCAST);
+	auto writer = disruptor.CreateWriter();
+	auto fast_reader = disruptor.CreateReader();
+	auto slow_reader = disruptor.CreateReader();
+	const size_t capacity = disruptor.buffer()->size();
+
+	for (size_t i = 0; i < capacity; ++i) {
+		size_t d = i;
+		REQUIRE_FALSE(writer.Write(std::move(d)));
+	}
+
+	// Draining the fast reader alone must not free any space.
+	auto read_result = fast_reader.Read(capacity);
+	REQUIRE_FALSE(read_result.err);
+	read_result.Release();
+	REQUIRE(fast_reader.GetCursor() == capacity);
+
+	auto write_task = std::async(std::launch::async, [&writer] {
+		size_t d = 0;
+		while(writer.Write(std::move(d))) {}
+	});
+	REQUIRE(write_task.wait_for(std::chrono::milliseconds(10)) == std::future_status::timeout);
+	REQUIRE(writer.GetCursor() == capacity);
+
+	auto slow_result = slow_reader.Read(1);
+	REQUIRE_FALSE(slow_result.err);
+	slow_result.Release();
+	write_task.wait();
+	REQUIRE(writer.GetCursor() == capacity + 1);
+}
+
+TEST_CASE("TEST DIAMOND READER GRAPH RESPECTS UPSTREAM STAGES") {
+	// decode -> (enrich, risk) -> route. Route must never read a sequence 
+	// that enrich and risk have not both released.
+	constexpr size_t NoOfWrites = 1e4;
+	using ReaderType = disruptor::Reader<size_t, disruptor::PublishPolicy::SINGLE, disruptor::PublishPolicy::SINGLE>;
+
+	auto disruptor = disruptor::MakeSingleDisruptor<size_t, disruptor::PublishPolicy::SINGLE, disruptor::PublishPolicy::SINGLE>(disruptor::ConsumerMode::BROADCAST);
+	auto decode = disruptor.HandleEventsWith(1);
+	auto enrich = decode.Then(1);
+	auto risk = decode.Then(1);
+	auto route = enrich.And(risk).Then(1);
+	REQUIRE(route.size() == 1);
+
+	auto stage = [] (ReaderType reader, std::vector<ReaderType> upstream) {
+		size_t expected = 0;
+		bool valid = true;
+		while (expected < NoOfWrites) {
+			auto read_result = reader.Read(64);
+			if (read_result.err) { continue; }
+			for (auto iter = read_result.begin; iter != read_result.end; ++iter) {
+				valid &= (*iter).data() == expected++;
+			}
+			for (const auto& dependency: upstream) {
+				valid &= dependency.GetCursor() >= expected;
+			}
+			read_result.Release();
+		}
+		return valid;
+	};
+
+	std::vector<std::future<bool>> stages;
+	stages.push_back(std::async(std::launch::async, stage, decode[0], std::vector<ReaderType>{}));
+	stages.push_back(std::async(std::launch::async, stage, enrich[0], std::vector<ReaderType>{decode[0]}));
+	stages.push_back(std::async(std::launch::async, stage, risk[0], std::vector<ReaderType>{decode[0]}));
+	stages.push_back(std::async(std::launch::async, stage, route[0], std::vector<ReaderType>{enrich[0], risk[0]}));
+
+	auto writer = disruptor.CreateWriter();
+	for (size_t i = 0; i < NoOfWrites; ++i) {
+		size_t d = i;
+		while(writer.Write(std::move(d))) {}
+	}
+
+	for (auto& stage_result: stages) {
+		REQUIRE(stage_result.get());
+	}
+}
+
+TEST_CASE("TEST CLAIMED SLOTS WRAP AS TWO SEGMENTS") {
+	auto disruptor = disruptor::MakeSingleDisruptor<size_t, disruptor::PublishPolicy::SINGLE, disruptor::PublishPolicy::SINGLE>(
+		disruptor::ConsumerMode::COMPETING, 8);
+	auto writer = disruptor.CreateWriter();
+	auto reader = disruptor.CreateReader();
+
+	auto read_all = [&] () {
+		std::vector<size_t> values;
+		auto read_result = reader.Read(8);
+		for (auto iter = read_result.begin; !read_result.err && iter != read_result.end; ++iter) {
+			values.push_back((*iter).data());
+		}
+		read_result.Release();
+		return values;
+	};
+
+	{
+		auto claim = writer.Claim(5);
+		REQUIRE_FALSE(claim.err);
+		REQUIRE(claim.size() == 5);
+		REQUIRE(claim.segments()[1].empty());
+		for (size_t i = 0; i < claim.size(); ++i) {
+			claim[i].data() = claim.sequence(i);
+		}
+		// Nothing is visible until the claim is published.
+		REQUIRE(reader.Read(1).err);
+	}
+	REQUIRE(read_all() == std::vector<size_t>{0, 1, 2, 3, 4});
+
+	auto claim = writer.Claim(6);
+	REQUIRE(claim.size() == 6);
+	auto [head, tail] = claim.segments();
+	REQUIRE(head.size() == 3);
+	REQUIRE(tail.size() == 3);
+	size_t value = 5;
+	for (auto segment: {head, tail}) {
+		for (auto& slot: segment) {
+			slot.data() = value++;
+		}
+	}
+	claim.Publish();
+	REQUIRE(read_all() == std::vector<size_t>{5, 6, 7, 8, 9, 10});
+
+	// Only the space left in the ring is claimed.
+	REQUIRE(writer.Claim(100).size() == 8);
+}
+
+TEST_CASE("TEST CLAIMED SLOTS ARE CONSTRUCTED IN PLACE") {
+	struct Quote {
+		Quote() = default;
+		Quote(size_t id_in, double px_in) : id(id_in), px(px_in) {}
+		size_t id{};
+		double px{};
+	};
+	static constexpr size_t NoOfWrites = 1e4;
+	static constexpr size_t Burst = 32;
+
+	auto disruptor = disruptor::MakeSingleDisruptor<Quote, disruptor::PublishPolicy::BLOCK, disruptor::PublishPolicy::BLOCK>(
+		disruptor::ConsumerMode::COMPETING, 64);
+
+	auto writer_task = std::async(std::launch::async, [writer = disruptor.CreateWriter()] () mutable {
+		for (size_t written = 0; written < NoOfWrites;) {
+			auto claim = writer.Claim(std::min(Burst, NoOfWrites - written));
+			for (size_t i = 0; i < claim.size(); ++i, ++written) {
+				claim.Emplace(i, written, 0.5 * static_cast<double>(written));
+			}
+		}
+	});
+
+	auto reader = disruptor.CreateReader();
+	size_t expected = 0;
+	bool in_order = true;
+	while (expected < NoOfWrites) {
+		auto read_result = reader.Read(Burst);
+		if (read_result.err) { continue; }
+		for (auto iter = read_result.begin; iter != read_result.end; ++iter, ++expected) {
+			in_order &= (*iter).data().id == expected && (*iter).data().px == 0.5 * static_cast<double>(expected);
+		}
+		read_result.Release();
+	}
+	writer_task.wait();
+	REQUIRE(in_order);
+}
+
+TEST_CASE("TEST EMPLACE KEEPS THE SLOT WHEN THE CONSTRUCTOR THROWS") {
+	struct Named {
+		Named() = default;
+		Named(const std::string& name_in, bool fail) : name(name_in) {
+			if (fail) { throw std::runtime_error("failed"); }
+		}
+		std::string name;
+	};
+	const std::string kept(64, 'k');
+
+	auto disruptor = disruptor::MakeSingleDisruptor<Named, disruptor::PublishPolicy::SINGLE, disruptor::PublishPolicy::SINGLE>(
+		disruptor::ConsumerMode::COMPETING, 8);
+	auto writer = disruptor.CreateWriter();
+	auto reader = disruptor.CreateReader();
+	{
+		auto claim = writer.Claim(1);
+		REQUIRE(claim.size() == 1);
+		claim.Emplace(0, kept, false);
+		REQUIRE_THROWS_AS(claim.Emplace(0, std::string(64, 'x'), true), std::runtime_error);
+		REQUIRE(claim[0].data().name == kept);
+	}
+	auto read_result = reader.Read(1);
+	REQUIRE_FALSE(read_result.err);
+	REQUIRE((*read_result.begin).data().name == kept);
+}
+
+TEST_CASE("TEST READ VIEWS ARE RELEASED ON DESTRUCTION") {
+	auto disruptor = disruptor::MakeSingleDisruptor<size_t, disruptor::PublishPolicy::SINGLE, disruptor::PublishPolicy::SINGLE, disruptor::BusySpinWait, disruptor::Layout::SOA>(
+		disruptor::ConsumerMode::COMPETING, 8);
+	auto writer = disruptor.CreateWriter();
+	auto reader = disruptor.CreateReader();
+
+	for (size_t i = 0; i < 6; ++i) {
+		REQUIRE_FALSE(writer.Write(i));
+	}
+	{
+		auto view = reader.View(6);
+		REQUIRE(view.size() == 6);
+		REQUIRE(view.segments()[1].empty());
+	}
+	REQUIRE(reader.GetCursor() == 6);
+
+	for (size_t i = 6; i < 12; ++i) {
+		REQUIRE_FALSE(writer.Write(i));
+	}
+	auto view = reader.View(8);
+	REQUIRE(view.sequence() == 6);
+	auto [head, tail] = view.segments();
+	REQUIRE(head.size() == 2);
+	REQUIRE(tail.size() == 4);
+	std::vector<size_t> values(head.begin(), head.end());
+	values.insert(values.end(), tail.begin(), tail.end());
+	REQUIRE(values == std::vector<size_t>{6, 7, 8, 9, 10, 11});
+
+	// Moving hands the release over to the new owner.
+	auto moved = std::move(view);
+	REQUIRE(view.err);
+	REQUIRE(reader.GetCursor() == 6);
+	moved.Release();
+	REQUIRE(reader.GetCursor() == 12);
+	REQUIRE(reader.View(1).err);
+}
+
+TEST_CASE("TEST SPAN VIEWS MATCH ITERATOR READS") {
+	constexpr size_t Capacity = 1 << 12;
+	constexpr size_t NoOfRounds = 200;
+
+	auto disruptor = disruptor::MakeSingleDisruptor<size_t, disruptor::PublishPolicy::SINGLE, disruptor::PublishPolicy::SINGLE, disruptor::BusySpinWait, disruptor::Layout::SOA>(
+		disruptor::ConsumerMode::COMPETING, Capacity);
+	auto writer = disruptor.CreateWriter();
+	auto reader = disruptor.CreateReader();
+
+	// Fills the free part of the ring. After the first half ring is read, every read wraps.
+	auto fill = [&] (size_t num) {
+		auto claim = writer.Claim(num);
+		for (size_t i = 0; i < claim.size(); ++i) {
+			claim[i].data() = claim.sequence(i) % 1024;
+		}
+	};
+
+	size_t iterator_sum = 0, span_sum = 0;
+	fill(Capacity / 2);
+	reader.Read(Capacity / 2).Release();
+	for (size_t round = 0; round < NoOfRounds; ++round) {
+		fill(Capacity);
+		{
+			auto view = reader.View(Capacity);
+			for (const auto& segment: view.segments()) {
+				span_sum = std::accumulate(segment.begin(), segment.end(), span_sum);
+			}
+		}
+
+		fill(Capacity);
+		auto read_result = reader.Read(Capacity);
+		for (auto iter = read_result.begin; iter != read_result.end; ++iter) {
+			iterator_sum += (*iter).data();
+		}
+		read_result.Release();
+	}
+
+	// Both paths read the same values: round r of each reads one full ring.
+	REQUIRE(span_sum != 0);
+	REQUIRE(iterator_sum == span_sum);
+}
+
+namespace {
+	struct RecordingHandler {
+		void OnStart() 		{ started = true; }
+		void OnShutdown() 	{ shut_down = true; }
+		void OnEvent(size_t& event, size_t sequence, bool end_of_batch) {
+			in_order &= event == sequence && sequence == events.size();
+			events.push_back(event);
+			batches += end_of_batch;
+		}
+		std::vector<size_t> events;
+		size_t batches{};
+		bool in_order{true};
+		bool started{};
+		bool shut_down{};
+	};
+}
+
+TEST_CASE("TEST BATCH EVENT PROCESSOR STOPS AT END OF STREAM") {
+	constexpr size_t NoOfWrites = 1e4;
+	auto disruptor = disruptor::MakeSingleDisruptor<size_t, disruptor::PublishPolicy::SINGLE, disruptor::PublishPolicy::SINGLE>(
+		disruptor::ConsumerMode::COMPETING, 256);
+
+	disruptor::BatchEventProcessor processor(disruptor.CreateReader(), RecordingHandler{});
+	processor.Start();
+
+	auto writer = disruptor.CreateWriter();
+	for (size_t i = 0; i < NoOfWrites; ++i) {
+		while(writer.Write(i, i + 1 == NoOfWrites)) {}
+	}
+	processor.Join();
+
+	const auto& handler = processor.handler();
+	REQUIRE_FALSE(processor.is_running());
+	REQUIRE(handler.started);
+	REQUIRE(handler.shut_down);
+	REQUIRE(handler.in_order);
+	REQUIRE(handler.events.size() == NoOfWrites);
+	// Batches follow the backlog, so there is never more than one per event.
+	REQUIRE(handler.batches > 0);
+	REQUIRE(handler.batches <= NoOfWrites);
+	REQUIRE(processor.reader().GetCursor() == NoOfWrites);
+}
+
+TEST_CASE("TEST BATCH EVENT PROCESSOR HALTS WHEN IDLE") {
+	auto disruptor = disruptor::MakeSingleDisruptor<size_t, disruptor::PublishPolicy::SINGLE, disruptor::PublishPolicy::SINGLE, disruptor::BlockingWait>();
+	disruptor::BatchEventProcessor processor(disruptor.CreateReader(), RecordingHandler{}, 16);
+	processor.Start();
+
+	auto writer = disruptor.CreateWriter();
+	for (size_t i = 0; i < 100; ++i) {
+		while(writer.Write(i)) {}
+	}
+	REQUIRE(tests::WAIT_TEST([&] { return processor.reader().GetCursor() == 100; }));
+
+	// The processor is now parked on the ring's signal; halting must wake it.
+	processor.Halt();
+	processor.Join();
+	REQUIRE_FALSE(processor.is_running());
+	REQUIRE(processor.handler().events.size() == 100);
+	REQUIRE(processor.handler().batches >= 100 / 16);
+
+	// A halted processor starts again where its reader left off.
+	processor.Start();
+	for (size_t i = 100; i < 200; ++i) {
+		while(writer.Write(i)) {}
+	}
+	REQUIRE(tests::WAIT_TEST([&] { return processor.reader().GetCursor() == 200; }));
+	processor.Halt();
+	processor.Join();
+	REQUIRE(processor.handler().events.size() == 200);
+	REQUIRE(processor.handler().in_order);
+}
+
+TEST_CASE("TEST BATCH EVENT PROCESSOR RESTARTED AFTER END OF STREAM") {
+	constexpr size_t Capacity = 8;
+	auto disruptor = disruptor::MakeSingleDisruptor<size_t, disruptor::PublishPolicy::SINGLE, disruptor::PublishPolicy::SINGLE>(
+		disruptor::ConsumerMode::COMPETING, Capacity);
+	disruptor::BatchEventProcessor processor(disruptor.CreateReader(), RecordingHandler{});
+	auto writer = disruptor.CreateWriter();
+
+	processor.Start();
+	while(writer.Write(size_t{0}, true)) {}
+	processor.Join();
+	REQUIRE(processor.handler().events.size() == 1);
+
+	// Later laps reuse the slot that carried the end of stream, through both Write and Claim.
+	processor.Start();
+	for (size_t i = 1; i < Capacity; ++i) {
+		while(writer.Write(i)) {}
+	}
+	for (size_t i = Capacity; i < 3*Capacity; ) {
+		auto claim = writer.Claim(3*Capacity - i);
+		for (size_t s = 0; s < claim.size(); ++s, ++i)
+			claim[s].data() = i;
+	}
+	REQUIRE(tests::WAIT_TEST([&] { return processor.reader().GetCursor() == 3*Capacity; }));
+	processor.Halt();
+	processor.Join();
+	REQUIRE(processor.handler().events.size() == 3*Capacity);
+	REQUIRE(processor.handler().in_order);
+}
+
+TEST_CASE("TEST SHARED MEMORY DISRUPTOR ACROSS PROCESSES") {
+	constexpr size_t NoOfWrites = 1e4;
+	const std::string name = "/lmax_disruptor_test_" + std::to_string(::getpid());
+
+	auto ring = disruptor::ShmRing<size_t>::Create(name, 64);
+	// Registered before the writer starts so no event is missed.
+	auto reader = ring->CreateReader();
+	REQUIRE(reader.is_registered());
+
+	const pid_t child = ::fork();
+	if (child == 0) {
+		// Writer process. _Exit skips Catch's and the parent's destructors.
+		auto writer = disruptor::ShmRing<size_t>::Open(name)->CreateWriter();
+		for (size_t i = 0; i < NoOfWrites; ++i) {
+			while(writer.Write(i, i + 1 == NoOfWrites)) {}
+		}
+		std::_Exit(0);
+	}
+	REQUIRE(child > 0);
+
+	size_t expected = 0;
+	bool in_order = true, is_eof = false;
+	while (!is_eof) {
+		auto reservation = reader.Reserve(32);
+		if (reservation.err) { continue; }
+		for (size_t pos = reservation.pos_begin; pos < reservation.pos_end; ++pos) {
+			in_order &= reader.at(pos).data() == expected++;
+			is_eof |= reader.at(pos).is_eof();
+		}
+		reader.Publish(reservation.pos_begin, reservation.pos_end);
+	}
+
+	int status = 0;
+	REQUIRE(::waitpid(child, &status, 0) == child);
+	REQUIRE(WIFEXITED(status));
+	REQUIRE(WEXITSTATUS(status) == 0);
+	REQUIRE(in_order);
+	REQUIRE(expected == NoOfWrites);
+	REQUIRE_FALSE(ring->IsStalled());
+}
+
+TEST_CASE("TEST SHARED MEMORY DISRUPTOR REAPS STALE READERS") {
+	const std::string name = "/lmax_disruptor_test_" + std::to_string(::getpid());
+	auto ring = disruptor::ShmRing<size_t>::Create(name, 8);
+
+	const pid_t child = ::fork();
+	if (child == 0) {
+		// A reader that dies without unregistering.
+		auto reader = disruptor::ShmRing<size_t>::Open(name)->CreateReader();
+		std::_Exit(reader.is_registered() ? 0 : 1);
+	}
+	int status = 0;
+	REQUIRE(::waitpid(child, &status, 0) == child);
+	REQUIRE(WEXITSTATUS(status) == 0);
+	REQUIRE(ring->NumReaders() == 1);
+
+	// The dead reader still gates the writer until it is reaped.
+	auto writer = ring->CreateWriter();
+	for (size_t i = 0; i < ring->size(); ++i) {
+		REQUIRE_FALSE(writer.Write(i));
+	}
+	REQUIRE(ring->GetGatingCursor() == 0);
+
+	REQUIRE(ring->ReapStalePeers() == 1);
+	REQUIRE(ring->NumReaders() == 0);
+	REQUIRE(writer.Write(size_t{0}));
+
+	auto reader = ring->CreateReader();
+	REQUIRE(reader.GetCursor() == ring->size());
+	REQUIRE_FALSE(writer.Write(size_t{8}));
+}
+
+TEST_CASE("TEST SHARED MEMORY DISRUPTOR REJECTS MISMATCHED LAYOUTS") {
+	const std::string name = "/lmax_disruptor_test_" + std::to_string(::getpid());
+	auto ring = disruptor::ShmRing<size_t>::Create(name, 8);
+
+	REQUIRE_NOTHROW(disruptor::ShmRing<size_t>::Open(name));
+	REQUIRE_THROWS_AS(disruptor::ShmRing<tests::Event<64>>::Open(name), std::system_error);
+	REQUIRE_THROWS_AS(disruptor::ShmRing<size_t>::Open(name + "_missing"), std::system_error);
+}
+
+TEMPLATE_TEST_CASE("TEST WAIT STRATEGIES", "[wait]", 
+	disruptor::BusySpinWait, disruptor::SpinThenYieldWait, disruptor::BackoffWait, disruptor::SleepingWait, disruptor::BlockingWait) {
+	// Each strategy must deliver every write exactly once, with writers waiting on a small ring.
+	// disruptor_bench --wait-strategies compares their cost.
+	constexpr size_t NoOfWriters = 3;
+	constexpr size_t NoOfWritesPerWriter = 2e4;
+
+	auto disruptor = disruptor::MakeSingleDisruptor<size_t, disruptor::PublishPolicy::BLOCK, disruptor::PublishPolicy::BLOCK, TestType>(
+		disruptor::ConsumerMode::COMPETING, 64);
+	std::vector<std::future<void>> writers;
+	for (size_t w = 0; w < NoOfWriters; ++w) {
+		writers.push_back(std::async(std::launch::async, [w, writer = disruptor.CreateWriter()] () mutable {
+			for (size_t i = w * NoOfWritesPerWriter; i < (w + 1) * NoOfWritesPerWriter; ++i) {
+				while(writer.Write(i)) {}
+			}
+		}));
+	}
+
+	auto reader = disruptor.CreateReader();
+	std::vector<size_t> value_count(NoOfWriters * NoOfWritesPerWriter);
+	for (size_t read = 0; read < value_count.size();) {
+		auto read_result = reader.Read(128);
+		if (read_result.err) { continue; }
+		for (auto iter = read_result.begin; iter != read_result.end; ++iter, ++read) {
+			++value_count[(*iter).data()];
+		}
+		read_result.Release();
+	}
+	for (auto& writer: writers) {
+		writer.get();
+	}
+	REQUIRE(std::all_of(value_count.begin(), value_count.end(), [](size_t count) { return count == 1; }));
+}
+
+TEST_CASE("TEST BARRIER WITH BLOCKING WAIT") {
+	constexpr int NoOfThreads = 4;
+	constexpr size_t NoOfRounds = 100;
+	barrier::Barrier b(NoOfThreads, 0);
+	std::atomic<size_t> arrivals{};
+
+	auto loop = [&] (size_t participant) {
+		bool in_step = true;
+		for (size_t i = 0; i < NoOfRounds; ++i) {
+			++arrivals;
+			b.Wait(participant);
+			// Nobody can pass round i before everyone has arrived at it.
+			in_step &= arrivals.load() >= (i+1)*NoOfThreads;
+		}
+		return in_step;
+	};
+
+	std::array<std::future<bool>, NoOfThreads> futures{};
+	for (size_t i = 0; i < futures.size(); ++i) {
+		futures[i] = std::async(std::launch::async, loop, i);
+	}
+	for (auto& future: futures) {
+		REQUIRE(future.get());
+	}
+}
+
+TEST_CASE("TEST TREE BARRIER WITH MANY THREADS") {
+	// 37 spreads unevenly over a three level tree of fan-in 4.
+	constexpr size_t NoOfThreads = 37;
+	constexpr size_t NoOfRounds = 50;
+	barrier::Barrier b(NoOfThreads);
+	std::atomic<size_t> arrivals{};
+	size_t phases = 0;
+
+	auto loop = [&] (size_t participant) {
+		bool in_step = true;
+		for (size_t i = 0; i < NoOfRounds; ++i) {
+			++arrivals;
+			in_step &= b.Wait(participant, [&] { ++phases; }) == barrier::WAIT_STATUS::SUCCESS;
+			in_step &= arrivals.load() >= (i+1)*NoOfThreads;
+		}
+		return in_step;
+	};
+
+	std::vector<std::future<bool>> futures;
+	for (size_t i = 0; i < NoOfThreads; ++i) {
+		futures.push_back(std::async(std::launch::async, loop, i));
+	}
+	for (auto& future: futures) {
+		REQUIRE(future.get());
+	}
+	// The callback runs exactly once per phase, on the last arrival.
+	REQUIRE(phases == NoOfRounds);
+}
+
+TEST_CASE("TEST BARRIER TIMEOUT BREAKS THE BARRIER") {
+	barrier::Barrier b(3);
+
+	// Only two of three participants turn up: one times out, the other is told the barrier broke.
+	auto late = std::async(std::launch::async, [&] { return b.Wait(1); });
+	REQUIRE(b.WaitFor(0, std::chrono::milliseconds(20)) == barrier::WAIT_STATUS::TIMEOUT);
+	REQUIRE(late.get() == barrier::WAIT_STATUS::BROKEN);
+	REQUIRE(b.is_broken());
+	REQUIRE(b.Wait(2) == barrier::WAIT_STATUS::BROKEN);
+
+	b.Reset();
+	REQUIRE_FALSE(b.is_broken());
+	std::array<std::future<barrier::WAIT_STATUS>, 2> others;
+	for (size_t i = 0; i < others.size(); ++i) {
+		others[i] = std::async(std::launch::async, [&, i] { return b.WaitFor(i + 1, std::chrono::seconds(10)); });
+	}
+	REQUIRE(b.WaitFor(0, std::chrono::seconds(10)) == barrier::WAIT_STATUS::SUCCESS);
+	for (auto& other: others) {
+		REQUIRE(other.get() == barrier::WAIT_STATUS::SUCCESS);
+	}
+}
+
+TEST_CASE("TEST RUNTIME SIZED RING BUFFERS") {
+	// A large ring on huge-page backed, prefaulted storage must behave like the default one.
+	static constexpr size_t Capacity = 1 << 16;
+	static_assert(disruptor::IsValidCapacity(Capacity));
+
+	auto run = [] (auto disruptor) {
+		auto writer = disruptor.CreateWriter();
+		auto reader = disruptor.CreateReader();
+		REQUIRE(disruptor.buffer()->size() == Capacity);
+
+		size_t expected = 0;
+		bool in_order = true;
+		for (size_t lap = 0; lap < 3; ++lap) {
+			bool written = true;
+			for (size_t i = 0; i < Capacity; ++i) {
+				size_t d = lap*Capacity + i;
+				written &= !writer.Write(std::move(d));
+			}
+			REQUIRE(written);
+			while (expected < (lap+1)*Capacity) {
+				auto read_result = reader.Read(1024);
+				REQUIRE_FALSE(read_result.err);
+				for (auto iter = read_result.begin; iter != read_result.end; ++iter) {
+					in_order &= (*iter).data() == expected++;
+				}
+				read_result.Release();
+			}
+		}
+		REQUIRE(in_order);
+	};
+
+	SECTION("Heap allocated") {
+		run(disruptor::MakeSingleDisruptor<size_t, disruptor::PublishPolicy::SINGLE, disruptor::PublishPolicy::SINGLE>(
+			disruptor::ConsumerMode::COMPETING, Capacity));
+	}
+	SECTION("Huge page mapped") {
+		disruptor::MmapOptions options{disruptor::PageSize::HUGE_2MB, true, -1};
+		run(disruptor::MakeSingleDisruptor<size_t, disruptor::PublishPolicy::SINGLE, disruptor::PublishPolicy::SINGLE>(
+			disruptor::ConsumerMode::COMPETING, Capacity, disruptor::MmapAllocator(options)));
+	}
+	SECTION("NUMA bound") {
+		// Kernels without NUMA support have no node 0 to bind to.
+		if (!std::filesystem::exists("/sys/devices/system/node/node0")) {
+			WARN("No NUMA node 0, skipping");
+			return;
+		}
+		disruptor::MmapOptions options{disruptor::PageSize::DEFAULT, true, 0};
+		run(disruptor::MakeSingleDisruptor<size_t, disruptor::PublishPolicy::SINGLE, disruptor::PublishPolicy::SINGLE>(
+			disruptor::ConsumerMode::COMPETING, Capacity, disruptor::MmapAllocator(options)));
+	}
+}
+
+TEMPLATE_TEST_CASE_SIG("TEST SLOT LAYOUTS", "[layout]", ((size_t Bytes, disruptor::Layout L), Bytes, L),
+	(8, disruptor::Layout::PADDED), (8, disruptor::Layout::PACKED), (8, disruptor::Layout::SOA),
+	(16, disruptor::Layout::PADDED), (16, disruptor::Layout::PACKED), (16, disruptor::Layout::SOA),
+	(64, disruptor::Layout::PADDED), (64, disruptor::Layout::PACKED), (64, disruptor::Layout::SOA)) {
+	constexpr size_t NoOfWrites = 2e5;
+
+	static_assert(sizeof(tests::Event<Bytes>) == Bytes);
+	if constexpr (L == disruptor::Layout::PACKED) {
+		// No per-slot padding beyond the end-of-stream flag.
+		static_assert(sizeof(disruptor::Sequence<tests::Event<Bytes>, L>) < Bytes + alignof(tests::Event<Bytes>) + 1);
+	}
+
+	REQUIRE(tests::LayoutTask<tests::Event<Bytes>, L>(NoOfWrites));
+}
+
+TEST_CASE("TEST LATENCY HISTOGRAM PERCENTILES") {
+	profiler::LatencyHistogram histogram;
+	for (uint64_t value = 1; value <= 1000000; ++value) {
+		histogram.Record(value);
+	}
+
+	auto within_precision = [](double value, double expected) { return std::abs(value - expected) <= expected / 64; };
+	auto stats = histogram.GetStats();
+	REQUIRE(stats.count == 1000000);
+	REQUIRE(stats.min == 1);
+	REQUIRE(stats.max == 1000000);
+	REQUIRE(stats.mean == 500000.5);
+	REQUIRE(within_precision(stats.p50, 500000));
+	REQUIRE(within_precision(stats.p99, 990000));
+	REQUIRE(within_precision(stats.p999, 999000));
+	REQUIRE(within_precision(stats.p9999, 999900));
+
+	// One value fills one wide bucket, but has no deviation.
+	profiler::LatencyHistogram single;
+	single.Record(1000003);
+	single.Record(1000003);
+	REQUIRE(single.GetStats().stdev == 0);
+	REQUIRE(single.GetStats().mean == 1000003);
+
+	// Small values are exact and every bucket boundary round-trips.
+	REQUIRE(histogram.ValueAtPercentile(0.0001) == 1);
+	for (size_t idx = 0; idx < profiler::LatencyHistogram::BucketIdx(std::numeric_limits<uint64_t>::max()); ++idx) {
+		REQUIRE(profiler::LatencyHistogram::BucketIdx(profiler::LatencyHistogram::BucketLow(idx)) == idx);
+		REQUIRE(profiler::LatencyHistogram::BucketIdx(profiler::LatencyHistogram::BucketHigh(idx)) == idx);
+	}
+}
+
+TEST_CASE("TEST PER THREAD HISTOGRAMS MERGE") {
+	constexpr size_t NoOfThreads = 4;
+	constexpr uint64_t NoOfRecords = 1e5;
+
+	profiler::HistogramRegistry registry;
+	std::vector<std::future<bool>> threads;
+	for (size_t i = 0; i < NoOfThreads; ++i) {
+		threads.push_back(std::async(std::launch::async, [&registry, i] {
+			auto& histogram = registry.Local();
+			for (uint64_t value = 0; value < NoOfRecords; ++value) {
+				histogram.Record(i * NoOfRecords + value);
+			}
+			// Every lookup from the same thread finds the same histogram.
+			return &histogram == &registry.Local();
+		}));
+	}
+	for (auto& thread: threads) {
+		REQUIRE(thread.get());
+	}
+
+	auto merged = registry.Merged();
+	REQUIRE(merged.count() == NoOfThreads * NoOfRecords);
+	REQUIRE(merged.min() == 0);
+	REQUIRE(merged.max() == NoOfThreads * NoOfRecords - 1);
+
+	{
+		profiler::ScopedProfiler profile;
+	}
+	REQUIRE(profiler::ScopedProfiler::GetStats().count >= 1);
+}
+
+TEST_CASE("TEST TSC CLOCK") {
+	// Agrees with steady_clock over an interval, whether or not the TSC is in use.
+	auto tsc_start = profiler::TscClock::now();
+	auto steady_start = std::chrono::steady_clock::now();
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	auto tsc_elapsed = std::chrono::duration<double, std::nano>(profiler::TscClock::now() - tsc_start).count();
+	auto steady_elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - steady_start).count();
+	REQUIRE(std::abs(tsc_elapsed - steady_elapsed) < steady_elapsed / 100 + 10000);
+
+	profiler::TscTimer timer;
+	timer.Start();
+	timer.Stop();
+	REQUIRE(timer.Stats().count == 1);
+}
+
+TEST_CASE("TEST TRY CLAIM ON A FULL RING") {
+	// TryClaim never waits: it takes what is free and returns an empty claim once the ring is full.
+	auto disruptor = disruptor::MakeSingleDisruptor<size_t>(disruptor::ConsumerMode::COMPETING, 8);
+	auto writer = disruptor.CreateWriter();
+	auto reader = disruptor.CreateReader();
+
+	REQUIRE(writer.TryClaim(6).size() == 6);
+	REQUIRE(writer.TryClaim(6).size() == 2);
+	auto full = writer.TryClaim(1);
+	REQUIRE(full.err);
+	REQUIRE(full.size() == 0);
+
+	reader.Read(3).Release();
+	REQUIRE(writer.TryClaim(8).size() == 3);
+}
+
+TEST_CASE("TEST ASYNC LOGGER FORMATS MESSAGES") {
+	const auto path = std::filesystem::temp_directory_path() / "disruptor_logger_test.log";
+	std::filesystem::remove(path);
+	{
+		logger::Logger log(path.string());
+		const std::string venue = "XLON";
+		REQUIRE_FALSE(log.Info("order {} filled {} @ {:.2f} on {}", 42, 100u, 99.5, venue));
+		REQUIRE_FALSE(log.Debug("filtered {}", 1));
+		REQUIRE_FALSE(log.Error("reject: {}", "no liquidity"));
+		log.Flush();
+
+		std::ifstream file(path);
+		std::vector<std::string> lines;
+		for (std::string line; std::getline(file, line);)
+			lines.push_back(line);
+		REQUIRE(lines.size() == 2);
+		REQUIRE(lines[0].find("INFO ") != std::string::npos);
+		REQUIRE(lines[0].ends_with("order 42 filled 100 @ 99.50 on XLON"));
+		REQUIRE(lines[1].find("ERROR") != std::string::npos);
+		REQUIRE(lines[1].ends_with("reject: no liquidity"));
+		REQUIRE(log.dropped() == 0);
+	}
+	std::filesystem::remove(path);
+}
+
+TEST_CASE("TEST ASYNC LOGGER TRUNCATES LONG STRINGS") {
+	const auto path = std::filesystem::temp_directory_path() / "disruptor_logger_truncate_test.log";
+	std::filesystem::remove(path);
+	{
+		logger::Logger log(path.string());
+		// Neither string fits: the first takes what the record has left after the fixed parts of the
+		// arguments behind it, and the second and the int must still come out intact.
+		REQUIRE_FALSE(log.Info("{}|{}|{}", std::string(200, 'a'), std::string(200, 'b'), 7));
+		REQUIRE_FALSE(log.Info("{}|{}", std::string(200, 'c'), 123456789ull));
+		log.Flush();
+
+		std::ifstream file(path);
+		std::vector<std::string> lines;
+		for (std::string line; std::getline(file, line);)
+			lines.push_back(line);
+		REQUIRE(lines.size() == 2);
+		const size_t first_room = logger::Record::ARGS_BYTES - 2 * sizeof(uint16_t) - sizeof(int);
+		REQUIRE(lines[0].ends_with(" " + std::string(first_room, 'a') + "||7"));
+		const size_t second_room = logger::Record::ARGS_BYTES - sizeof(uint16_t) - sizeof(unsigned long long);
+		REQUIRE(lines[1].ends_with(" " + std::string(second_room, 'c') + "|123456789"));
+	}
+	std::filesystem::remove(path);
+}
+
+TEST_CASE("TEST ASYNC LOGGER OVERFLOW POLICIES") {
+	const auto path = std::filesystem::temp_directory_path() / "disruptor_logger_overflow_test.log";
+	auto count_lines = [&] (std::string_view text) {
+		std::ifstream file(path);
+		size_t count = 0;
+		for (std::string line; std::getline(file, line);)
+			count += line.find(text) != std::string::npos;
+		return count;
+	};
+	constexpr size_t NoOfMessages = 1000;
+
+	SECTION("DROP loses what does not fit and reports it") {
+		std::filesystem::remove(path);
+		uint64_t dropped = 0;
+		{
+			// A consumer that sleeps between batches cannot keep up with a tight loop.
+			logger::Logger log(path.string(), {.capacity = 4, .idle_sleep = std::chrono::milliseconds(50)});
+			for (size_t i = 0; i < NoOfMessages; ++i)
+				log.Info("message {}", i);
+			dropped = log.dropped();
+		}
+		REQUIRE(dropped > 0);
+		REQUIRE(count_lines("message ") == NoOfMessages - dropped);
+		REQUIRE(count_lines("messages dropped") > 0);
+	}
+
+	SECTION("BLOCK waits for the consumer and keeps every message in order") {
+		std::filesystem::remove(path);
+		{
+			logger::Logger log(path.string(), {.capacity = 4, .overflow = logger::OverflowPolicy::BLOCK});
+			// Catch assertions are main-thread only: count failures and check them here.
+			auto log_all = [&] (std::string_view name) {
+				size_t failed = 0;
+				for (size_t i = 0; i < NoOfMessages; ++i)
+					failed += log.Info("{} {}", name, i);
+				return failed;
+			};
+			auto other = std::async(std::launch::async, log_all, "second");
+			REQUIRE(log_all("first") == 0);
+			REQUIRE(other.get() == 0);
+			REQUIRE(log.dropped() == 0);
+		}
+		REQUIRE(count_lines("] first ") == NoOfMessages);
+		REQUIRE(count_lines("] second ") == NoOfMessages);
+
+		std::ifstream file(path);
+		size_t next = 0;
+		for (std::string line; std::getline(file, line);)
+			if (auto pos = line.find("] first "); pos != std::string::npos)
+				REQUIRE(std::stoul(line.substr(pos + 8)) == next++);
+	}
+	std::filesystem::remove(path);
+}
+
+TEST_CASE("TEST CPU LIST PARSING") {
+	REQUIRE(disruptor::ParseCpuList("0-3,8,10-11\n") == std::vector<int>{0, 1, 2, 3, 8, 10, 11});
+	REQUIRE(disruptor::ParseCpuList("").empty());
+	REQUIRE(disruptor::ParseCpuList("x,2") == std::vector<int>{2});
+	REQUIRE(disruptor::FormatCpuList({11, 0, 2, 1, 3, 8, 10}) == "0-3,8,10-11");
+}
+
+TEST_CASE("TEST CPU TOPOLOGY AND SIBLING WARNINGS") {
+	// Two cores with two hyperthreads each: cpus 0 and 2 share core 0, cpus 1 and 3 core 1.
+	namespace fs = std::filesystem;
+	const fs::path root = fs::temp_directory_path() / "disruptor_fake_sysfs";
+	fs::remove_all(root);
+	auto write = [] (const fs::path& path, const std::string& text) { fs::create_directories(path.parent_path()); std::ofstream(path) << text << '\n'; };
+	write(root / "online", "0-3");
+	write(root / "isolated", "2-3");
+	for (int cpu = 0; cpu < 4; ++cpu) {
+		const fs::path dir = root / ("cpu" + std::to_string(cpu));
+		write(dir / "topology" / "core_id", std::to_string(cpu % 2));
+		write(dir / "topology" / "physical_package_id", "0");
+		write(dir / "topology" / "thread_siblings_list", cpu % 2 ? "1,3" : "0,2");
+		fs::create_directories(dir / "node0");
+	}
+
+	auto topology = disruptor::CpuTopology::Detect(root);
+	fs::remove_all(root);
+	REQUIRE(topology.cpus().size() == 4);
+	REQUIRE(topology.Find(3)->core_id == 1);
+	REQUIRE(topology.Find(3)->numa_node == 0);
+	REQUIRE(topology.Find(3)->isolated);
+	REQUIRE_FALSE(topology.Find(1)->isolated);
+	REQUIRE(topology.AreSiblings(0, 2));
+	REQUIRE_FALSE(topology.AreSiblings(0, 1));
+	REQUIRE_FALSE(topology.AreSiblings(0, 0));
+
+	// Placement is checked against the topology whether or not this machine has those cpus.
+	disruptor::ThreadRunner runner(topology);
+	runner.Start({"writer", {0}}, [] {});
+	REQUIRE(runner.warnings().empty());
+	runner.Start({"reader", {1}}, [] {});
+	REQUIRE(runner.warnings().empty());
+	runner.Start({"journal", {2}}, [] {});
+	REQUIRE(runner.warnings().size() == 1);
+	REQUIRE(runner.warnings()[0].find("hyperthreads") != std::string::npos);
+	runner.Start({"replica", {1}}, [] {});
+	REQUIRE(runner.warnings().size() == 2);
+	REQUIRE(runner.warnings()[1].find("share cpu 1") != std::string::npos);
+	runner.Start({"audit", {7}}, [] {});
+	REQUIRE(runner.warnings().back().find("not online") != std::string::npos);
+	runner.Join();
+
+	const auto report = runner.Report();
+	REQUIRE(report.find("cpu 2: core 0, package 0, node 0, siblings 0,2, isolated") != std::string::npos);
+	REQUIRE(report.find("journal: cpus 2") != std::string::npos);
+}
+
+TEST_CASE("TEST THREAD RUNNER PLACES THREADS") {
+	disruptor::ThreadRunner runner;
+	// The first CPU this process may run on; the topology lists every online one, cpuset or not.
+	cpu_set_t allowed;
+	REQUIRE(sched_getaffinity(0, sizeof(allowed), &allowed) == 0);
+	int cpu = 0;
+	while (!CPU_ISSET(static_cast<size_t>(cpu), &allowed)) {
+		++cpu;
+	}
+
+	std::atomic<int> ran_on{-1};
+	std::string name;
+	const bool err = runner.Start({"disruptor-reader-0", {cpu}}, [&] {
+		ran_on = sched_getcpu();
+		std::array<char, 16> buffer{};
+		pthread_getname_np(pthread_self(), buffer.data(), buffer.size());
+		name = buffer.data();
+	});
+	runner.Join();
+	REQUIRE_FALSE(err);
+	REQUIRE(ran_on == cpu);
+	// Truncated to what the kernel keeps.
+	REQUIRE(name == "disruptor-reade");
+
+	// Real-time priority needs privileges: it either applies or is reported, never silently lost.
+	int policy = -1;
+	const bool fifo_err = runner.Start({"fifo", {}, 1}, [&] {
+		sched_param param;
+		pthread_getschedparam(pthread_self(), &policy, &param);
+	});
+	runner.Join();
+	REQUIRE(fifo_err == (policy != SCHED_FIFO));
+	REQUIRE(runner.placements().back().errors.size() == (fifo_err ? 1u : 0u));
+	const auto report = runner.Report();
+	REQUIRE(report.find("disruptor-reader-0: cpus " + std::to_string(cpu) + "\n") != std::string::npos);
+	REQUIRE((report.find("fifo: cpus any, SCHED_FIFO 1, failed") != std::string::npos) == fifo_err);
+
+	// Processors take the same configuration.
+	auto disruptor = disruptor::MakeSingleDisruptor<size_t>(disruptor::ConsumerMode::COMPETING, 8);
+	auto writer = disruptor.CreateWriter();
+	struct Handler {
+		std::atomic<int>* 	cpu;
+		void OnEvent(size_t&, size_t, bool) { *cpu = sched_getcpu(); }
+	};
+	ran_on = -1;
+	disruptor::BatchEventProcessor processor(disruptor.CreateReader(), Handler{&ran_on});
+	REQUIRE_FALSE(processor.Start({"processor", {cpu}}));
+	writer.Write(size_t{1}, true);
+	processor.Join();
+	REQUIRE(ran_on == cpu);
+}
+
+namespace {
+	struct KeyedEvent {
+		size_t 	key;
+		size_t 	seq;
+	};
+
+	template <typename _ShardedT>
+	struct KeyOrderHandler {
+		void OnEvent(KeyedEvent& event, size_t, bool) {
+			in_order &= event.seq == next[event.key]++;
+			on_shard &= sharded->ShardOf(event.key) == shard;
+		}
+		const _ShardedT* 					sharded;
+		size_t 								shard;
+		std::unordered_map<size_t, size_t> 	next{};
+		bool 								in_order{true};
+		bool 								on_shard{true};
+	};
+
+	size_t Consumed(const auto& sharded) {
+		size_t total = 0;
+		for (const auto& stats: sharded.Stats())
+			total += stats.consumed;
+		return total;
+	}
+}
+
+TEST_CASE("TEST SHARDED DISRUPTOR KEEPS PER KEY ORDER") {
+	constexpr size_t NoOfShards = 4;
+	constexpr size_t NoOfWriters = 2;
+	constexpr size_t KeysPerWriter = 50;
+	constexpr size_t NoOfWrites = 2e4;
+	using ShardedT = disruptor::ShardedDisruptor<KeyedEvent, size_t>;
+	ShardedT sharded(NoOfShards, 256);
+
+	disruptor::ShardedProcessors processors(sharded, [&] (size_t shard) { 
+		return KeyOrderHandler<ShardedT>{&sharded, shard}; 
+	});
+	processors.Start();
+
+	// Each writer owns its keys, so every key has a single, ordered source.
+	std::vector<std::thread> writers;
+	for (size_t w = 0; w < NoOfWriters; ++w) {
+		writers.emplace_back([&sharded, w] {
+			std::vector<size_t> seqs(KeysPerWriter);
+			for (size_t i = 0; i < NoOfWrites; ++i) {
+				const size_t k = i % KeysPerWriter;
+				const KeyedEvent event{w * KeysPerWriter + k, seqs[k]++};
+				while(sharded.Write(event.key, event)) {}
+			}
+		});
+	}
+	for (auto& writer: writers)
+		writer.join();
+
+	REQUIRE(tests::WAIT_TEST([&] { return Consumed(sharded) == NoOfWriters * NoOfWrites; }));
+	processors.Halt();
+	processors.Join();
+
+	for (size_t s = 0; s < NoOfShards; ++s) {
+		REQUIRE(processors.handler(s).in_order);
+		REQUIRE(processors.handler(s).on_shard);
+	}
+	for (const auto& stats: sharded.Stats())
+		REQUIRE(stats.backlog == 0);
+}
+
+TEST_CASE("TEST SHARDED DISRUPTOR BACKLOG STATS") {
+	constexpr size_t NoOfShards = 8;
+	constexpr size_t NoOfKeys = 1000;
+	disruptor::ShardedDisruptor<size_t, size_t> sharded(NoOfShards, 256);
+
+	// Sequential keys still spread over every shard.
+	std::vector<size_t> expected(NoOfShards);
+	for (size_t key = 0; key < NoOfKeys; ++key) {
+		REQUIRE_FALSE(sharded.Write(key, key));
+		++expected[sharded.ShardOf(key)];
+	}
+
+	auto stats = sharded.Stats();
+	REQUIRE(stats.size() == NoOfShards);
+	size_t most = 0;
+	for (size_t s = 0; s < NoOfShards; ++s) {
+		REQUIRE(stats[s].shard == s);
+		REQUIRE(stats[s].published == expected[s]);
+		REQUIRE(stats[s].published > 0);
+		REQUIRE(stats[s].consumed == 0);
+		REQUIRE(stats[s].backlog == expected[s]);
+		most = std::max(most, expected[s]);
+	}
+	REQUIRE(sharded.Skew() == Approx(double(most) * NoOfShards / NoOfKeys));
+	REQUIRE(sharded.Skew() < 1.5);
+
+	// Draining one shard only shrinks its own backlog.
+	auto read_result = sharded.reader(0).Read(10);
+	REQUIRE_FALSE(read_result.err);
+	read_result.Release();
+	stats = sharded.Stats();
+	REQUIRE(stats[0].consumed == 10);
+	REQUIRE(stats[0].backlog == expected[0] - 10);
+	REQUIRE(stats[1].backlog == expected[1]);
+}
+
+namespace {
+	struct JournalEvent {
+		uint64_t 	id;
+		double 		price;
+		uint32_t 	quantity;
+	};
+
+	std::filesystem::path TempJournalDir(const std::string& name) {
+		auto directory = std::filesystem::temp_directory_path() / (name + "_" + std::to_string(::getpid()));
+		std::filesystem::remove_all(directory);
+		return directory;
+	}
+}
+
+TEST_CASE("TEST JOURNAL RECORDS AND REPLAYS EVENTS") {
+	constexpr size_t NoOfWrites = 1000;
+	const auto directory = TempJournalDir("journal_records");
+	{
+		auto disruptor = disruptor::MakeSingleDisruptor<JournalEvent>(disruptor::ConsumerMode::COMPETING, 256);
+		// Small segments so the journal rolls over several files.
+		disruptor::BatchEventProcessor journaller(disruptor.CreateReader(), 
+			disruptor::JournalHandler<JournalEvent>({directory, "orders", 4096, disruptor::SyncMode::ASYNC, 1024}));
+		journaller.Start();
+
+		auto writer = disruptor.CreateWriter();
+		for (size_t i = 0; i < NoOfWrites; ++i) {
+			while(writer.Write(JournalEvent{i, 100. + static_cast<double>(i), static_cast<uint32_t>(i % 7)}, i + 1 == NoOfWrites)) {}
+		}
+		journaller.Join();
+		REQUIRE(journaller.handler().writer().last_sequence() == NoOfWrites - 1);
+		REQUIRE(journaller.handler().writer().segment_index() > 1);
+		REQUIRE(journaller.handler().dropped() == 0);
+	}
+	{
+		// Segments too small for a single frame: events are counted as dropped, not lost silently.
+		const auto small = TempJournalDir("journal_small");
+		disruptor::JournalHandler<std::array<uint64_t, 8>> handler({small, "orders", 128});
+		handler.OnEvent({}, 0, false);
+		handler.OnEvent({}, 1, true);
+		REQUIRE(handler.dropped() == 2);
+		REQUIRE_FALSE(handler.writer().last_sequence());
+		std::filesystem::remove_all(small);
+	}
+
+	disruptor::JournalReader reader(directory, "orders");
+	disruptor::JournalFrame frame;
+	size_t count = 0;
+	bool in_order = true;
+	int64_t last_timestamp = 0;
+	while (reader.Next(frame) == disruptor::JournalStatus::OK) {
+		JournalEvent event;
+		REQUIRE(frame.payload.size() == sizeof(event));
+		std::memcpy(&event, frame.payload.data(), sizeof(event));
+		in_order &= frame.sequence == count && event.id == count && event.price == 100. + static_cast<double>(count);
+		in_order &= frame.timestamp_ns >= last_timestamp;
+		last_timestamp = frame.timestamp_ns;
+		++count;
+	}
+	REQUIRE(reader.Next(frame) == disruptor::JournalStatus::END);
+	REQUIRE(count == NoOfWrites);
+	REQUIRE(in_order);
+	// Wall clock, not time since boot.
+	REQUIRE(last_timestamp > 1'600'000'000'000'000'000);
+
+	// Replay through a fresh ring, starting part way in.
+	auto disruptor = disruptor::MakeSingleDisruptor<JournalEvent>(disruptor::ConsumerMode::COMPETING, 1024);
+	auto writer = disruptor.CreateWriter();
+	auto ring_reader = disruptor.CreateReader();
+	disruptor::JournalReader replay_reader(directory, "orders");
+	REQUIRE(replay_reader.Seek(250) == disruptor::JournalStatus::OK);
+	const auto result = disruptor::Replay<JournalEvent>(replay_reader, writer);
+	REQUIRE(result.status == disruptor::JournalStatus::END);
+	REQUIRE(result.events == NoOfWrites - 250);
+
+	auto read_result = ring_reader.Read(NoOfWrites);
+	REQUIRE_FALSE(read_result.err);
+	size_t expected = 250;
+	for (auto iter = read_result.begin; iter != read_result.end; ++iter)
+		in_order &= (*iter).data().id == expected++;
+	read_result.Release();
+	REQUIRE(in_order);
+	REQUIRE(expected == NoOfWrites);
+	std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("TEST JOURNAL DETECTS CORRUPTION AND RESUMES") {
+	const auto directory = TempJournalDir("journal_corrupt");
+	const disruptor::JournalOptions options{directory, "journal", 1 << 16, disruptor::SyncMode::SYNC, 0};
+	{
+		disruptor::JournalWriter writer(options);
+		for (uint64_t i = 0; i < 100; ++i) {
+			const JournalEvent event{i, 1., 1};
+			REQUIRE_FALSE(writer.Append(i, &event, sizeof(event), static_cast<int64_t>(i)));
+		}
+		// Frames never span segments.
+		std::vector<std::byte> huge(options.segment_size);
+		REQUIRE(writer.Append(100, huge.data(), huge.size(), 0));
+	}
+
+	// Flip one payload byte of frame 50.
+	{
+		std::fstream file(disruptor::journal::SegmentPath(directory, "journal", 0), std::ios::in | std::ios::out | std::ios::binary);
+		const auto offset = sizeof(disruptor::journal::SegmentHeader) + 50 * disruptor::journal::FrameBytes(sizeof(JournalEvent)) + 
+							sizeof(disruptor::journal::FrameHeader) + 3;
+		file.seekg(offset);
+		const char byte = static_cast<char>(file.get() ^ 0x40);
+		file.seekp(offset);
+		file.put(byte);
+	}
+
+	auto read_all = [&] (std::vector<uint64_t>& sequences) {
+		disruptor::JournalReader reader(directory);
+		disruptor::JournalFrame frame;
+		disruptor::JournalStatus status;
+		while ((status = reader.Next(frame)) == disruptor::JournalStatus::OK)
+			sequences.push_back(frame.sequence);
+		return status;
+	};
+	std::vector<uint64_t> sequences;
+	REQUIRE(read_all(sequences) == disruptor::JournalStatus::CORRUPT);
+	REQUIRE(sequences.size() == 50);
+
+	// A new writer drops the torn tail and carries on after the last intact frame.
+	{
+		disruptor::JournalWriter writer(options);
+		REQUIRE(writer.last_sequence() == 49);
+		for (uint64_t i = 50; i < 60; ++i) {
+			const JournalEvent event{i, 2., 2};
+			REQUIRE_FALSE(writer.Append(i, &event, sizeof(event), static_cast<int64_t>(i)));
+		}
+	}
+	sequences.clear();
+	REQUIRE(read_all(sequences) == disruptor::JournalStatus::END);
+	REQUIRE(sequences.size() == 60);
+	REQUIRE(sequences.back() == 59);
+	std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("TEST JOURNAL REPLAY AT RECORDED PACE") {
+	const auto directory = TempJournalDir("journal_pace");
+	constexpr int64_t GapNs = 2'000'000;
+	{
+		disruptor::JournalWriter writer({directory});
+		for (uint64_t i = 0; i <= 10; ++i) {
+			const JournalEvent event{i, 1., 1};
+			writer.Append(i, &event, sizeof(event), static_cast<int64_t>(i) * GapNs);
+		}
+	}
+
+	auto replay = [&] (double speed) {
+		auto disruptor = disruptor::MakeSingleDisruptor<JournalEvent>(disruptor::ConsumerMode::COMPETING, 16);
+		auto writer = disruptor.CreateWriter();
+		auto reader = disruptor.CreateReader();
+		disruptor::JournalReader journal_reader(directory);
+		const auto start = std::chrono::steady_clock::now();
+		const auto result = disruptor::Replay<JournalEvent>(journal_reader, writer, disruptor::ReplayPace::RECORDED, speed);
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+		REQUIRE(result.events == 11);
+		REQUIRE(result.status == disruptor::JournalStatus::END);
+		return elapsed;
+	};
+	REQUIRE(replay(1.) >= std::chrono::nanoseconds(10 * GapNs));
+	REQUIRE(replay(4.) >= std::chrono::nanoseconds(10 * GapNs / 4));
+	std::filesystem::remove_all(directory);
+}
+
+TEMPLATE_TEST_CASE_SIG("TEST CURSORS START AT A GIVEN SEQUENCE", "", ((disruptor::PublishPolicy P), P),
+	disruptor::PublishPolicy::SINGLE, disruptor::PublishPolicy::BUFFERED, 
+	disruptor::PublishPolicy::BLOCK, disruptor::PublishPolicy::AVAILABILITY) {
+	constexpr size_t Start = 1'000'003;
+	auto disruptor = disruptor::MakeSingleDisruptor<size_t, P, P>(disruptor::ConsumerMode::BROADCAST, 8);
+	auto writer = disruptor.CreateWriter();
+	auto reader = disruptor.CreateReader();
+	disruptor.StartAt(Start);
+	REQUIRE(writer.GetCursor() == Start);
+	REQUIRE(reader.GetCursor() == Start);
+	REQUIRE(reader.Read(1).err);
+
+	// Several laps of a small ring, so slot indices wrap from an arbitrary start.
+	bool in_order = true;
+	for (size_t i = 0; i < 20; ++i) {
+		REQUIRE_FALSE(writer.Write(Start + i));
+		auto read_result = reader.Read(1);
+		REQUIRE_FALSE(read_result.err);
+		in_order &= read_result.sequence() == Start + i && (*read_result.begin).data() == Start + i;
+		read_result.Release();
+	}
+	REQUIRE(in_order);
+	REQUIRE(writer.GetCursor() == Start + 20);
+	REQUIRE(reader.GetCursor() == Start + 20);
+}
+
+namespace {
+	struct CounterState {
+		uint64_t 	count;
+		uint64_t 	sum;
+		uint64_t 	last_id;
+	};
+
+	struct CountingHandler {
+		const CounterState& state() const 	{ return state_; }
+		void OnEvent(const JournalEvent& event, size_t, bool) {
+			++state_.count;
+			state_.sum += event.id;
+			state_.last_id = event.id;
+		}
+		CounterState 	state_{};
+	};
+}
+
+TEST_CASE("TEST SNAPSHOT STORE ROUND TRIP") {
+	const auto directory = TempJournalDir("snapshots");
+	disruptor::SnapshotStore<CounterState> store({directory, "counter", 2});
+	REQUIRE_FALSE(store.LoadLatest());
+
+	for (uint64_t i = 1; i <= 4; ++i) {
+		while (store.Take({i, i * 10, i}, i * 100)) {}
+		store.Flush();
+	}
+	REQUIRE(store.written() == 4);
+	REQUIRE(store.last_error() == 0);
+	// Only the newest ones are kept.
+	REQUIRE(disruptor::snapshot::List(directory, "counter") == std::vector<uint64_t>{400, 300});
+
+	auto latest = store.LoadLatest();
+	REQUIRE(latest);
+	REQUIRE(latest->sequence() == 400);
+	REQUIRE(latest->state().count == 4);
+	REQUIRE(latest->state().sum == 40);
+	REQUIRE(latest->timestamp_ns() > 0);
+	// The mapping is private: changing the loaded state leaves the file alone.
+	latest->state().count = 99;
+	REQUIRE(store.LoadLatest()->state().count == 4);
+
+	// A damaged newest snapshot falls back to the one before.
+	{
+		std::fstream file(disruptor::snapshot::Path(directory, "counter", 400), std::ios::in | std::ios::out | std::ios::binary);
+		file.seekp(disruptor::snapshot::StateOffset<CounterState>() + 1);
+		file.put('x');
+	}
+	REQUIRE(store.LoadLatest()->sequence() == 300);
+	std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("TEST WARM RESTART FROM SNAPSHOT AND JOURNAL") {
+	constexpr size_t NoOfWrites = 5000;
+	const auto journal_dir = TempJournalDir("restart_journal");
+	const auto snapshot_dir = TempJournalDir("restart_snapshots");
+	CounterState expected{};
+	{
+		// Journal and state consumers side by side, as in production.
+		auto disruptor = disruptor::MakeSingleDisruptor<JournalEvent>(disruptor::ConsumerMode::BROADCAST, 256);
+		disruptor::BatchEventProcessor journaller(disruptor.CreateReader(), disruptor::JournalHandler<JournalEvent>({journal_dir}));
+		disruptor::BatchEventProcessor counter(disruptor.CreateReader(), 
+			disruptor::SnapshotHandler(CountingHandler{}, {snapshot_dir, "counter"}, 500));
+		journaller.Start();
+		counter.Start();
+
+		auto writer = disruptor.CreateWriter();
+		for (size_t i = 0; i < NoOfWrites; ++i) {
+			while(writer.Write(JournalEvent{i, 1., 1}, i + 1 == NoOfWrites)) {}
+		}
+		journaller.Join();
+		counter.Join();
+		expected = counter.handler().handler().state();
+		REQUIRE(expected.count == NoOfWrites);
+	}
+
+	// "Crash" back to an older snapshot, as if the last ones were never written.
+	auto sequences = disruptor::snapshot::List(snapshot_dir, "counter");
+	REQUIRE(sequences.front() == NoOfWrites);
+	std::filesystem::remove(disruptor::snapshot::Path(snapshot_dir, "counter", sequences.front()));
+
+	disruptor::SnapshotStore<CounterState> store({snapshot_dir, "counter"});
+	auto snapshot = store.LoadLatest();
+	REQUIRE(snapshot);
+	const size_t start = snapshot->sequence();
+	REQUIRE(start < NoOfWrites);
+	REQUIRE(snapshot->state().count == start);
+
+	// Resume the ring where the snapshot ends and replay only what it does not cover.
+	auto disruptor = disruptor::MakeSingleDisruptor<JournalEvent>(disruptor::ConsumerMode::COMPETING, 256);
+	disruptor::BatchEventProcessor counter(disruptor.CreateReader(), CountingHandler{snapshot->state()});
+	disruptor.StartAt(start);
+	counter.Start();
+
+	auto writer = disruptor.CreateWriter();
+	disruptor::JournalReader journal(journal_dir);
+	REQUIRE(journal.Seek(start) == disruptor::JournalStatus::OK);
+	const auto replayed = disruptor::Replay<JournalEvent>(journal, writer);
+	REQUIRE(replayed.status == disruptor::JournalStatus::END);
+	REQUIRE(replayed.events == NoOfWrites - start);
+	REQUIRE(tests::WAIT_TEST([&] { return counter.reader().GetCursor() == NoOfWrites; }));
+	counter.Halt();
+	counter.Join();
+
+	const auto& restored = counter.handler().state();
+	REQUIRE(restored.count == expected.count);
+	REQUIRE(restored.sum == expected.sum);
+	REQUIRE(restored.last_id == expected.last_id);
+	std::filesystem::remove_all(journal_dir);
+	std::filesystem::remove_all(snapshot_dir);
+}
+
+// Payload of n bytes derived from the record's index, so readers can check it in place.
+void FillRecord(std::span<std::byte> payload, uint64_t index) {
+	for (size_t i = 0; i < payload.size(); ++i)
+		payload[i] = static_cast<std::byte>(index + i);
+}
+
+bool CheckRecord(std::span<const std::byte> payload, uint64_t index) {
+	for (size_t i = 0; i < payload.size(); ++i)
+		if (payload[i] != static_cast<std::byte>(index + i)) return false;
+	return true;
+}
+
+TEST_CASE("TEST BYTE RING ROUND TRIPS MIXED SIZES") {
+	constexpr size_t NoOfWrites = 20000;
+	constexpr std::array<size_t, 5> Sizes{0, 3, 20, 64, 200};
+	// Small enough that records wrap around many times.
+	auto ring = disruptor::ByteRing<>::Create(1024);
+	auto reader = ring->CreateReader();
+	auto writer = ring->CreateWriter();
+
+	auto writes = std::async(std::launch::async, [&] {
+		for (uint64_t i = 0; i < NoOfWrites; ++i) {
+			auto claim = writer.Claim(static_cast<uint16_t>(i % Sizes.size()), Sizes[i % Sizes.size()]);
+			REQUIRE_FALSE(claim.err);
+			FillRecord(claim.data(), i);
+		}
+	});
+
+	uint64_t read = 0;
+	bool ok = true;
+	while (read < NoOfWrites) {
+		auto batch = reader.Read();
+		if (batch.err) continue;
+		for (const auto& record: batch) {
+			ok &= record.type == read % Sizes.size();
+			ok &= record.payload.size() == Sizes[read % Sizes.size()];
+			ok &= CheckRecord(record.payload, read);
+			++read;
+		}
+	}
+	writes.get();
+	REQUIRE(ok);
+	REQUIRE(read == NoOfWrites);
+	REQUIRE(reader.Read().err);
+}
+
+TEST_CASE("TEST BYTE RING PADS AT WRAP AROUND") {
+	// 16 blocks of 8 bytes.
+	auto ring = disruptor::ByteRing<>::Create(128);
+	auto reader = ring->CreateReader();
+	auto writer = ring->CreateWriter();
+	REQUIRE(ring->max_record_size() == 56);
+	// Too large for the ring, ever.
+	REQUIRE(writer.Claim(1, 57).err);
+	REQUIRE(writer.Write(1, nullptr, 1000));
+
+	const std::array<std::byte, 64> payload{};
+	// 1 + 5 blocks, twice: 12 of 16 blocks used.
+	REQUIRE_FALSE(writer.Write(1, payload.data(), 40));
+	REQUIRE_FALSE(writer.Write(2, payload.data(), 40));
+	{
+		auto batch = reader.Read();
+		REQUIRE(batch.blocks() == 12);
+		std::vector<uint16_t> types;
+		for (const auto& record: batch) types.push_back(record.type);
+		REQUIRE(types == std::vector<uint16_t>{1, 2});
+	}
+
+	// 1 + 2 blocks, read at once: 1 block left before the end.
+	REQUIRE_FALSE(writer.Write(3, payload.data(), 16));
+	REQUIRE_FALSE(reader.Read().err);
+
+	// 1 + 5 blocks do not fit: the last block and what the reservation took past the end are padded,
+	// and the record starts over after them.
+	REQUIRE_FALSE(writer.Write(4, payload.data(), 40));
+	REQUIRE(ring->GetWriteCursor() == 15 + 6 + 6);
+	auto batch = reader.Read();
+	REQUIRE(batch.blocks() == 12);
+	size_t records = 0;
+	for (const auto& record: batch) {
+		REQUIRE(record.type == 4);
+		REQUIRE(record.payload.size() == 40);
+		REQUIRE(record.sequence == 21);
+		++records;
+	}
+	REQUIRE(records == 1);
+}
+
+TEST_CASE("TEST BYTE RING WRAPS THE LARGEST RECORD") {
+	// 8 blocks: a largest record takes 4, and writing one after a small record has to wrap.
+	auto ring = disruptor::ByteRing<>::Create(64);
+	auto reader = ring->CreateReader();
+	auto writer = ring->CreateWriter();
+	const std::array<std::byte, 24> payload{};
+	REQUIRE(ring->max_record_size() == payload.size());
+
+	REQUIRE_FALSE(writer.Write(1, payload.data(), 4));
+	REQUIRE_FALSE(reader.Read().err);
+	for (size_t i = 0; i < 20; ++i) {
+		REQUIRE_FALSE(writer.Write(2, payload.data(), payload.size()));
+		size_t records = 0;
+		for (const auto& record: reader.Read()) {
+			REQUIRE(record.payload.size() == payload.size());
+			++records;
+		}
+		REQUIRE(records == 1);
+	}
+}
+
+TEST_CASE("TEST BYTE RING WITH MANY WRITERS AND BROADCAST READERS") {
+	constexpr size_t NoOfWriters = 3;
+	constexpr size_t NoOfWrites = 5000;
+	auto ring = disruptor::ByteRing<disruptor::PublishPolicy::BLOCK>::Create(4096);
+	std::vector<disruptor::ByteReader<disruptor::PublishPolicy::BLOCK, disruptor::BusySpinWait>> readers;
+	readers.push_back(ring->CreateReader());
+	readers.push_back(ring->CreateReader());
+
+	std::vector<std::future<void>> writes;
+	for (uint16_t w = 0; w < NoOfWriters; ++w) {
+		writes.push_back(std::async(std::launch::async, [&, w] {
+			auto writer = ring->CreateWriter();
+			for (uint64_t i = 0; i < NoOfWrites; ++i)
+				while (writer.Write(w, &i, 8 + 8 * (i % 4))) {}
+		}));
+	}
+
+	std::vector<std::future<bool>> reads;
+	for (auto& reader: readers) {
+		reads.push_back(std::async(std::launch::async, [&reader] {
+			// Records from one writer arrive in the order it wrote them.
+			std::array<uint64_t, NoOfWriters> next{};
+			size_t read = 0;
+			bool ok = true;
+			while (read < NoOfWriters * NoOfWrites) {
+				for (const auto& record: reader.Read()) {
+					uint64_t i;
+					std::memcpy(&i, record.payload.data(), sizeof(i));
+					ok &= record.type < NoOfWriters && i == next[record.type]++;
+					ok &= record.payload.size() == 8 + 8 * (i % 4);
+					++read;
+				}
+			}
+			return ok;
+		}));
+	}
+	for (auto& write: writes) write.get();
+	for (auto& read: reads) REQUIRE(read.get());
+}
+
+struct PooledOrder {
+	uint64_t 				id{};
+	std::vector<uint64_t> 	fills;
+};
+
+TEST_CASE("TEST PAYLOAD POOL ACQUIRE AND RELEASE") {
+	constexpr size_t Capacity = 8;
+	size_t initialised = 0;
+	auto pool = disruptor::PayloadPool<PooledOrder>::Create(Capacity, 2, [&] (PooledOrder& order) {
+		order.fills.reserve(4);
+		++initialised;
+	});
+	REQUIRE(initialised == Capacity);
+	REQUIRE(pool->CountShared() == Capacity);
+
+	auto cache = pool->CreateCache(2);
+	std::vector<disruptor::PayloadHandle> handles;
+	for (size_t i = 0; i < Capacity; ++i) {
+		handles.push_back(cache.Acquire());
+		REQUIRE(handles.back().valid());
+		REQUIRE((*pool)[handles.back()].fills.capacity() >= 4);
+	}
+	REQUIRE_FALSE(cache.Acquire().valid());
+
+	// Both consumers must release a block before it is free.
+	for (auto handle: handles) cache.Release(handle);
+	REQUIRE(cache.size() == 0);
+	REQUIRE_FALSE(cache.Acquire().valid());
+	for (auto handle: handles) cache.Release(handle);
+	// Beyond twice the batch, the cache spills to the shared list.
+	REQUIRE(cache.size() + pool->CountShared() == Capacity);
+	REQUIRE(cache.size() <= 4);
+
+	cache.Flush();
+	REQUIRE(pool->CountShared() == Capacity);
+	std::vector<uint32_t> indices;
+	for (size_t i = 0; i < Capacity; ++i) indices.push_back(cache.Acquire().index);
+	std::sort(indices.begin(), indices.end());
+	REQUIRE(std::adjacent_find(indices.begin(), indices.end()) == indices.end());
+}
+
+// Checks each order it is handed and counts them.
+struct OrderChecker {
+	void 		OnEvent(PooledOrder& order, size_t, bool) {
+		ok &= order.id == count && order.fills.size() == order.id % 4 + 1;
+		for (auto fill: order.fills) ok &= fill == order.id;
+		++count;
+	}
+	uint64_t 	count{};
+	bool 		ok{true};
+};
+
+TEST_CASE("TEST PAYLOAD POOL BEHIND BROADCAST CONSUMERS") {
+	constexpr size_t NoOfWrites = 50000;
+	// Barely more blocks than ring slots, so blocks are recycled all the time.
+	auto pool = disruptor::PayloadPool<PooledOrder>::Create(96, 2, [] (PooledOrder& order) { order.fills.reserve(4); });
+	auto disruptor = disruptor::MakeSingleDisruptor<disruptor::PayloadHandle>(disruptor::ConsumerMode::BROADCAST, 64);
+	disruptor::BatchEventProcessor first(disruptor.CreateReader(), disruptor::PooledHandler(OrderChecker{}, pool, 8));
+	disruptor::BatchEventProcessor second(disruptor.CreateReader(), disruptor::PooledHandler(OrderChecker{}, pool, 8));
+	first.Start();
+	second.Start();
+	{
+		auto writer = disruptor.CreateWriter();
+		auto cache = pool->CreateCache(8);
+		for (uint64_t i = 0; i < NoOfWrites; ++i) {
+			disruptor::PayloadHandle handle;
+			while (!(handle = cache.Acquire()).valid()) {}
+			auto& order = (*pool)[handle];
+			order.id = i;
+			order.fills.assign(i % 4 + 1, i);
+			while (writer.Write(handle, i + 1 == NoOfWrites)) {}
+		}
+	}
+	first.Join();
+	second.Join();
+
+	for (auto* processor: {&first, &second}) {
+		REQUIRE(processor->handler().handler().count == NoOfWrites);
+		REQUIRE(processor->handler().handler().ok);
+	}
+	// Every block is back once the consumers have shut down.
+	REQUIRE(pool->CountShared() == pool->capacity());
+}
+
+disruptor::BookEvent AddOrder(uint64_t id, disruptor::Side side, int64_t price, uint32_t quantity) {
+	return {disruptor::BookEventType::ADD, side, quantity, id, price};
+}
+
+TEST_CASE("TEST ORDER BOOK LEVELS AND TOP OF BOOK") {
+	using disruptor::BookEventType, disruptor::BookStatus, disruptor::Side;
+	disruptor::OrderBook book({100, 200, 4});
+	REQUIRE(book.top().bid_quantity == 0);
+	REQUIRE(book.top().ask_quantity == 0);
+
+	REQUIRE(book.Apply(AddOrder(1, Side::BUY, 150, 10)) == BookStatus::OK);
+	REQUIRE(book.Apply(AddOrder(2, Side::BUY, 149, 20)) == BookStatus::OK);
+	REQUIRE(book.Apply(AddOrder(3, Side::SELL, 152, 5)) == BookStatus::OK);
+	REQUIRE(book.Apply(AddOrder(4, Side::BUY, 150, 7)) == BookStatus::OK);
+	auto top = book.top();
+	REQUIRE((top.bid_price == 150 && top.bid_quantity == 17 && top.ask_price == 152 && top.ask_quantity == 5));
+	REQUIRE(book.LevelOrders(Side::BUY, 150) == 2);
+
+	// Rejections leave the book alone.
+	REQUIRE(book.Apply(AddOrder(1, Side::SELL, 160, 1)) == BookStatus::DUPLICATE_ORDER);
+	REQUIRE(book.Apply(AddOrder(5, Side::SELL, 201, 1)) == BookStatus::OUT_OF_RANGE);
+	REQUIRE(book.Apply(AddOrder(5, Side::SELL, 160, 1)) == BookStatus::FULL);
+	REQUIRE(book.Apply({BookEventType::CANCEL, Side::BUY, 0, 99, 0}) == BookStatus::UNKNOWN_ORDER);
+	REQUIRE(book.Apply({BookEventType::MODIFY, Side::BUY, 1, 1, 99}) == BookStatus::OUT_OF_RANGE);
+	REQUIRE(book.order_count() == 4);
+
+	// Partial execution, partial cancel, then modifies in place and to a new price.
+	REQUIRE(book.Apply({BookEventType::EXECUTE, Side::BUY, 4, 1, 0}) == BookStatus::OK);
+	REQUIRE(book.Apply({BookEventType::CANCEL, Side::BUY, 2, 4, 0}) == BookStatus::OK);
+	REQUIRE(book.LevelQuantity(Side::BUY, 150) == 11);
+	REQUIRE(book.Apply({BookEventType::MODIFY, Side::BUY, 3, 1, 150}) == BookStatus::OK);
+	REQUIRE(book.Apply({BookEventType::MODIFY, Side::BUY, 6, 3, 151}) == BookStatus::OK);
+	REQUIRE(book.OrderQuantity(3) == 6);
+	top = book.top();
+	REQUIRE((top.bid_price == 150 && top.bid_quantity == 8 && top.ask_price == 151 && top.ask_quantity == 6));
+
+	// Emptying the best levels moves the best price to the next level in use.
+	REQUIRE(book.Apply({BookEventType::EXECUTE, Side::BUY, 3, 1, 0}) == BookStatus::OK);
+	REQUIRE(book.Apply({BookEventType::CANCEL, Side::BUY, 0, 4, 0}) == BookStatus::OK);
+	REQUIRE(book.Apply({BookEventType::CANCEL, Side::BUY, 0, 3, 0}) == BookStatus::OK);
+	top = book.top();
+	REQUIRE((top.bid_price == 149 && top.bid_quantity == 20 && top.ask_quantity == 0));
+	REQUIRE(book.order_count() == 1);
+	REQUIRE(book.OrderQuantity(1) == 0);
+	// Freed nodes are reused.
+	REQUIRE(book.Apply(AddOrder(7, Side::SELL, 200, 1)) == BookStatus::OK);
+	REQUIRE(book.Apply(AddOrder(8, Side::SELL, 100, 1)) == BookStatus::OK);
+	REQUIRE(book.top().ask_price == 100);
+}
+
+TEST_CASE("TEST ORDER BOOK MATCHES A REFERENCE MODEL") {
+	using disruptor::BookEventType, disruptor::Side;
+	constexpr int64_t MinPrice = 1000, MaxPrice = 1063;
+	disruptor::OrderBook book({MinPrice, MaxPrice, 512});
+	// id -> (side, price, quantity), and quantity per side and price.
+	std::unordered_map<uint64_t, std::tuple<Side, int64_t, uint64_t>> orders;
+	std::map<int64_t, uint64_t> levels[2];
+	std::mt19937_64 rng(7);
+	std::vector<uint64_t> live;
+	uint64_t next_id = 1;
+
+	auto remove = [&] (uint64_t id, uint64_t quantity) {
+		auto& [side, price, open] = orders[id];
+		quantity = quantity == 0 ? open : std::min(quantity, open);
+		if ((levels[static_cast<size_t>(side)][price] -= quantity) == 0) levels[static_cast<size_t>(side)].erase(price);
+		if ((open -= quantity) == 0) {
+			orders.erase(id);
+			std::erase(live, id);
+		}
+	};
+
+	for (size_t step = 0; step < 100000; ++step) {
+		const auto roll = rng() % 100;
+		if (live.size() < 500 && (live.empty() || roll < 45)) {
+			const auto side = rng() % 2 ? Side::BUY : Side::SELL;
+			const int64_t price = MinPrice + static_cast<int64_t>(rng() % (MaxPrice - MinPrice + 1));
+			const auto quantity = static_cast<uint32_t>(1 + rng() % 100);
+			// Sparse, clustered ids exercise probing and backward-shift deletion.
+			const uint64_t id = (next_id++) * 4096;
+			REQUIRE(book.Apply(AddOrder(id, side, price, quantity)) == disruptor::BookStatus::OK);
+			orders[id] = {side, price, quantity};
+			levels[static_cast<size_t>(side)][price] += quantity;
+			live.push_back(id);
+			continue;
+		}
+		const uint64_t id = live[rng() % live.size()];
+		const auto quantity = static_cast<uint32_t>(rng() % 60);
+		if (roll < 55) {
+			auto& [side, price, open] = orders[id];
+			const int64_t new_price = MinPrice + static_cast<int64_t>(rng() % (MaxPrice - MinPrice + 1));
+			REQUIRE(book.Apply({BookEventType::MODIFY, side, quantity, id, new_price}) == disruptor::BookStatus::OK);
+			if (quantity == 0) { remove(id, 0); continue; }
+			auto& level = levels[static_cast<size_t>(side)];
+			if ((level[price] -= open) == 0) level.erase(price);
+			level[new_price] += quantity;
+			price = new_price;
+			open = quantity;
+		}
+		else {
+			REQUIRE(book.Apply({roll < 80 ? BookEventType::CANCEL : BookEventType::EXECUTE, Side::BUY, quantity, id, 0}) == disruptor::BookStatus::OK);
+			remove(id, quantity);
+		}
+
+		const auto top = book.top();
+		const auto& bids = levels[static_cast<size_t>(Side::BUY)];
+		const auto& asks = levels[static_cast<size_t>(Side::SELL)];
+		REQUIRE(top.bid_quantity == (bids.empty() ? 0 : bids.rbegin()->second));
+		REQUIRE(top.ask_quantity == (asks.empty() ? 0 : asks.begin()->second));
+		if (!bids.empty()) REQUIRE(top.bid_price == bids.rbegin()->first);
+		if (!asks.empty()) REQUIRE(top.ask_price == asks.begin()->first);
+		REQUIRE(book.OrderQuantity(id) == (orders.contains(id) ? std::get<2>(orders[id]) : 0));
+	}
+	REQUIRE(book.order_count() == orders.size());
+	for (const auto& [id, order]: orders)
+		REQUIRE(book.OrderQuantity(id) == std::get<2>(order));
+}
+
+TEST_CASE("TEST ORDER BOOK PUBLISHES TOP OF BOOK DOWNSTREAM") {
+	using disruptor::Side;
+	constexpr size_t NoOfOrders = 20000;
+	auto feed = disruptor::MakeSingleDisruptor<disruptor::BookEvent>(disruptor::ConsumerMode::COMPETING, 256);
+	auto tops = disruptor::MakeSingleDisruptor<disruptor::TopOfBook>(disruptor::ConsumerMode::COMPETING, 64);
+	disruptor::BatchEventProcessor book(feed.CreateReader(), disruptor::OrderBookHandler({1, 1000, NoOfOrders}, tops.CreateWriter()));
+
+	// Collects the tops of book until the book's processor shuts down.
+	auto collected = std::async(std::launch::async, [reader = tops.CreateReader()] () mutable {
+		std::vector<disruptor::TopOfBook> seen;
+		for (bool eof = false; !eof;) {
+			auto result = reader.Read(64);
+			if (result.err) continue;
+			for (auto iter = result.begin; iter != result.end; ++iter) {
+				seen.push_back((*iter).data());
+				eof |= (*iter).is_eof();
+			}
+			result.Release();
+		}
+		return seen;
+	});
+	book.Start();
+
+	auto writer = feed.CreateWriter();
+	// Bids climbing towards the asks, plus one unknown cancel.
+	for (uint64_t i = 0; i < NoOfOrders; ++i) {
+		const auto side = i % 2 ? Side::SELL : Side::BUY;
+		const int64_t price = side == Side::BUY ? 1 + static_cast<int64_t>(i % 499) : 1000 - static_cast<int64_t>(i % 499);
+		while (writer.Write(AddOrder(i, side, price, 1), false)) {}
+	}
+	while (writer.Write(disruptor::BookEvent{disruptor::BookEventType::CANCEL, Side::BUY, 0, NoOfOrders, 0}, true)) {}
+	book.Join();
+	const auto seen = collected.get();
+
+	REQUIRE(book.handler().rejected() == 1);
+	REQUIRE(book.handler().book().order_count() == NoOfOrders);
+	REQUIRE(seen.size() == book.handler().published() + 1);
+	const auto final_top = book.handler().book().top();
+	REQUIRE(seen.back().SameQuotes(final_top));
+	REQUIRE((final_top.bid_price == 499 && final_top.ask_price == 502));
+	// Conflated: consecutive tops always differ, in feed order.
+	for (size_t i = 1; i + 1 < seen.size(); ++i) {
+		REQUIRE_FALSE(seen[i].SameQuotes(seen[i - 1]));
+		REQUIRE(seen[i].sequence > seen[i - 1].sequence);
+	}
+}
+
 TEST_CASE("TEST THAT DISRUPTOR IS FASTER THAN A SIMPLE THREADSAFE QUEUE") {
 	constexpr size_t NoOfWriters = 3;
 	constexpr size_t NoOfWritesPerWriter =200;
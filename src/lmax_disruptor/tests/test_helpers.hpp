@@ -1,5 +1,9 @@
+#include <array>
 #include <chrono>
+#include <future>
+#include <optional>
 #include <ostream>
+#include <thread>
 #include <vector>
 #include <deque>
 
@@ -48,10 +52,11 @@ namespace tests{
     };
 
     //---------------------------------------------------------------------------
+    template <disruptor::PublishPolicy _WP = disruptor::PublishPolicy::BLOCK, disruptor::PublishPolicy _RP = disruptor::PublishPolicy::BUFFERED, typename _WS = disruptor::BusySpinWait>
     profiler::Stats TimedDisruptorTask (const size_t NoOfWriters, const size_t NoOfWritesPerWriter) {
-        using WriterType = disruptor::Writer<size_t, disruptor::PublishPolicy::BLOCK, disruptor::PublishPolicy::BUFFERED>;
+        using WriterType = disruptor::Writer<size_t, _WP, _RP, _WS>;
 
-		auto disruptor = disruptor::MakeSingleDisruptor<size_t, disruptor::PublishPolicy::BLOCK, disruptor::PublishPolicy::BUFFERED>();
+		auto disruptor = disruptor::MakeSingleDisruptor<size_t, _WP, _RP, _WS>();
 		std::vector<WriterType>  writers;
 		writers.reserve(NoOfWriters);
 
@@ -109,6 +114,48 @@ namespace tests{
         return timer.Stats();
     }
 
+    //---------------------------------------------------------------------------
+    // Fixed-size event; the first word carries the sequence number.
+    template <size_t Bytes>
+    struct Event {
+        std::array<size_t, Bytes/sizeof(size_t)> words{};
+    };
+
+    //---------------------------------------------------------------------------
+    // One writer streams NoOfWrites events to one reader over a ring with the given slot layout.
+    // Returns whether every event arrived in order.
+    template <typename Elem, disruptor::Layout _SL>
+    bool LayoutTask (const size_t NoOfWrites) {
+        auto disruptor = disruptor::MakeSingleDisruptor<Elem, disruptor::PublishPolicy::SINGLE, disruptor::PublishPolicy::SINGLE, disruptor::BusySpinWait, _SL>(
+            disruptor::ConsumerMode::COMPETING, 1 << 12);
+
+        auto writer_task = std::async(std::launch::async, [writer = disruptor.CreateWriter(), NoOfWrites] () mutable {
+            for (size_t i = 0; i < NoOfWrites; ++i) {
+                Elem elem{};
+                elem.words[0] = i;
+                while(writer.Write(std::move(elem))) {}
+            }
+        });
+
+        auto reader = disruptor.CreateReader();
+        size_t expected = 0;
+        bool in_order = true;
+
+        while (expected < NoOfWrites) 
+        {
+            auto read_result = reader.Read(256);
+            if (read_result.err) {continue;}
+            for (auto iter = read_result.begin; iter != read_result.end; ++iter) 
+            {
+                in_order &= (*iter).data().words[0] == expected++;
+            }
+            read_result.Release();
+        }
+        writer_task.wait();
+
+        return in_order;
+    }
+
     //---------------------------------------------------------------------------
     profiler::Stats TimedQueueTask (const size_t NoOfWriters, const size_t NoOfWritesPerWriter) {
         